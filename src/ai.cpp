@@ -1,6 +1,37 @@
 #include "ai.hpp"
 
 
+std::vector<bool> floor_grid(const Map& map, sf::Vector2i startposition, int radius)
+{
+    int perimeter = 2*radius+1;
+    std::vector<bool> floors(perimeter * perimeter, false);
+
+    sf::IntRect area = {startposition.x - radius, startposition.y - radius, perimeter, perimeter};
+    map.forEachSpan(area, [&](int x, int y, const CellType* cells, int length)
+    {
+        if (cells == nullptr)
+            return;
+
+        size_t first = (x - area.left) + perimeter * (y - area.top);
+        for (int i = 0 ; i < length ; i++)
+            floors[first + i] = cells[i] == CellType::Floor;
+    });
+
+    return floors;
+}
+
+bool is_floor(const std::vector<bool>& floors, sf::Vector2i position, sf::Vector2i startposition, int radius)
+{
+    int perimeter = 2*radius+1;
+    int x = position.x + radius - startposition.x;
+    int y = position.y + radius - startposition.y;
+
+    assert(x >= 0 && x < perimeter && y >= 0 && y < perimeter);
+
+    return floors[x + perimeter * y];
+}
+
+
 bool cell_seen(std::vector<std::vector<bool>> &seen, sf::Vector2i position, sf::Vector2i startposition, int sight){
     bool test = seen[position.x + sight - startposition.x][position.y + sight - startposition.y];
     seen[position.x + sight - startposition.x][position.y + sight - startposition.y] = true;
@@ -66,6 +97,9 @@ Action attack(const Character& monster, const std::vector<std::shared_ptr<Entity
     std::vector<std::vector<bool>> seen(sightperimeter, std::vector<bool>(sightperimeter,false) );
     thereisaobstacle(entities,seen,startposition,sight);
 
+    // The BFS reads cells up to one step further than the sight.
+    std::vector<bool> floors = floor_grid(map, startposition, sight+1);
+
 
     //Initiate of the structures used in the graph BFS.
     sf::Vector2i curentposition = startposition;
@@ -84,7 +118,7 @@ Action attack(const Character& monster, const std::vector<std::shared_ptr<Entity
     for(auto ori : dir)
     {
         sf::Vector2i position = curentposition + ori;
-        if (map.cellAt(position.x,position.y)==CellType::Floor)
+        if (is_floor(floors, position, startposition, sight+1))
         {
             if ((position == heropostion)){
                 Action ret(ActionType::Attack, dirtoact[ori]);
@@ -122,7 +156,7 @@ Action attack(const Character& monster, const std::vector<std::shared_ptr<Entity
                 // Then do the first move to go toward him.
                 return ret;
             //else if the path is valid.
-            if ((map.cellAt(position.x,position.y) == CellType::Floor)
+            if (is_floor(floors, position, startposition, sight+1)
                 && (depth < sight)
                 && (!cell_seen(seen,position, startposition, sight)))
             {
@@ -162,6 +196,9 @@ Action getclose(const Character& monster, const std::vector<std::shared_ptr<Enti
     std::vector<std::vector<bool>> seen(sightperimeter, std::vector<bool>(sightperimeter,false) );
     thereisaobstacle(entities,seen,startposition,sight);
 
+    // The BFS reads cells up to one step further than the sight.
+    std::vector<bool> floors = floor_grid(map, startposition, sight+1);
+
 
     //Initiate of the structures used in the graph BFS.
     sf::Vector2i curentposition = startposition;
@@ -180,7 +217,7 @@ Action getclose(const Character& monster, const std::vector<std::shared_ptr<Enti
     for(auto ori : dir)
     {
         sf::Vector2i position = curentposition + ori;
-        if (map.cellAt(position.x,position.y)==CellType::Floor)
+        if (is_floor(floors, position, startposition, sight+1))
         {
             if ((position == heropostion)){
                 return just_moving();  // The monster is at direct contact with the hero.
@@ -217,7 +254,7 @@ Action getclose(const Character& monster, const std::vector<std::shared_ptr<Enti
                 // Then do the first move to go toward him.
                 return ret;
             //else if the path is valid.
-            if ((map.cellAt(position.x,position.y) == CellType::Floor)
+            if (is_floor(floors, position, startposition, sight+1)
                 && (depth < sight)
                 && (!cell_seen(seen,position, startposition, sight)))
             {
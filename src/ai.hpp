@@ -23,6 +23,24 @@
 
 struct Action;
 
+/**
+ * \brief Copy which cells are floors in a square of the map, reading it chunk by chunk.
+ * \param map The map.
+ * \param startposition the cell at the middle of the square.
+ * \param radius the radius of the square from the start position.
+ * \return The matrix of floors, row by row.
+ */
+std::vector<bool> floor_grid(const Map& map, sf::Vector2i startposition, int radius);
+
+/**
+ * \brief Return weather a cell is a floor according to a matrix built by floor_grid.
+ * \param floors The matrix of floors.
+ * \param position the cell we check, it must be in the square.
+ * \param startposition the cell at the middle of the square.
+ * \param radius the radius of the square from the start position.
+ */
+bool is_floor(const std::vector<bool>& floors, sf::Vector2i position, sf::Vector2i startposition, int radius);
+
 /**
  * \brief Return weather a cell was seen according to the matrix seen, and say that now it has been seen.
  * \param seen The matrix saving weather a cell was seen.
@@ -0,0 +1,268 @@
+/**
+ * \file bit_chunk.hpp
+ * \brief Representation of chunks as bit planes, and neighbourhood queries on them.
+ */
+
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+
+#include "chunk.hpp"
+#include "utility.hpp"
+
+
+/**
+ * \brief Smallest unsigned integer type which holds a row of cells of a chunk.
+ * \param Size Width of the chunks.
+ */
+template <int Size>
+struct BitRow;
+
+template <>
+struct BitRow<4> { typedef uint8_t type; };
+
+template <>
+struct BitRow<8> { typedef uint8_t type; };
+
+template <>
+struct BitRow<16> { typedef uint16_t type; };
+
+template <>
+struct BitRow<32> { typedef uint32_t type; };
+
+template <>
+struct BitRow<64> { typedef uint64_t type; };
+
+/**
+ * \brief Represents a section of the map with one bit per cell for each type of cell.
+ * \param Size Width and height of the chunk.
+ *
+ * \section Layout
+ *   A plane stores a boolean property of the cells of a chunk: it is an array of rows where the bit
+ *   `x` of the row `y` is the property of the cell `(x, y)`.
+ *   The chunk has a plane telling which cells are floors and another one telling which cells are walls.
+ *
+ *   Queries about the neighbourhood of cells are computed on whole rows using shifts and bitwise
+ *   operations, thus for every cells of a chunk at once.
+ */
+template <int Size>
+class BitChunk
+{
+public:
+    typedef typename BitRow<Size>::type Row; ///< A row of bits
+    typedef std::array<Row, Size> Plane;     ///< A boolean property of each cell of a chunk
+
+    constexpr static Row FULL = static_cast<Row>(~UINT64_C(0) >> (64 - Size)); ///< Row with every bits set
+
+    /**
+     * \brief Create a chunk full of empty cells.
+     */
+    BitChunk();
+
+    /**
+     * \brief Create the bit planes of a chunk.
+     * \param chunk The chunk to convert.
+     */
+    explicit BitChunk(const BasicChunk<Size>& chunk);
+
+    /**
+     * \brief Get the type of a cell.
+     * `x` and `y` must be in the ranges `[0, SIZE)` and `[0, SIZE)`
+     */
+    CellType cellAt(int x, int y) const;
+
+    /**
+     * \brief Set the type of a cell.
+     * `x` and `y` must be in the ranges `[0, SIZE)` and `[0, SIZE)`
+     */
+    void setCell(int x, int y, CellType type);
+
+    /**
+     * \brief Plane of the cells which are floors.
+     */
+    const Plane& floors() const;
+
+    /**
+     * \brief Plane of the cells which are walls.
+     */
+    const Plane& walls() const;
+
+    /**
+     * \brief Get the bit of a cell in a plane.
+     */
+    static bool test(const Plane& plane, int x, int y);
+
+    /**
+     * \brief Move a plane so that each cell gets the bit of its neighbour.
+     * \param center The plane to move.
+     * \param next The plane of the chunk next to `center` in the direction `dir`.
+     * \param dir Direction of the neighbour, Up, Down, Left or Right.
+     * \return A plane where the bit of a cell is the bit of the cell next to it in the direction `dir`.
+     */
+    static Plane neighbours(const Plane& center, const Plane& next, Direction dir);
+
+    /**
+     * \brief Set the bit of cells which are next to a set bit.
+     * \param block Planes of a block of 3x3 chunks, row by row, the chunk to compute being the center.
+     * \return A plane where the bit of a cell is set if it is set for the cell or one of its 8 neighbours.
+     */
+    static Plane dilate(const std::array<const Plane*, 9>& block);
+
+private:
+    Plane floor_plane; ///< Bits of the floors
+    Plane wall_plane;  ///< Bits of the walls
+};
+
+/**
+ * \brief Neighbourhood of each cell of a chunk.
+ * \param Size Width and height of the chunk.
+ *
+ * Arrays indexed by direction follow the order of `directions`.
+ */
+template <int Size>
+struct ChunkMasks
+{
+    typedef typename BitChunk<Size>::Plane Plane; ///< A boolean property of each cell of a chunk
+
+    Plane wall_next;                   ///< Cells with a wall next to them or on them, as Map::wallNext
+    Plane floor_next;                  ///< Cells with a floor next to them or on them
+    std::array<Plane, 4> floor_at;     ///< Cells whose neighbour in the direction is a floor
+    std::array<Plane, 4> wall_next_at; ///< Cells whose neighbour in the direction has a wall next to it
+};
+
+
+template <int Size>
+constexpr typename BitChunk<Size>::Row BitChunk<Size>::FULL;
+
+template <int Size>
+inline BitChunk<Size>::BitChunk()
+{
+    floor_plane.fill(0);
+    wall_plane.fill(0);
+}
+
+template <int Size>
+BitChunk<Size>::BitChunk(const BasicChunk<Size>& chunk) :
+    BitChunk()
+{
+    for (int y = 0 ; y < Size ; y++)
+    {
+        for (int x = 0 ; x < Size ; x++)
+        {
+            CellType type = chunk.cellAt(x, y);
+            floor_plane[y] |= static_cast<Row>(static_cast<Row>(type == CellType::Floor) << x);
+            wall_plane[y] |= static_cast<Row>(static_cast<Row>(type == CellType::Wall) << x);
+        }
+    }
+}
+
+template <int Size>
+inline CellType BitChunk<Size>::cellAt(int x, int y) const
+{
+    assert(x >= 0 && x < Size);
+    assert(y >= 0 && y < Size);
+
+    if (test(floor_plane, x, y))
+        return CellType::Floor;
+    if (test(wall_plane, x, y))
+        return CellType::Wall;
+
+    return CellType::Empty;
+}
+
+template <int Size>
+inline void BitChunk<Size>::setCell(int x, int y, CellType type)
+{
+    assert(x >= 0 && x < Size);
+    assert(y >= 0 && y < Size);
+
+    Row bit = static_cast<Row>(Row(1) << x);
+    floor_plane[y] = static_cast<Row>(type == CellType::Floor ? floor_plane[y] | bit : floor_plane[y] & ~bit);
+    wall_plane[y] = static_cast<Row>(type == CellType::Wall ? wall_plane[y] | bit : wall_plane[y] & ~bit);
+}
+
+template <int Size>
+inline const typename BitChunk<Size>::Plane& BitChunk<Size>::floors() const
+{
+    return floor_plane;
+}
+
+template <int Size>
+inline const typename BitChunk<Size>::Plane& BitChunk<Size>::walls() const
+{
+    return wall_plane;
+}
+
+template <int Size>
+inline bool BitChunk<Size>::test(const Plane& plane, int x, int y)
+{
+    return (plane[y] >> x) & 1;
+}
+
+template <int Size>
+typename BitChunk<Size>::Plane BitChunk<Size>::neighbours(const Plane& center, const Plane& next, Direction dir)
+{
+    Plane result;
+
+    switch (dir)
+    {
+        case Direction::Up:
+            result[0] = next[Size - 1];
+            for (int y = 1 ; y < Size ; y++)
+                result[y] = center[y - 1];
+            break;
+
+        case Direction::Down:
+            for (int y = 0 ; y < Size - 1 ; y++)
+                result[y] = center[y + 1];
+            result[Size - 1] = next[0];
+            break;
+
+        // The cell x gets the bit x - 1, the first one gets the last bit of the chunk on the left
+        case Direction::Left:
+            for (int y = 0 ; y < Size ; y++)
+                result[y] = static_cast<Row>(((center[y] << 1) | (next[y] >> (Size - 1))) & FULL);
+            break;
+
+        // The cell x gets the bit x + 1, the last one gets the first bit of the chunk on the right
+        case Direction::Right:
+            for (int y = 0 ; y < Size ; y++)
+                result[y] = static_cast<Row>((center[y] >> 1) | ((next[y] & 1) << (Size - 1)));
+            break;
+
+        default:
+            assert(false);
+            result = center;
+            break;
+    }
+
+    return result;
+}
+
+template <int Size>
+typename BitChunk<Size>::Plane BitChunk<Size>::dilate(const std::array<const Plane*, 9>& block)
+{
+    // Dilate horizontally each row of chunks, then the center one vertically
+    std::array<Plane, 3> rows;
+
+    for (int j = 0 ; j < 3 ; j++)
+    {
+        const Plane& center = *block[3 * j + 1];
+        Plane left = neighbours(center, *block[3 * j], Direction::Left);
+        Plane right = neighbours(center, *block[3 * j + 2], Direction::Right);
+
+        for (int y = 0 ; y < Size ; y++)
+            rows[j][y] = static_cast<Row>(center[y] | left[y] | right[y]);
+    }
+
+    Plane up = neighbours(rows[1], rows[0], Direction::Up);
+    Plane down = neighbours(rows[1], rows[2], Direction::Down);
+    Plane result;
+
+    for (int y = 0 ; y < Size ; y++)
+        result[y] = static_cast<Row>(rows[1][y] | up[y] | down[y]);
+
+    return result;
+}
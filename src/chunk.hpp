@@ -0,0 +1,172 @@
+/**
+ * \file chunk.hpp
+ * \brief Representation of chunks, the sections of maps.
+ */
+
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+
+
+#ifndef CHUNK_SIZE
+    #define CHUNK_SIZE 4 ///< Width and height of the chunks, can be set at compile time with -DCHUNK_SIZE
+#endif
+
+static_assert(CHUNK_SIZE == 4 || CHUNK_SIZE == 8 || CHUNK_SIZE == 16 || CHUNK_SIZE == 32 || CHUNK_SIZE == 64,
+              "CHUNK_SIZE must be one of the sizes instantiated in map.cpp");
+
+
+/**
+ * \brief Static information about the behaviour of the cell
+ */
+enum class CellType : uint8_t
+{
+    Empty = 0, ///< A cell that can't contain anything
+    Floor = 1, ///< A cell you can walk on
+    Wall  = 2  ///< A wall
+};
+
+/**
+ * \brief Represents a section of the map.
+ * \param Size Width and height of the chunk, it must be a power of two.
+ *
+ * As the size is a power of two, finding the chunk of a cell only needs shifts and masks.
+ */
+template <int Size>
+class BasicChunk
+{
+    static_assert(Size > 0 && (Size & (Size - 1)) == 0, "The size of a chunk must be a power of two");
+
+public:
+    constexpr static int SIZE = Size; ///< width and height of the chunks.
+    constexpr static int SHIFT = Size == 1 ? 0 : 1 + BasicChunk<Size / 2>::SHIFT; ///< log2(SIZE)
+
+    /**
+     * \brief Create a chunk full of empty cells.
+     */
+    BasicChunk();
+
+    /**
+     * \brief Get a read-write access to a cell by its coordinates
+     * \param x X coordinate of the cell
+     * \param y Y coordinate of the cell
+     * \return Reference to the cell
+     * `x` and `y` must be in the ranges `[0, SIZE)` and `[0, SIZE)`
+     */
+    CellType& cellAt(int x, int y);
+
+    /**
+     * \brief Get a read only access to a cell by its coordinates
+     * \param x X coordinate of the cell
+     * \param y Y coordinate of the cell
+     * \return The cell type of the cell
+     * `x` and `y` must be in the ranges `[0, SIZE)` and `[0, SIZE)`
+     */
+    CellType cellAt(int x, int y) const;
+
+    /**
+     * \brief Get the cells of a row of the chunk.
+     * \param y Y coordinate of the row, in the range `[0, SIZE)`
+     * \return A pointer to the `SIZE` cells of the row, from left to right.
+     */
+    const CellType* rowAt(int y) const;
+
+    /**
+     * \brief Get the coordinates of the chunk which contains a given cell.
+     * \param x X coordinate of the cell in the map
+     * \param y Y coordinate of the cell in the map
+     * \return A pair containing the coordinates of the chunk.
+     */
+    static std::pair<int, int> sector(int x, int y);
+
+    /**
+     * \brief Get the coordinates corresponding to a given cell, in its chunk.
+     * \param x X coordinate of the cell in the map
+     * \param y Y coordinate of the cell in the map
+     * \return A pair containing the coordinates of the cell in the chunk.
+     */
+    static std::pair<int, int> relative(int x, int y);
+
+    /**
+     * \brief Get the number of chunks needed to cover a distance.
+     * \param cells A distance in cells.
+     * \return The smallest number of chunks whose width is at least `cells`.
+     */
+    static int chunk_span(int cells);
+
+private:
+    std::array<CellType, Size*Size> cells; ///< The type of each cells in the chunk, row by row
+};
+
+/**
+ * \brief End of the recursion used to compute BasicChunk::SHIFT.
+ */
+template <>
+class BasicChunk<0>
+{
+public:
+    constexpr static int SHIFT = -1;
+};
+
+template <int Size>
+constexpr int BasicChunk<Size>::SIZE;
+
+template <int Size>
+constexpr int BasicChunk<Size>::SHIFT;
+
+template <int Size>
+inline BasicChunk<Size>::BasicChunk()
+{
+    cells.fill(CellType::Empty);
+}
+
+template <int Size>
+inline CellType& BasicChunk<Size>::cellAt(int x, int y)
+{
+    assert(x >= 0 && x < SIZE);
+    assert(y >= 0 && y < SIZE);
+
+    return cells[x + (y << SHIFT)];
+}
+
+template <int Size>
+inline CellType BasicChunk<Size>::cellAt(int x, int y) const
+{
+    assert(x >= 0 && x < SIZE);
+    assert(y >= 0 && y < SIZE);
+
+    return cells[x + (y << SHIFT)];
+}
+
+template <int Size>
+inline const CellType* BasicChunk<Size>::rowAt(int y) const
+{
+    assert(y >= 0 && y < SIZE);
+
+    return &cells[y << SHIFT];
+}
+
+template <int Size>
+inline std::pair<int, int> BasicChunk<Size>::sector(int x, int y)
+{
+    // Right shifts of negative numbers are arithmetic with supported compilers
+    return {x >> SHIFT, y >> SHIFT};
+}
+
+template <int Size>
+inline std::pair<int, int> BasicChunk<Size>::relative(int x, int y)
+{
+    return {x & (Size - 1), y & (Size - 1)};
+}
+
+template <int Size>
+inline int BasicChunk<Size>::chunk_span(int cells)
+{
+    assert(cells >= 0);
+    return (cells + Size - 1) >> SHIFT;
+}
+
+typedef BasicChunk<CHUNK_SIZE> Chunk; ///< Chunks used by the game
@@ -0,0 +1,302 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <utility>
+
+#include "chunk_pager.hpp"
+
+
+constexpr size_t ChunkPager::MAX_EVICTIONS;
+
+/**
+ * \brief Check if an entity must stay in the level when its chunk is paged.
+ */
+static bool is_pinned(const Entity& entity)
+{
+    return entity.getType() == EntityType::Hero || entity.getType() == EntityType::Stairs;
+}
+
+double PagerStats::faultRate() const
+{
+    if (lookups == 0)
+        return 0.;
+
+    return static_cast<double>(faults) / static_cast<double>(lookups);
+}
+
+ChunkPager::ChunkPager(const std::string& page_path) :
+    path(page_path),
+    file_size(0),
+    use_clock(0)
+{}
+
+ChunkPager::~ChunkPager()
+{
+    if (file.is_open())
+    {
+        file.close();
+        std::remove(path.c_str());
+    }
+}
+
+void ChunkPager::touch(int x, int y)
+{
+    last_use.insert(x, y, ++use_clock);
+}
+
+size_t ChunkPager::evict(Map& map, std::vector<std::shared_ptr<Entity>>& entities, sf::Vector2i center, int distance)
+{
+    std::vector<std::pair<int, int>> resident = map.getChunks();
+
+    stats.resident_chunks = resident.size();
+    stats.resident_bytes = resident.size() * sizeof(Map::Chunk);
+
+    if (distance <= 0)
+        return 0;
+
+    // Chunks out of the square of side 2 * span + 1 around the hero, by last use
+    auto hero = Chunk::sector(center.x, center.y);
+    int span = Chunk::chunk_span(distance);
+    std::vector<std::pair<uint64_t, std::pair<int, int>>> candidates;
+
+    for (const auto& chunk : resident)
+    {
+        if (std::abs(chunk.first - hero.first) <= span && std::abs(chunk.second - hero.second) <= span)
+            continue;
+
+        const uint64_t* used = last_use.find(chunk.first, chunk.second);
+        candidates.push_back({used == nullptr ? 0 : *used, chunk});
+    }
+
+    if (candidates.empty() || !open())
+        return 0;
+
+    if (candidates.size() > MAX_EVICTIONS)
+    {
+        std::nth_element(candidates.begin(), candidates.begin() + MAX_EVICTIONS, candidates.end());
+        candidates.resize(MAX_EVICTIONS);
+    }
+
+    // Gather the entities of the evicted chunks in a single pass
+    ChunkTable<std::vector<std::shared_ptr<Entity>>> evicted_entities;
+    for (const auto& candidate : candidates)
+        evicted_entities.insert(candidate.second.first, candidate.second.second, {});
+
+    for (const auto& entity : entities)
+    {
+        auto position = entity->getPosition();
+        auto chunk = Chunk::sector(position.x, position.y);
+        auto* evicted = evicted_entities.find(chunk.first, chunk.second);
+
+        if (evicted != nullptr && !is_pinned(*entity))
+            evicted->push_back(entity);
+    }
+
+    // Append a record for each chunk, the level keeps them until every record is written
+    std::vector<Record> written;
+    uint64_t end = file_size;
+
+    file.clear();
+    file.seekp(static_cast<std::streamoff>(file_size));
+
+    for (const auto& candidate : candidates)
+    {
+        int x = candidate.second.first;
+        int y = candidate.second.second;
+        const auto& chunk_entities = *evicted_entities.find(x, y);
+        uint32_t n_entities = static_cast<uint32_t>(chunk_entities.size());
+
+        file.write(reinterpret_cast<const char*>(map.findChunk(x, y)), sizeof(Map::Chunk));
+        file.write(reinterpret_cast<const char*>(&n_entities), sizeof(uint32_t));
+        for (const auto& entity : chunk_entities)
+            file << entity;
+
+        uint64_t start = end;
+        end = static_cast<uint64_t>(file.tellp());
+        written.push_back(Record{start, end - start, map.isDirty(x, y)});
+    }
+
+    // The disk may be full, the records are overwritten by the next eviction
+    file.flush();
+    if (!file.good())
+    {
+        file.clear();
+        return 0;
+    }
+
+    for (size_t i = 0 ; i < candidates.size() ; i++)
+    {
+        int x = candidates[i].second.first;
+        int y = candidates[i].second.second;
+
+        map.extractChunk(x, y);
+        records.insert(x, y, written[i]);
+        stats.live_bytes += written[i].length;
+        last_use.erase(x, y);
+    }
+    file_size = end;
+
+    entities.erase(std::remove_if(entities.begin(), entities.end(), [&evicted_entities](const std::shared_ptr<Entity>& entity)
+    {
+        auto position = entity->getPosition();
+        auto chunk = Chunk::sector(position.x, position.y);
+        return evicted_entities.contains(chunk.first, chunk.second) && !is_pinned(*entity);
+    }), entities.end());
+
+    stats.evictions += candidates.size();
+    stats.resident_chunks -= candidates.size();
+    stats.resident_bytes = stats.resident_chunks * sizeof(Map::Chunk);
+    updateFileStats();
+
+    return candidates.size();
+}
+
+bool ChunkPager::contains(int x, int y) const
+{
+    return records.contains(x, y);
+}
+
+bool ChunkPager::pageIn(int x, int y, Map& map, std::vector<std::shared_ptr<Entity>>& entities)
+{
+    stats.lookups++;
+
+    const Record* record = records.find(x, y);
+    if (record == nullptr)
+        return false;
+
+    Map::Chunk chunk;
+    uint32_t n_entities = 0;
+    std::vector<std::shared_ptr<Entity>> chunk_entities;
+
+    file.clear();
+    file.seekg(static_cast<std::streamoff>(record->offset));
+    file.read(reinterpret_cast<char*>(&chunk), sizeof(Map::Chunk));
+    file.read(reinterpret_cast<char*>(&n_entities), sizeof(uint32_t));
+
+    for (uint32_t i = 0 ; i < n_entities && file ; i++)
+    {
+        std::shared_ptr<Entity> entity;
+        file >> entity;
+        chunk_entities.push_back(std::move(entity));
+    }
+
+    // The chunk stays in the page file if it can't be read back
+    if (!file)
+    {
+        file.clear();
+        return false;
+    }
+
+    entities.insert(entities.end(), std::make_move_iterator(chunk_entities.begin()), std::make_move_iterator(chunk_entities.end()));
+    map.setChunk(x, y, std::move(chunk));
+    if (!record->dirty)
+        map.markClean(x, y);
+
+    stats.live_bytes -= record->length;
+    records.erase(x, y);
+    stats.faults++;
+
+    // The records are rewritten when most of the file is unused
+    if (2 * stats.live_bytes < file_size)
+        compact();
+
+    updateFileStats();
+
+    return true;
+}
+
+void ChunkPager::pageInAll(Map& map, std::vector<std::shared_ptr<Entity>>& entities)
+{
+    std::vector<std::pair<int, int>> paged;
+
+    for (size_t i = 0 ; i < records.size() ; i++)
+        paged.push_back(records.idAt(i));
+
+    for (const auto& chunk : paged)
+        pageIn(chunk.first, chunk.second, map, entities);
+}
+
+void ChunkPager::pageInDirty(Map& map, std::vector<std::shared_ptr<Entity>>& entities)
+{
+    std::vector<std::pair<int, int>> dirty;
+
+    for (size_t i = 0 ; i < records.size() ; i++)
+        if (records.valueAt(i).dirty)
+            dirty.push_back(records.idAt(i));
+
+    for (const auto& chunk : dirty)
+        pageIn(chunk.first, chunk.second, map, entities);
+}
+
+const PagerStats& ChunkPager::getStats() const
+{
+    return stats;
+}
+
+bool ChunkPager::open()
+{
+    if (file.is_open())
+        return true;
+
+    file.open(path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+    file_size = 0;
+
+    return file.is_open();
+}
+
+void ChunkPager::compact()
+{
+    const std::string new_path = path + ".new";
+    std::ofstream new_file {new_path, std::ios::binary | std::ios::trunc};
+
+    if (!new_file)
+        return;
+
+    std::vector<char> buffer;
+    std::vector<uint64_t> offsets;
+    uint64_t offset = 0;
+
+    for (size_t i = 0 ; i < records.size() && file && new_file ; i++)
+    {
+        const Record& record = records.valueAt(i);
+
+        buffer.resize(record.length);
+        file.seekg(static_cast<std::streamoff>(record.offset));
+        file.read(buffer.data(), static_cast<std::streamsize>(record.length));
+        new_file.write(buffer.data(), static_cast<std::streamsize>(record.length));
+
+        offsets.push_back(offset);
+        offset += record.length;
+    }
+
+    new_file.close();
+
+    // The records stay where they are until the new file replaces the old one
+    if (!file || !new_file)
+    {
+        file.clear();
+        std::remove(new_path.c_str());
+        return;
+    }
+
+    file.close();
+    if (std::rename(new_path.c_str(), path.c_str()) != 0)
+    {
+        std::remove(new_path.c_str());
+        file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+        return;
+    }
+
+    for (size_t i = 0 ; i < records.size() ; i++)
+        records.valueAt(i).offset = offsets[i];
+
+    file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+    file_size = offset;
+}
+
+void ChunkPager::updateFileStats()
+{
+    stats.paged_chunks = records.size();
+    stats.file_bytes = file_size;
+}
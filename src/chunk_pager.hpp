@@ -0,0 +1,166 @@
+/**
+ * \file chunk_pager.hpp
+ * \brief Move chunks of a map which are far from the hero to a file, and get them back when needed.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <SFML/System/Vector2.hpp>
+
+#include "chunk_table.hpp"
+#include "entity.hpp"
+#include "map.hpp"
+
+
+/**
+ * \brief Counters describing the memory used by a map and the activity of its pager.
+ */
+struct PagerStats
+{
+    size_t resident_chunks = 0; ///< Chunks of the map in memory, as of the last eviction
+    size_t resident_bytes = 0;  ///< Memory used by the cells of these chunks
+    size_t paged_chunks = 0;    ///< Chunks stored in the page file
+    size_t file_bytes = 0;      ///< Size of the page file, including space not reused yet
+    size_t live_bytes = 0;      ///< Size of the records of the page file which are still used
+
+    uint64_t evictions = 0; ///< Number of chunks written to the page file
+    uint64_t lookups = 0;   ///< Number of missing chunks asked to the pager
+    uint64_t faults = 0;    ///< Number of these chunks which were read back from the page file
+
+    /**
+     * \brief Proportion of the missing chunks which had been paged out, the others being generated.
+     */
+    double faultRate() const;
+};
+
+/**
+ * \brief Pages the chunks of a level, with their entities, to a file.
+ *
+ * \section Behaviour
+ *   Chunks are evicted when they are further than a given distance from the hero, the least recently
+ *   used ones first. A chunk is used when it is in the area loaded around the hero (see touch).
+ *   The cells of an evicted chunk and the entities standing on it are appended to the page file and
+ *   removed from the level, they are given back by pageIn when the hero comes back.
+ *   A chunk is only removed from the level once its record is written, and it stays in the page file
+ *   if its record can't be read back, so that a failure of the disk doesn't lose it.
+ *   Chunks keep the dirty state they had in the map, so that a save doesn't need to write them again.
+ *
+ *   Space left in the file by chunks which were paged in is reused by rewriting the whole file when
+ *   it is more than half unused.
+ *
+ *   The hero and the stairs are never paged, since the game looks for them in the whole level.
+ *
+ * \note The page file is created on the first eviction and removed with the pager.
+ */
+class ChunkPager
+{
+public:
+    static constexpr size_t MAX_EVICTIONS = 64; ///< Maximum number of chunks evicted by a call to evict
+
+    /**
+     * \brief Create a pager with no chunk.
+     * \param page_path Path of the page file.
+     */
+    explicit ChunkPager(const std::string& page_path);
+
+    ChunkPager(const ChunkPager&) = delete;
+    ChunkPager& operator=(const ChunkPager&) = delete;
+
+    /**
+     * \brief Remove the page file.
+     */
+    ~ChunkPager();
+
+    /**
+     * \brief Mark a chunk as used now.
+     * \param x x-coordinate of the chunk.
+     * \param y y-coordinate of the chunk.
+     */
+    void touch(int x, int y);
+
+    /**
+     * \brief Move the chunks far from the hero to the page file.
+     * \param map The map of the level.
+     * \param entities The entities of the level.
+     * \param center The position of the hero.
+     * \param distance Distance, in cells, beyond which chunks are evicted, 0 to keep every chunks.
+     * \return The number of chunks evicted, 0 if their records couldn't be written.
+     */
+    size_t evict(Map& map, std::vector<std::shared_ptr<Entity>>& entities, sf::Vector2i center, int distance);
+
+    /**
+     * \brief Check if a chunk is in the page file.
+     */
+    bool contains(int x, int y) const;
+
+    /**
+     * \brief Put back a chunk and its entities in the level if it was paged out.
+     * \param x x-coordinate of the chunk.
+     * \param y y-coordinate of the chunk.
+     * \param map The map of the level.
+     * \param entities The entities of the level.
+     * \return true if the chunk was put back, false if it wasn't in the page file or its record couldn't be read.
+     *
+     * The chunk is counted as a lookup, and as a fault if it was found.
+     */
+    bool pageIn(int x, int y, Map& map, std::vector<std::shared_ptr<Entity>>& entities);
+
+    /**
+     * \brief Put back every chunks in the level, before saving it for instance.
+     */
+    void pageInAll(Map& map, std::vector<std::shared_ptr<Entity>>& entities);
+
+    /**
+     * \brief Put back the chunks which were dirty in the map when they were paged out.
+     */
+    void pageInDirty(Map& map, std::vector<std::shared_ptr<Entity>>& entities);
+
+    /**
+     * \brief Get the counters of the pager.
+     */
+    const PagerStats& getStats() const;
+
+private:
+    /**
+     * \brief Position of the record of a chunk in the page file.
+     */
+    struct Record
+    {
+        uint64_t offset; ///< Position of the first byte of the record
+        uint64_t length; ///< Number of bytes of the record
+        bool dirty;      ///< The chunk was dirty in the map, see Map::isDirty
+    };
+
+    /**
+     * \brief Open the page file if it isn't already.
+     */
+    bool open();
+
+    /**
+     * \brief Rewrite the page file with only the records which are used.
+     *
+     * The page file is left as it is if the new one can't be written.
+     */
+    void compact();
+
+    /**
+     * \brief Update the counters about the page file.
+     */
+    void updateFileStats();
+
+    std::string path;     ///< Path of the page file
+    std::fstream file;    ///< The page file, opened on the first eviction
+    uint64_t file_size;   ///< Position where the next record is written
+
+    ChunkTable<Record> records;    ///< Records of the paged chunks
+    ChunkTable<uint64_t> last_use; ///< Clock value of the last use of each chunk
+    uint64_t use_clock;            ///< Incremented by each call to touch
+
+    PagerStats stats; ///< Counters of the pager
+};
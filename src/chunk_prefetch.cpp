@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "chunk_prefetch.hpp"
+
+
+constexpr int ChunkPrefetcher::MAX_LEAD;
+
+/**
+ * \brief Weight of the last move in the averages of the prefetcher.
+ */
+static constexpr double MOVE_WEIGHT = 0.5;
+
+/**
+ * \brief Minimal length of the average move for the hero to have a heading.
+ */
+static constexpr double MIN_HEADING = 0.5;
+
+/**
+ * \brief A coordinate of a move is kept in the heading if it is larger than this part of the move (cos 67.5°).
+ */
+static constexpr double HEADING_COMPONENT = 0.38;
+
+double PrefetchStats::waitsPerThousandTurns() const
+{
+    if (turns == 0)
+        return 0.;
+
+    return 1000. * static_cast<double>(waits) / static_cast<double>(turns);
+}
+
+ChunkPrefetcher::ChunkPrefetcher() :
+    has_chunk(false),
+    last_chunk(0, 0),
+    last_turn(0),
+    last_filled(0),
+    heading_x(0.),
+    heading_y(0.),
+    speed(0.),
+    rate(0.)
+{}
+
+void ChunkPrefetcher::reset()
+{
+    has_chunk = false;
+    heading_x = heading_y = 0.;
+    speed = rate = 0.;
+    stats.lead = 0;
+}
+
+void ChunkPrefetcher::turn()
+{
+    stats.turns++;
+}
+
+void ChunkPrefetcher::cross(std::pair<int, int> chunk, uint64_t filled, bool busy)
+{
+    if (has_chunk && chunk != last_chunk)
+    {
+        int dx = chunk.first - last_chunk.first;
+        int dy = chunk.second - last_chunk.second;
+        double turns = static_cast<double>(std::max<uint64_t>(stats.turns - last_turn, 1));
+
+        heading_x += MOVE_WEIGHT * (dx - heading_x);
+        heading_y += MOVE_WEIGHT * (dy - heading_y);
+        speed += MOVE_WEIGHT * (std::max(std::abs(dx), std::abs(dy)) / turns - speed);
+
+        // An idle generation would look slow
+        if (busy && filled >= last_filled)
+        {
+            double filled_rate = static_cast<double>(filled - last_filled) / turns;
+            rate = rate == 0. ? filled_rate : rate + MOVE_WEIGHT * (filled_rate - rate);
+        }
+
+        stats.crossings++;
+    }
+
+    has_chunk = true;
+    last_chunk = chunk;
+    last_turn = stats.turns;
+    last_filled = filled;
+}
+
+void ChunkPrefetcher::wait()
+{
+    stats.waits++;
+}
+
+void ChunkPrefetcher::stream()
+{
+    stats.streamed++;
+}
+
+void ChunkPrefetcher::miss()
+{
+    stats.misses++;
+}
+
+ChunkArea ChunkPrefetcher::area(int radius)
+{
+    ChunkArea square {
+        last_chunk.first - radius, last_chunk.second - radius,
+        last_chunk.first + radius, last_chunk.second + radius
+    };
+
+    auto heading = getHeading();
+    stats.lead = heading == std::make_pair(0, 0) ? 0 : lead(2 * radius + 1);
+    int extra = stats.lead;
+
+    if (heading.first < 0)
+        square.x_min -= extra;
+    else if (heading.first > 0)
+        square.x_max += extra;
+
+    if (heading.second < 0)
+        square.y_min -= extra;
+    else if (heading.second > 0)
+        square.y_max += extra;
+
+    return square;
+}
+
+std::pair<int, int> ChunkPrefetcher::getHeading() const
+{
+    double length = std::hypot(heading_x, heading_y);
+    if (length < MIN_HEADING)
+        return {0, 0};
+
+    auto component = [length](double value) {
+        if (std::abs(value) < HEADING_COMPONENT * length)
+            return 0;
+        return value < 0. ? -1 : 1;
+    };
+
+    return {component(heading_x), component(heading_y)};
+}
+
+std::pair<int, int> ChunkPrefetcher::getFocus() const
+{
+    auto heading = getHeading();
+    return {last_chunk.first + heading.first, last_chunk.second + heading.second};
+}
+
+const PrefetchStats& ChunkPrefetcher::getStats() const
+{
+    return stats;
+}
+
+int ChunkPrefetcher::lead(int side) const
+{
+    if (speed <= 0.)
+        return 0;
+
+    // The speed of a generation never measured is unknown, the hero may be faster
+    if (rate <= 0.)
+        return MAX_LEAD;
+
+    double chunks = std::ceil(speed * side / rate);
+    return static_cast<int>(std::min(chunks, static_cast<double>(MAX_LEAD)));
+}
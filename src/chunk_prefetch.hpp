@@ -0,0 +1,135 @@
+/**
+ * \file chunk_prefetch.hpp
+ * \brief Choose the chunks generated in advance from the movements of the hero.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <utility>
+
+
+/**
+ * \brief Counters describing the movements of the hero and the waits for the generation.
+ */
+struct PrefetchStats
+{
+    uint64_t turns = 0;     ///< Turns played by the hero
+    uint64_t crossings = 0; ///< Chunks entered by the hero
+    uint64_t waits = 0;     ///< Loads of chunks which waited for the generation
+    uint64_t streamed = 0;  ///< Chunks added to the level before the hero came close to them
+    uint64_t misses = 0;    ///< Chunks taken from the generation when the hero came close to them
+    int lead = 0;           ///< Chunks generated ahead of the hero, as of the last crossing
+
+    /**
+     * \brief Number of loads which waited for the generation every 1000 turns.
+     */
+    double waitsPerThousandTurns() const;
+};
+
+/**
+ * \brief Rectangle of chunks, bounds included.
+ */
+struct ChunkArea
+{
+    int x_min; ///< x-coordinate of the chunks on the left
+    int y_min; ///< y-coordinate of the chunks on the top
+    int x_max; ///< x-coordinate of the chunks on the right
+    int y_max; ///< y-coordinate of the chunks on the bottom
+};
+
+/**
+ * \brief Extends the square of chunks generated around the hero towards the direction it walks to.
+ *
+ * \section Behaviour
+ *   The heading is the average of the last moves between chunks, recent moves weighting more. The square
+ *   is extended on the sides the heading points to, by a lead which grows with the speed of the hero
+ *   and shrinks with the speed of the generation: it is the number of chunks the hero walks through while
+ *   the generation fills a side of the square. Both speeds are measured in chunks per turn, the speed
+ *   of the generation only while it has chunks to generate.
+ *
+ *   A hero which comes and goes has no heading, and the square isn't extended.
+ */
+class ChunkPrefetcher
+{
+public:
+    static constexpr int MAX_LEAD = 8; ///< Maximum number of chunks added ahead of the hero
+
+    /**
+     * \brief Create a prefetcher knowing no movement.
+     */
+    ChunkPrefetcher();
+
+    /**
+     * \brief Forget the movements of the hero, when it changes level for instance. Counters are kept.
+     */
+    void reset();
+
+    /**
+     * \brief Count a turn of the hero.
+     */
+    void turn();
+
+    /**
+     * \brief Tell that the hero entered a chunk.
+     * \param chunk Coordinates of the chunk.
+     * \param filled Number of chunks filled so far by the generation of the level.
+     * \param busy Wether the generation has chunks waiting to be generated.
+     */
+    void cross(std::pair<int, int> chunk, uint64_t filled, bool busy);
+
+    /**
+     * \brief Count a load of chunks which waited for the generation.
+     */
+    void wait();
+
+    /**
+     * \brief Count a chunk added to the level in advance.
+     */
+    void stream();
+
+    /**
+     * \brief Count a chunk which wasn't in the level when the hero came close to it.
+     */
+    void miss();
+
+    /**
+     * \brief Get the chunks to generate around the last chunk entered, the lead is kept in the counters.
+     * \param radius Radius of the square generated whatever the heading.
+     */
+    ChunkArea area(int radius);
+
+    /**
+     * \brief Get the direction of the hero, each coordinate is -1, 0 or 1.
+     */
+    std::pair<int, int> getHeading() const;
+
+    /**
+     * \brief Get the chunk from which the generation should be ordered, next to the hero in its direction.
+     */
+    std::pair<int, int> getFocus() const;
+
+    /**
+     * \brief Get the counters of the prefetcher.
+     */
+    const PrefetchStats& getStats() const;
+
+private:
+    /**
+     * \brief Compute the lead from the speeds of the hero and of the generation.
+     * \param side Number of chunks of a side of the square.
+     */
+    int lead(int side) const;
+
+    bool has_chunk;                ///< A chunk was entered since the last reset
+    std::pair<int, int> last_chunk; ///< Last chunk entered
+    uint64_t last_turn;            ///< Turn of the last crossing
+    uint64_t last_filled;          ///< Number of chunks filled at the last crossing
+
+    double heading_x; ///< Average move along x between chunks
+    double heading_y; ///< Average move along y between chunks
+    double speed;     ///< Average speed of the hero, in chunks per turn
+    double rate;      ///< Average speed of the generation, in chunks per turn, 0 if unknown
+
+    PrefetchStats stats; ///< Counters of the prefetcher
+};
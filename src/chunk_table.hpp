@@ -0,0 +1,367 @@
+/**
+ * \file chunk_table.hpp
+ * \brief Hash table indexed by chunk coordinates.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+
+/**
+ * \brief Associative container mapping chunk coordinates to values.
+ *
+ * \section Behaviour
+ *   Coordinates are packed into a single 64 bits key which is stored in an open-addressing table
+ *   using linear probing, the table is always kept at most half full so that a lookup usually
+ *   needs a single probe.
+ *   Values are stored contiguously in insertion order (an erased value is replaced by the last one),
+ *   thus iterating over values is as cheap as iterating over a vector.
+ *
+ * \warning Inserting or erasing a value can invalidate pointers to other values.
+ */
+template <typename T>
+class ChunkTable
+{
+public:
+    static constexpr size_t NONE = SIZE_MAX; ///< Index returned for a missing chunk
+
+    /**
+     * \brief Create an empty table.
+     */
+    ChunkTable();
+
+    /**
+     * \brief Pack the coordinates of a chunk into a single key.
+     * \param x x-coordinate of the chunk.
+     * \param y y-coordinate of the chunk.
+     * \return A key which is unique for each pair of coordinates.
+     */
+    static uint64_t key(int x, int y);
+
+    /**
+     * \brief Get the value associated with a chunk.
+     * \param x x-coordinate of the chunk.
+     * \param y y-coordinate of the chunk.
+     * \return A pointer to the value, or nullptr if there is none.
+     */
+    T* find(int x, int y);
+
+    /**
+     * \brief Get the value associated with a chunk.
+     * \param x x-coordinate of the chunk.
+     * \param y y-coordinate of the chunk.
+     * \return A pointer to the value, or nullptr if there is none.
+     */
+    const T* find(int x, int y) const;
+
+    /**
+     * \brief Get the position of the value associated with a chunk.
+     * \param x x-coordinate of the chunk.
+     * \param y y-coordinate of the chunk.
+     * \return The index of the value (see valueAt), or NONE if there is none.
+     * \note The index stays valid until a value is erased.
+     */
+    size_t indexOf(int x, int y) const;
+
+    /**
+     * \brief Check if a value is associated with a chunk.
+     */
+    bool contains(int x, int y) const;
+
+    /**
+     * \brief Get a reference to the value of a chunk, it is default constructed if needed.
+     */
+    T& operator()(int x, int y);
+
+    /**
+     * \brief Associate a value with a chunk, replacing any previous value.
+     * \return A reference to the stored value.
+     */
+    T& insert(int x, int y, T value);
+
+    /**
+     * \brief Remove the value associated with a chunk.
+     * \return true if there was a value to remove.
+     */
+    bool erase(int x, int y);
+
+    /**
+     * \brief Remove every values.
+     */
+    void clear();
+
+    /**
+     * \brief Number of values stored.
+     */
+    size_t size() const;
+
+    /**
+     * \brief Check if there is no value stored.
+     */
+    bool empty() const;
+
+    /**
+     * \brief Coordinates of the i-th stored value.
+     */
+    std::pair<int, int> idAt(size_t i) const;
+
+    /**
+     * \brief The i-th stored value.
+     */
+    T& valueAt(size_t i);
+
+    /**
+     * \brief The i-th stored value.
+     */
+    const T& valueAt(size_t i) const;
+
+private:
+    /**
+     * \brief A cell of the open-addressing table.
+     */
+    struct Slot
+    {
+        uint64_t key;   ///< Packed coordinates of the chunk
+        uint32_t index; ///< Position of the value in `values`, or `EMPTY`
+    };
+
+    static constexpr uint32_t EMPTY = UINT32_MAX; ///< Index of a free slot
+    static constexpr size_t MIN_CAPACITY = 16;   ///< Initial number of slots
+
+    /**
+     * \brief Get the slot where a key is, or the free slot where it would be inserted.
+     */
+    size_t probe(uint64_t key) const;
+
+    /**
+     * \brief First slot where a key is looked for.
+     */
+    size_t home(uint64_t key) const;
+
+    /**
+     * \brief Double the number of slots.
+     */
+    void grow();
+
+    std::vector<Slot> slots;              ///< The open-addressing table, its size is a power of two
+    unsigned int shift;                   ///< 64 - log2(slots.size()), used to hash keys
+    std::vector<uint64_t> keys;           ///< Key of each stored value
+    std::vector<T> values;                ///< Stored values
+};
+
+
+template <typename T>
+constexpr size_t ChunkTable<T>::NONE;
+
+template <typename T>
+constexpr uint32_t ChunkTable<T>::EMPTY;
+
+template <typename T>
+constexpr size_t ChunkTable<T>::MIN_CAPACITY;
+
+template <typename T>
+ChunkTable<T>::ChunkTable() :
+    slots(MIN_CAPACITY, Slot{0, EMPTY}),
+    shift(60)
+{}
+
+template <typename T>
+inline uint64_t ChunkTable<T>::key(int x, int y)
+{
+    return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+}
+
+template <typename T>
+inline size_t ChunkTable<T>::home(uint64_t key) const
+{
+    // Fibonacci hashing: keep the high bits of the product
+    return static_cast<size_t>((key * UINT64_C(0x9E3779B97F4A7C15)) >> shift);
+}
+
+template <typename T>
+inline size_t ChunkTable<T>::probe(uint64_t key) const
+{
+    size_t mask = slots.size() - 1;
+    size_t i = home(key);
+
+    while (slots[i].index != EMPTY && slots[i].key != key)
+        i = (i + 1) & mask;
+
+    return i;
+}
+
+template <typename T>
+inline T* ChunkTable<T>::find(int x, int y)
+{
+    const Slot& slot = slots[probe(key(x, y))];
+    return slot.index == EMPTY ? nullptr : &values[slot.index];
+}
+
+template <typename T>
+inline const T* ChunkTable<T>::find(int x, int y) const
+{
+    const Slot& slot = slots[probe(key(x, y))];
+    return slot.index == EMPTY ? nullptr : &values[slot.index];
+}
+
+template <typename T>
+inline size_t ChunkTable<T>::indexOf(int x, int y) const
+{
+    const Slot& slot = slots[probe(key(x, y))];
+    return slot.index == EMPTY ? NONE : slot.index;
+}
+
+template <typename T>
+inline bool ChunkTable<T>::contains(int x, int y) const
+{
+    return find(x, y) != nullptr;
+}
+
+template <typename T>
+T& ChunkTable<T>::operator()(int x, int y)
+{
+    T* value = find(x, y);
+
+    if (value != nullptr)
+        return *value;
+
+    return insert(x, y, T());
+}
+
+template <typename T>
+T& ChunkTable<T>::insert(int x, int y, T value)
+{
+    uint64_t chunk_key = key(x, y);
+    size_t i = probe(chunk_key);
+
+    if (slots[i].index != EMPTY)
+    {
+        values[slots[i].index] = std::move(value);
+        return values[slots[i].index];
+    }
+
+    // Keep the table at most half full
+    if (2 * (values.size() + 1) > slots.size())
+    {
+        grow();
+        i = probe(chunk_key);
+    }
+
+    slots[i] = Slot{chunk_key, static_cast<uint32_t>(values.size())};
+    keys.push_back(chunk_key);
+    values.push_back(std::move(value));
+
+    return values.back();
+}
+
+template <typename T>
+bool ChunkTable<T>::erase(int x, int y)
+{
+    size_t mask = slots.size() - 1;
+    size_t i = probe(key(x, y));
+
+    if (slots[i].index == EMPTY)
+        return false;
+
+    // Move the last value in the hole left in the storage
+    uint32_t index = slots[i].index;
+    uint32_t last = static_cast<uint32_t>(values.size() - 1);
+
+    if (index != last)
+    {
+        slots[probe(keys[last])].index = index;
+        keys[index] = keys[last];
+        values[index] = std::move(values[last]);
+    }
+
+    keys.pop_back();
+    values.pop_back();
+
+    // Backward shift deletion: move following entries of the cluster to keep probing correct
+    size_t hole = i;
+    size_t j = i;
+    slots[hole].index = EMPTY;
+
+    while (true)
+    {
+        j = (j + 1) & mask;
+
+        if (slots[j].index == EMPTY)
+            break;
+
+        size_t target = home(slots[j].key);
+
+        // Check wether target is cyclically outside of (hole, j]
+        bool movable = (hole <= j) ? (target <= hole || target > j) : (target <= hole && target > j);
+
+        if (movable)
+        {
+            slots[hole] = slots[j];
+            slots[j].index = EMPTY;
+            hole = j;
+        }
+    }
+
+    return true;
+}
+
+template <typename T>
+void ChunkTable<T>::clear()
+{
+    slots.assign(MIN_CAPACITY, Slot{0, EMPTY});
+    shift = 60;
+    keys.clear();
+    values.clear();
+}
+
+template <typename T>
+inline size_t ChunkTable<T>::size() const
+{
+    return values.size();
+}
+
+template <typename T>
+inline bool ChunkTable<T>::empty() const
+{
+    return values.empty();
+}
+
+template <typename T>
+inline std::pair<int, int> ChunkTable<T>::idAt(size_t i) const
+{
+    assert(i < keys.size());
+
+    return {
+        static_cast<int>(static_cast<uint32_t>(keys[i] >> 32)),
+        static_cast<int>(static_cast<uint32_t>(keys[i]))
+    };
+}
+
+template <typename T>
+inline T& ChunkTable<T>::valueAt(size_t i)
+{
+    assert(i < values.size());
+    return values[i];
+}
+
+template <typename T>
+inline const T& ChunkTable<T>::valueAt(size_t i) const
+{
+    assert(i < values.size());
+    return values[i];
+}
+
+template <typename T>
+void ChunkTable<T>::grow()
+{
+    slots.assign(2 * slots.size(), Slot{0, EMPTY});
+    shift--;
+
+    for (uint32_t index = 0 ; index < keys.size() ; index++)
+        slots[probe(keys[index])] = Slot{keys[index], index};
+}
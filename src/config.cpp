@@ -134,6 +134,10 @@ void Configuration::readGame(const std::string& filename)
                 gen_options.maze_density = std::stoi(value);
             else if (option_name ==  "generation_type")
                 gen_options.type = static_cast<LevelType>(std::stoi(value));
+            else if (option_name == "resident_distance")
+                resident_distance = std::stoi(value);
+            else if (option_name == "speculation_distance")
+                speculation_distance = std::stoi(value);
         }
         catch (const std::invalid_argument& e)
         {
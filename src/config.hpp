@@ -16,7 +16,8 @@
 enum class LevelType
 {
     Flat, ///< Rectangular-shaped rooms
-    Cave ///< Cave shaped rooms
+    Cave, ///< Cave shaped rooms
+    Cellular ///< Cave shaped rooms, made by a cellular automaton
 };
 
 /**
@@ -72,6 +73,9 @@ struct Configuration
     // Generate a map
     GenerationMode gen_options;
 
+    int resident_distance = 0; ///< Distance from the hero, in cells, beyond which chunks are paged to disk, 0 to keep them
+    int speculation_distance = 40; ///< Distance from the hero, in cells, to stairs going down below which the next level is generated, 0 to wait for the hero to go down
+
     /**
      * \brief Default constructor
      *
@@ -0,0 +1,34 @@
+/**
+ * \file decoration.hpp
+ * \brief Appearance of the cells of a map.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "chunk.hpp"
+#include "utility.hpp"
+
+
+/**
+ * \brief Everything needed to choose the tiles of a cell which only depends on the map around it.
+ *
+ * Corners are indexed like `directions`: the corner `i` is between `directions[i]` and `directions[i+1]`.
+ */
+struct CellDecoration
+{
+    Direction floor_neighborhood = Direction::None; ///< Sides of the floor tile which are next to a wall
+    Direction wall_neighborhood = Direction::None;  ///< Sides of the wall tile which are next to a floor
+    CellType below = CellType::Empty;               ///< Type of the cell under a wall
+    uint8_t corners = 0;                            ///< Bit `i` is set if the wall has the corner `i`
+    uint8_t floor_corners = 0;                      ///< Bit `i` is set if the cell in the corner `i` is a floor
+    uint8_t variant = 0;                            ///< Random variant of the floor tile, in `[0, 5]`
+};
+
+/**
+ * \brief Decoration of each cell of a chunk, row by row.
+ */
+template <int Size>
+using ChunkDecoration = std::array<CellDecoration, Size*Size>;
@@ -6,6 +6,7 @@
 #include <vector>
 
 #include "entity.hpp"
+#include "rand.hpp"
 #include "utility.hpp"
 
 
@@ -443,7 +444,7 @@ const std::vector<Spell>& Character::getSpells() const
 
 Class randomClass()
 {
-    int r = rand() % 4;
+    int r = RandGen::uniform_int(0, 3);
     std::vector<int> monsters = {3,5,6,8};
     return static_cast<Class>(monsters[r]);
 }
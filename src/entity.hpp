@@ -483,7 +483,7 @@ protected:
 
 
 /**
- * \brief Return a random class
+ * \brief Return a random class of monster, drawn from the random stream of the generation
  */
 Class randomClass();
 
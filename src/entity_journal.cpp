@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <fstream>
+
+#include "chunk.hpp"
+#include "entity_journal.hpp"
+
+
+bool save_entities_changes(const std::string& path,
+                           const std::vector<std::shared_ptr<Entity>>& entities,
+                           const ChunkTable<uint8_t>& chunks)
+{
+    std::ofstream file {path, std::ios::app | std::ios::binary};
+    if (!file)
+        return false;
+
+    // Gather the entities of the chunks in a single pass
+    std::vector<std::shared_ptr<Entity>> heroes;
+    ChunkTable<std::vector<std::shared_ptr<Entity>>> chunk_entities;
+    for (size_t i = 0 ; i < chunks.size() ; i++)
+        chunk_entities.insert(chunks.idAt(i).first, chunks.idAt(i).second, {});
+
+    for (const auto& entity : entities)
+    {
+        if (entity->getType() == EntityType::Hero)
+        {
+            heroes.push_back(entity);
+            continue;
+        }
+
+        auto chunk = Chunk::sector(entity->getPosition().x, entity->getPosition().y);
+        auto* changed = chunk_entities.find(chunk.first, chunk.second);
+        if (changed != nullptr)
+            changed->push_back(entity);
+    }
+
+    uint32_t n_heroes = static_cast<uint32_t>(heroes.size());
+    file.write(reinterpret_cast<const char*>(&n_heroes), sizeof(uint32_t));
+    for (const auto& hero : heroes)
+        file << hero;
+
+    uint32_t n_chunks = static_cast<uint32_t>(chunk_entities.size());
+    file.write(reinterpret_cast<const char*>(&n_chunks), sizeof(uint32_t));
+    for (size_t i = 0 ; i < chunk_entities.size() ; i++)
+    {
+        int32_t x = chunk_entities.idAt(i).first;
+        int32_t y = chunk_entities.idAt(i).second;
+        const auto& changed = chunk_entities.valueAt(i);
+        uint32_t n_entities = static_cast<uint32_t>(changed.size());
+
+        file.write(reinterpret_cast<const char*>(&x), sizeof(int32_t));
+        file.write(reinterpret_cast<const char*>(&y), sizeof(int32_t));
+        file.write(reinterpret_cast<const char*>(&n_entities), sizeof(uint32_t));
+        for (const auto& entity : changed)
+            file << entity;
+    }
+
+    return true;
+}
+
+bool load_entities_changes(const std::string& path, std::vector<std::shared_ptr<Entity>>& entities)
+{
+    std::ifstream file {path, std::ios::binary};
+    if (!file)
+        return false;
+
+    while (file && file.peek() != std::ifstream::traits_type::eof())
+    {
+        uint32_t n_heroes = 0;
+        file.read(reinterpret_cast<char*>(&n_heroes), sizeof(uint32_t));
+        std::vector<std::shared_ptr<Entity>> heroes(n_heroes);
+        for (auto& hero : heroes)
+            file >> hero;
+
+        uint32_t n_chunks = 0;
+        file.read(reinterpret_cast<char*>(&n_chunks), sizeof(uint32_t));
+        ChunkTable<std::vector<std::shared_ptr<Entity>>> chunk_entities;
+        for (uint32_t i = 0 ; i < n_chunks ; i++)
+        {
+            int32_t x = 0, y = 0;
+            uint32_t n_entities = 0;
+            file.read(reinterpret_cast<char*>(&x), sizeof(int32_t));
+            file.read(reinterpret_cast<char*>(&y), sizeof(int32_t));
+            file.read(reinterpret_cast<char*>(&n_entities), sizeof(uint32_t));
+
+            auto& changed = chunk_entities.insert(x, y, std::vector<std::shared_ptr<Entity>>(n_entities));
+            for (auto& entity : changed)
+                file >> entity;
+        }
+
+        // The heroes and the entities of the chunks saved replace the previous ones
+        entities.erase(std::remove_if(entities.begin(), entities.end(),
+            [&](const std::shared_ptr<Entity>& entity)
+            {
+                auto chunk = Chunk::sector(entity->getPosition().x, entity->getPosition().y);
+                return entity->getType() == EntityType::Hero || chunk_entities.contains(chunk.first, chunk.second);
+            }), entities.end());
+
+        entities.insert(entities.end(), heroes.begin(), heroes.end());
+        for (size_t i = 0 ; i < chunk_entities.size() ; i++)
+            entities.insert(entities.end(), chunk_entities.valueAt(i).begin(), chunk_entities.valueAt(i).end());
+    }
+
+    return true;
+}
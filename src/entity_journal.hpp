@@ -0,0 +1,36 @@
+/**
+ * \file entity_journal.hpp
+ * \brief Save the entities of the chunks of a level which changed since the last save.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "chunk_table.hpp"
+#include "entity.hpp"
+
+
+/**
+ * \brief Append the entities of some chunks of a level to a journal
+ * \param path Path of the journal
+ * \param entities The entities of the level, including the ones of the chunks
+ * \param chunks The chunks whose entities changed since the last save
+ *
+ * Each call appends the heroes of the level, which move between chunks and levels,
+ * followed by the other entities of each chunk.
+ */
+bool save_entities_changes(const std::string& path,
+                           const std::vector<std::shared_ptr<Entity>>& entities,
+                           const ChunkTable<uint8_t>& chunks);
+
+/**
+ * \brief Apply the changes of a journal to the entities of a level, in the order they were written
+ * \param path Path of the journal
+ * \param entities The entities of the level, the entities of a chunk are replaced by the last ones saved
+ * \return false if there is no journal
+ */
+bool load_entities_changes(const std::string& path, std::vector<std::shared_ptr<Entity>>& entities);
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <fstream>
 
 #include "exploration.hpp"
@@ -11,11 +12,11 @@ bool MapExploration::isExplored(sf::Vector2i position)
     sf::Vector2u chunk_pos = static_cast<sf::Vector2<unsigned int>>
         (math::remainder(position, chunk_size));
 
-    auto it = indices.find(chunk);
-    if (it == indices.end())
+    size_t index = chunkIndex(chunk, false);
+    if (index == SIZE_MAX)
         return false;
 
-    return chunks[it->second][chunk_pos.x + chunk_size * chunk_pos.y];
+    return chunks[index][chunk_pos.x + chunk_size * chunk_pos.y];
 }
 
 void MapExploration::setExplored(sf::Vector2i position, bool explored)
@@ -24,14 +25,38 @@ void MapExploration::setExplored(sf::Vector2i position, bool explored)
     sf::Vector2u chunk_pos = static_cast<sf::Vector2<unsigned int>>
         (math::remainder(position, chunk_size));
 
-    auto result = indices.emplace(chunk, chunks.size());
-    auto it = result.first;
-    bool insertion = result.second;
+    size_t index = chunkIndex(chunk, true);
+    size_t bit = chunk_pos.x + chunk_size * chunk_pos.y;
+
+    // Cells are set again each time they are seen
+    if (chunks[index][bit] != explored)
+    {
+        chunks[index][bit] = explored;
+        dirty_chunks[index] = true;
+    }
+}
+
+size_t MapExploration::chunkIndex(sf::Vector2i chunk, bool create)
+{
+    if (last_index != SIZE_MAX && chunk == last_chunk)
+        return last_index;
 
-    if (insertion)
+    auto it = indices.find(chunk);
+
+    if (it == indices.end())
+    {
+        if (!create)
+            return SIZE_MAX;
+
+        it = indices.emplace(chunk, chunks.size()).first;
         chunks.emplace_back();
+        dirty_chunks.push_back(false);
+    }
+
+    last_chunk = chunk;
+    last_index = it->second;
 
-    chunks[it->second][chunk_pos.x + chunk_size * chunk_pos.y] = explored;
+    return last_index;
 }
 
 
@@ -39,11 +64,67 @@ bool MapExploration::save(const std::string& path) const
 {
     std::ofstream file {path, std::ios::trunc | std::ios::binary};
 
-    uint32_t size = chunks.size();
+    writeChunks(file, false);
+
+    return true;
+}
+
+bool MapExploration::load(const std::string& path)
+{
+    std::ifstream file {path, std::ios::binary};
+
+    readChunks(file);
+    markClean();
+
+    return true;
+}
+
+bool MapExploration::saveChanges(const std::string& path) const
+{
+    std::ofstream file {path, std::ios::app | std::ios::binary};
+    if (!file)
+        return false;
+
+    writeChunks(file, true);
+
+    return true;
+}
+
+bool MapExploration::loadChanges(const std::string& path)
+{
+    std::ifstream file {path, std::ios::binary};
+    if (!file)
+        return false;
+
+    while (file && file.peek() != std::ifstream::traits_type::eof())
+        readChunks(file);
+
+    markClean();
+
+    return true;
+}
+
+bool MapExploration::isModified() const
+{
+    return std::find(dirty_chunks.begin(), dirty_chunks.end(), true) != dirty_chunks.end();
+}
+
+void MapExploration::markClean()
+{
+    std::fill(dirty_chunks.begin(), dirty_chunks.end(), false);
+}
+
+void MapExploration::writeChunks(std::ostream& file, bool only_dirty) const
+{
+    uint32_t size = static_cast<uint32_t>(only_dirty ? std::count(dirty_chunks.begin(), dirty_chunks.end(), true)
+                                                     : chunks.size());
     file.write(reinterpret_cast<char*>(&size), sizeof(uint32_t));
 
     for (auto chunk_coords : indices)
     {
+        if (only_dirty && !dirty_chunks[chunk_coords.second])
+            continue;
+
         sf::Vector2i coords = chunk_coords.first;
         file.write(reinterpret_cast<char*>(&coords.x), sizeof(int32_t));
         file.write(reinterpret_cast<char*>(&coords.y), sizeof(int32_t));
@@ -64,27 +145,21 @@ bool MapExploration::save(const std::string& path) const
             file.write(reinterpret_cast<char*>(&byte), sizeof(uint8_t));
         }
     }
-
-    return true;
 }
 
-bool MapExploration::load(const std::string& path)
+void MapExploration::readChunks(std::istream& file)
 {
-    std::ifstream file {path, std::ios::binary};
-
-    uint32_t size;
+    uint32_t size = 0;
     file.read(reinterpret_cast<char*>(&size), sizeof(uint32_t));
 
-    for (unsigned int i_chunk = 0; i_chunk < size; ++i_chunk)
+    for (unsigned int i_chunk = 0; i_chunk < size && file; ++i_chunk)
     {
         sf::Vector2i coords {};
         file.read(reinterpret_cast<char*>(&coords.x), sizeof(int32_t));
         file.read(reinterpret_cast<char*>(&coords.y), sizeof(int32_t));
 
-        indices.emplace(coords, chunks.size());
-        chunks.emplace_back();
-
-        auto& chunk = chunks.back();
+        // A chunk saved again replaces the previous one
+        auto& chunk = chunks[chunkIndex(coords, true)];
         for (unsigned int i = 0; i + 7 < chunk_size * chunk_size; i += 8)
         {
             uint8_t byte = 0;
@@ -100,6 +175,4 @@ bool MapExploration::load(const std::string& path)
             chunk.set(i + 7, (byte & 0x80) != 0);
         }
     }
-
-    return true;
 }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <bitset>
+#include <cstdint>
+#include <iostream>
 #include <map>
 #include <string>
 #include <vector>
@@ -21,12 +23,58 @@ public:
     bool save(const std::string& path) const;
     bool load(const std::string& path);
 
+    /**
+     * \brief Append the chunks modified since the last save to a journal
+     * \param path Path of the journal
+     */
+    bool saveChanges(const std::string& path) const;
+
+    /**
+     * \brief Apply the changes of a journal, in the order they were written
+     * \param path Path of the journal
+     * \return false if there is no journal
+     */
+    bool loadChanges(const std::string& path);
+
+    /**
+     * \brief Check if a cell was explored since the last save
+     */
+    bool isModified() const;
+
+    /**
+     * \brief Mark every chunks as saved
+     */
+    void markClean();
+
     static constexpr int chunk_size = 32;
 
 private:
 
+    /**
+     * \brief Get the index of the chunk containing a position, looking at the last chunk used first.
+     * \param chunk Coordinates of the chunk
+     * \param create Create the chunk if it doesn't exist
+     * \return The index of the chunk in `chunks`, or SIZE_MAX if it doesn't exist
+     */
+    size_t chunkIndex(sf::Vector2i chunk, bool create);
+
+    /**
+     * \brief Write the number of chunks followed by the chunks
+     * \param only_dirty Write only the chunks modified since the last save
+     */
+    void writeChunks(std::ostream& stream, bool only_dirty) const;
+
+    /**
+     * \brief Read chunks written by writeChunks, replacing the ones which exist
+     */
+    void readChunks(std::istream& stream);
+
     std::map<sf::Vector2i, size_t> indices;
     std::vector<std::bitset<chunk_size * chunk_size>> chunks;
+    std::vector<bool> dirty_chunks; ///< Chunks modified since the last save, by index
 
     size_t next_indice = 0;
+
+    sf::Vector2i last_chunk;        ///< Last chunk used, cells are usually read row by row
+    size_t last_index = SIZE_MAX;   ///< Index of the last chunk used, or SIZE_MAX
 };
@@ -9,6 +9,8 @@ Game::Game() :
     entities(nullptr),
     map_exploration(nullptr),
     current_level(0),
+    speculator(Chunk::chunk_span(DIST_LOAD), levelSeed),
+    loaded_level(SIZE_MAX),
     entity_turn(EntityType::Hero),
     next_move(0.f)
 {}
@@ -44,45 +46,73 @@ void Game::newGame(const std::string& save_path, Class hero_class)
     dungeon.clear();
     generators.clear();
     exploration.clear();
+    pagers.clear();
+    speculator.reset(config.gen_options, config.speculation_distance);
 
     game_name = save_path;
     current_level = 0;
+    loaded_level = SIZE_MAX;
     entity_turn = EntityType::Hero;
     next_move = 0.f;
 
     // Seed the rng
     std::random_device r;
     Rand::seed(r());
-    RandGen::seed(r());
 
     dungeon.push_back(Level());
-    generators.push_back(std::make_shared<Generator>(config.gen_options));
+    generators.push_back(std::make_shared<Generator>(config.gen_options, levelSeed()));
     exploration.emplace_back();
+    pagers.push_back(createPager(0));
 
     map = &dungeon[0].map;
     entities = &dungeon[0].entities;
     generator = generators[0];
     map_exploration = &exploration[0];
 
-    if (!map->hasChunk(0, 0))
+    // The hero is put on the entry stairs once the level is generated, see enterLevel
+    entities->push_back(std::make_shared<Character>(
+        EntityType::Hero, Interaction::None, sf::Vector2i(0, 0),
+        Direction::Left, hero_class, 20, 1, Controller::Player1));
+
+    generator->preGenerateRadius(0, 0, 0, true);
+}
+
+void Game::enterLevel(std::size_t level)
+{
+    Level& next = dungeon[level];
+
+    if (!next.map.hasChunk(0, 0))
     {
-        map->setChunk(0, 0, generator->getChunkCells(0, 0));
-        auto first_entities = generator->getChunkEntities(0, 0);
-        entities->insert(end(dungeon[0].entities), begin(first_entities), end(first_entities));
+        next.map.setChunk(0, 0, generators[level]->takeChunkCells(0, 0));
+        auto first_entities = generators[level]->takeChunkEntities(0, 0);
+        next.entities.insert(end(next.entities), begin(first_entities), end(first_entities));
     }
 
-    sf::Vector2i start_pos;
-    auto entry_stairs = std::find_if(entities->begin(), entities->end(),
-    [](const std::shared_ptr<Entity> e) -> bool
-    {
-        return e->getType() == EntityType::Stairs && e->getInteraction() == Interaction::GoUp;
-    });
-    if (entry_stairs != entities->end())
-        start_pos = (*entry_stairs)->getPosition();
+    current_level = level;
 
-    entities->push_back(std::make_shared<Character>(
-        EntityType::Hero, Interaction::None, start_pos,
-        Direction::Left, hero_class, 20, 1, Controller::Player1));
+    map = &next.map;
+    entities = &next.entities;
+    if (generator)
+        generator->setForeground(false);
+    generator = generators[level];
+    generator->setForeground(true);
+    map_exploration = &exploration[level];
+
+    auto hero = std::find_if(next.entities.begin(), next.entities.end(),
+        [](const std::shared_ptr<Entity>& e) -> bool {
+            return e->getType() == EntityType::Hero;
+        });
+
+    auto stairs = std::find_if(next.entities.begin(), next.entities.end(),
+        [](const std::shared_ptr<Entity>& e) -> bool {
+            return e->getType() == EntityType::Stairs && e->getInteraction() == Interaction::GoUp;
+        });
+
+    if (hero != next.entities.end() && stairs != next.entities.end())
+    {
+        (*hero)->setPosition((*stairs)->getPosition());
+        next.setEntitiesDirty((*hero)->getPosition());
+    }
 }
 
 void Game::loadArround()
@@ -99,25 +129,146 @@ void Game::loadArround()
     auto chunk_position = Chunk::sector(position.x, position.y);
     sf::Vector2i chunk_id;
 
-    // Preload further
-    generator->generateRadius(chunk_position.first, chunk_position.second, DIST_CHUNK_LOAD);
-    generator->preGenerateRadius(chunk_position.first, chunk_position.second, DIST_CHUNK_PRELOAD);
+    if (loaded_level == current_level && loaded_chunk == chunk_position)
+        return;
+
+    // Movements on another level don't tell where the player goes
+    if (loaded_level != current_level)
+        prefetcher.reset();
+
+    loaded_level = current_level;
+    loaded_chunk = chunk_position;
+    prefetcher.cross(chunk_position, generator->getFilledCount(), generator->getQueueStats().length > 0);
+
+    const int dist_chunk_load = Chunk::chunk_span(DIST_LOAD);
+    const int dist_chunk_preload = Chunk::chunk_span(DIST_PRELOAD);
+
+    // Preload further, and even further in the direction of the player
+    if (generator->generateRadius(chunk_position.first, chunk_position.second, dist_chunk_load))
+        prefetcher.wait();
+
+    ChunkArea area = prefetcher.area(dist_chunk_preload);
+    auto focus = prefetcher.getFocus();
+    generator->preGenerateArea(area.x_min, area.y_min, area.x_max, area.y_max, focus.first, focus.second);
+    generator->cancelOutside(area.x_min, area.y_min, area.x_max, area.y_max);
 
-    for (chunk_id.x = chunk_position.first - DIST_CHUNK_LOAD ; chunk_id.x <= chunk_position.first + DIST_CHUNK_LOAD ; chunk_id.x++)
+    ChunkPager& pager = *pagers[current_level];
+    bool loaded = false;
+
+    for (chunk_id.x = chunk_position.first - dist_chunk_load ; chunk_id.x <= chunk_position.first + dist_chunk_load ; chunk_id.x++)
     {
-        for (chunk_id.y = chunk_position.second - DIST_CHUNK_LOAD ; chunk_id.y <= chunk_position.second + DIST_CHUNK_LOAD ; chunk_id.y++)
+        for (chunk_id.y = chunk_position.second - dist_chunk_load ; chunk_id.y <= chunk_position.second + dist_chunk_load ; chunk_id.y++)
         {
-            if (!map->hasChunk(chunk_id.x, chunk_id.y))
+            int x = chunk_id.x;
+            int y = chunk_id.y;
+
+            pager.touch(x, y);
+
+            if (!map->hasChunk(x, y))
             {
-                int x = chunk_id.x;
-                int y = chunk_id.y;
+                loaded = true;
 
-                map->setChunk(x, y, generator->getChunkCells(x, y));
-                auto new_entities = generator->getChunkEntities(x, y);
+                // A chunk which can't be read back stays paged, instead of being generated again
+                if (pager.pageIn(x, y, *map, *entities) || pager.contains(x, y))
+                    continue;
+
+                prefetcher.miss();
+                map->setChunk(x, y, generator->takeChunkCells(x, y));
+                auto new_entities = generator->takeChunkEntities(x, y);
+                if (!new_entities.empty())
+                    dungeon[current_level].dirty_entities.insert(x, y, 1);
                 entities->insert(end(*entities), begin(new_entities), end(new_entities));
             }
+
+            // Monsters of the chunks added in advance only play once they are loaded
+            auto* streamed = dungeon[current_level].streamed_entities.find(x, y);
+            if (streamed != nullptr && map->hasChunk(x, y))
+            {
+                entities->insert(end(*entities), begin(*streamed), end(*streamed));
+                dungeon[current_level].streamed_entities.erase(x, y);
+            }
         }
     }
+
+    // The player moved to another area, page out the chunks left far behind
+    if (loaded && config.resident_distance > 0)
+    {
+        // Chunks which can be loaded or seen stay in memory
+        int distance = std::max(config.resident_distance, DIST_PRELOAD);
+        pager.evict(*map, *entities, position, distance);
+    }
+}
+
+void Game::streamChunks()
+{
+    if (loaded_level != current_level)
+        return;
+
+    sf::Clock clock;
+    const int radius = Chunk::chunk_span(DIST_PRELOAD);
+    ChunkPager& pager = *pagers[current_level];
+
+    // Chunks of the preloaded area which won't change anymore, the closest first
+    std::vector<std::pair<int, std::pair<int, int>>> ready;
+
+    for (auto chunk_id : generator->getCachedChunks())
+    {
+        int distance = std::max(std::abs(chunk_id.first - loaded_chunk.first), std::abs(chunk_id.second - loaded_chunk.second));
+
+        if (distance <= radius && !map->hasChunk(chunk_id.first, chunk_id.second) &&
+            !pager.contains(chunk_id.first, chunk_id.second) && generator->isReady(chunk_id.first, chunk_id.second))
+            ready.push_back({distance, chunk_id});
+    }
+
+    std::sort(ready.begin(), ready.end());
+
+    for (const auto& chunk : ready)
+    {
+        if (clock.getElapsedTime().asSeconds() > STREAM_TIME)
+            break;
+
+        int x = chunk.second.first;
+        int y = chunk.second.second;
+
+        map->setChunk(x, y, generator->takeChunkCells(x, y));
+        auto new_entities = generator->takeChunkEntities(x, y);
+        if (!new_entities.empty())
+        {
+            dungeon[current_level].dirty_entities.insert(x, y, 1);
+            dungeon[current_level].streamed_entities.insert(x, y, std::move(new_entities));
+        }
+
+        prefetcher.stream();
+    }
+}
+
+void Game::speculateNextLevel()
+{
+    auto hero = std::find_if(entities->begin(), entities->end(),
+    [](const std::shared_ptr<Entity>& e)
+    {
+        return e->getType() == EntityType::Hero;
+    });
+    if (hero == entities->end())
+        return;
+
+    speculator.update(current_level == dungeon.size() - 1, (*hero)->getPosition(), *entities, *map_exploration);
+}
+
+std::shared_ptr<ChunkPager> Game::createPager(std::size_t level) const
+{
+    const std::string pages_path {Configuration::user_path + "pages/"};
+
+    if (config.resident_distance > 0 && system(("mkdir -p " + pages_path).c_str()) == -1)
+        std::cerr << "Can't create the directory of page files" << std::endl;
+
+    return std::make_shared<ChunkPager>(pages_path + game_name + "_" + std::to_string(level) + ".dat");
+}
+
+uint64_t Game::levelSeed()
+{
+    std::random_device r;
+    return (static_cast<uint64_t>(r()) << 32) | r();
 }
 
 void Game::run()
@@ -155,6 +306,8 @@ void Game::run()
             next_move -= elapsed_time;
             update(); // Update Game iff there is no Menu
             loadArround();
+            streamChunks();
+            speculateNextLevel();
         }
 
         // Draw
@@ -190,6 +343,11 @@ void Game::run()
 
         case MenuEvent::NewGame:
             newGame(menu_ev.save_path, menu_ev.hero_class);
+            menu = std::make_shared<LoadingMenu>(generator, 0);
+            break;
+
+        case MenuEvent::LevelGenerated:
+            enterLevel(menu_ev.level);
             menu = nullptr;
             break;
 
@@ -244,10 +402,17 @@ void Game::update()
 
         Action action = control::get_input(*entity, *entities, *map, config);
 
+        sf::Vector2i position = entity->getPosition();
         bool action_done = update_entity(entity, action);
 
         if (action_done)
         {
+            // The entity and the one it faces may have changed
+            Level& level = dungeon[current_level];
+            level.setEntitiesDirty(position);
+            level.setEntitiesDirty(entity->getPosition());
+            level.setEntitiesDirty(position + to_vector2i(entity->getOrientation()));
+
             switch (action.type)
             {
             case ActionType::Move:
@@ -265,39 +430,37 @@ void Game::update()
                             switch (target->getInteraction())
                             {
                                 case Interaction::GoDown: {
-                                    auto hero = std::find_if(dungeon[current_level].entities.begin(), dungeon[current_level].entities.end(),
-                                        [](std::shared_ptr<Entity> e) -> bool {
-                                            return e->getType() == EntityType::Hero;
-                                        });
-
                                     if (current_level == dungeon.size()-1)
                                     {
+                                        // Kept before the dungeon grows, which moves the levels
+                                        std::shared_ptr<Entity> hero = *std::find_if(entities->begin(), entities->end(),
+                                            [](std::shared_ptr<Entity> e) -> bool {
+                                                return e->getType() == EntityType::Hero;
+                                            });
+
                                         dungeon.push_back(Level());
-                                        dungeon[current_level+1].entities.push_back(*hero);
-                                        generators.push_back(std::make_shared<Generator>(config.gen_options));
+                                        dungeon[current_level+1].entities.push_back(hero);
+                                        generators.push_back(speculator.takeGenerator());
                                         exploration.emplace_back();
-
-                                        dungeon[current_level+1].map.setChunk(0, 0, generators[current_level+1]->getChunkCells(0, 0));
-
-                                        auto first_entities = generators[current_level+1]->getChunkEntities(0, 0);
-                                        dungeon[current_level+1].entities.insert(end(dungeon[current_level+1].entities), begin(first_entities), end(first_entities));
+                                        pagers.push_back(createPager(current_level+1));
+
+                                        map = &dungeon[current_level].map;
+                                        entities = &dungeon[current_level].entities;
+                                        map_exploration = &exploration[current_level];
+
+                                        // The level is entered once generated, the loading menu shows the progress
+                                        if (!generators[current_level+1]->isReady(0, 0))
+                                        {
+                                            generators[current_level+1]->setForeground(true);
+                                            generators[current_level+1]->preGenerateRadius(0, 0, 0, true);
+                                            menu = std::make_shared<LoadingMenu>(generators[current_level+1], current_level+1);
+                                            return;
+                                        }
                                     }
 
-                                    current_level++;
-
-                                    map = &dungeon[current_level].map;
-                                    entities = &dungeon[current_level].entities;
-                                    generator = generators[current_level];
-                                    map_exploration = &exploration.back();
-
-                                    auto stairs = std::find_if(dungeon[current_level].entities.begin(), dungeon[current_level].entities.end(),
-                                        [](std::shared_ptr<Entity> e) -> bool {
-                                            return e->getType() == EntityType::Stairs && e->getInteraction() == Interaction::GoUp;
-                                        });
-
-                                    (*hero)->setPosition((*stairs)->getPosition()); }
-
-                                    break;
+                                    // The entities of the level left are not iterated anymore
+                                    enterLevel(current_level+1);
+                                    return; }
 
                                 case Interaction::GoUp: {
                                     if (current_level == 0)
@@ -307,6 +470,9 @@ void Game::update()
 
                                     map = &dungeon[current_level].map;
                                     entities = &dungeon[current_level].entities;
+                                    generator->setForeground(false);
+                                    generator = generators[current_level];
+                                    generator->setForeground(true);
                                     map_exploration = &exploration[current_level];
 
                                     auto hero = std::find_if(dungeon[current_level].entities.begin(),
@@ -322,7 +488,8 @@ void Game::update()
                                                 e->getInteraction() == Interaction::GoDown;
                                         });
 
-                                    (*hero)->setPosition((*stairs)->getPosition()); }
+                                    (*hero)->setPosition((*stairs)->getPosition());
+                                    dungeon[current_level].setEntitiesDirty((*hero)->getPosition()); }
 
                                     break;
 
@@ -346,6 +513,7 @@ void Game::update()
             if (entity->getType() == EntityType::Hero && action.type != ActionType::Interact)
             {
                 next_turn = EntityType::Monster;
+                prefetcher.turn();
             }
         }
     }
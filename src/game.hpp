@@ -17,9 +17,12 @@
 #include "generation/generator.hpp"
 
 #include "args.hpp"
+#include "chunk_pager.hpp"
+#include "chunk_prefetch.hpp"
 #include "config.hpp"
 #include "control.hpp"
 #include "exploration.hpp"
+#include "level_speculation.hpp"
 #include "map.hpp"
 #include "menu/menu.hpp"
 #include "rand.hpp"
@@ -27,8 +30,9 @@
 #include "utility.hpp"
 
 
-constexpr int DIST_CHUNK_LOAD = 3; ///< Number of chunks to load
-constexpr int DIST_CHUNK_PRELOAD = 5; ///< Number of chunks to preload
+constexpr int DIST_LOAD = 12; ///< Distance, in cells, up to which chunks are loaded
+constexpr int DIST_PRELOAD = 20; ///< Distance, in cells, up to which chunks are preloaded, more towards the hero's direction
+constexpr float STREAM_TIME = 0.002f; ///< Time, in seconds, spent each frame to add chunks generated in advance to the level
 
 /**
  * \brief Represent the game
@@ -129,6 +133,11 @@ private:
      * \param hero_class The class of the hero
      */
     void newGame(const std::string& save_path, Class hero_class);
+    /**
+     * \brief Make a level the current one and put the hero on its entry stairs
+     * \param level The number of the level, its chunk (0, 0) is taken from its generator when missing
+     */
+    void enterLevel(std::size_t level);
     /**
      * \brief Load a game
      * \param save_path The name of the game to load
@@ -141,9 +150,43 @@ private:
 
     /**
      * \brief Generate enough map arround the player.
+     *
+     * Nothing is done while the player stays in the same chunk.
+     * Chunks are preloaded further in the direction the player walks to, see ChunkPrefetcher.
+     * Chunks which were paged out are read back, the other ones are taken from the generator.
+     * When new chunks are loaded, the chunks far from the player are paged out.
      */
     void loadArround();
 
+    /**
+     * \brief Add chunks generated in advance to the level, before the player comes close to them.
+     *
+     * The chunks published by the generator in the preloaded area which won't change anymore are taken,
+     * the closest to the player first, until STREAM_TIME is spent.
+     * Thus loadArround only takes chunks from the generator when they were not ready.
+     * Their entities are kept aside until loadArround loads the chunks, so that monsters out of the
+     * loaded area don't play.
+     */
+    void streamChunks();
+
+    /**
+     * \brief Generate the level below the deepest one in the background, before the player goes down.
+     *
+     * See LevelSpeculator, the generation depends on the distance from the player to stairs going down.
+     */
+    void speculateNextLevel();
+
+    /**
+     * \brief Create the pager of a level of the current game.
+     * \param level The number of the level.
+     */
+    std::shared_ptr<ChunkPager> createPager(std::size_t level) const;
+
+    /**
+     * \brief Draw the seed of a new level, the random streams of its generation derive from it.
+     */
+    static uint64_t levelSeed();
+
     Configuration config; ///< The configuration of the game
     float move_time; ///< The length of the animations
 
@@ -164,6 +207,12 @@ private:
     std::vector<Level> dungeon; ///< The maps and entities of differents level of the dungeon
     std::vector<std::shared_ptr<Generator>> generators; ///< Engines generating the maps
     std::vector<MapExploration> exploration;
+    std::vector<std::shared_ptr<ChunkPager>> pagers; ///< Chunks of each level which are far from the player
+    LevelSpeculator speculator; ///< Generates the level below the deepest one before the player goes down
+
+    std::size_t loaded_level;          ///< Level whose chunks were loaded arround the player, SIZE_MAX if none
+    std::pair<int, int> loaded_chunk;  ///< Chunk of the player when chunks were loaded arround the player
+    ChunkPrefetcher prefetcher;        ///< Chooses the chunks preloaded from the movements of the player
 
     EntityType entity_turn; ///< Tell whether it is the player or the monsters to play
     float next_move; ///< Time until animation terminates
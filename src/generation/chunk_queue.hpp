@@ -0,0 +1,292 @@
+/**
+ * \file   generation/chunk_queue.hpp
+ * \brief  Priority queue of chunks where each chunk appears at most once.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "../chunk_table.hpp"
+
+
+/**
+ * \brief  Counters describing the activity of a ChunkQueue.
+ */
+struct ChunkQueueStats
+{
+    size_t length = 0;       ///< Number of chunks in the queue
+    uint64_t pushed = 0;     ///< Number of chunks added to the queue
+    uint64_t duplicates = 0; ///< Number of chunks pushed while they were already in the queue
+    uint64_t cancelled = 0;  ///< Number of chunks removed from the queue without being popped
+};
+
+/**
+ * \brief  Queue of chunks ordered by priority, the chunk with the lowest priority comes first.
+ *
+ * \section Behaviour
+ *   Chunks are kept in a binary heap, and the position of each chunk in the heap is kept in a
+ *   ChunkTable. Pushing a chunk which is already in the queue only lowers its priority if needed.
+ *   All priorities can be computed again at once with rekey, and chunks can be removed with cancel,
+ *   both in a time linear in the length of the queue.
+ */
+class ChunkQueue
+{
+public:
+    /**
+     * \brief  Add a chunk to the queue.
+     * \param  x x-coordinate of the chunk.
+     * \param  y y-coordinate of the chunk.
+     * \param  priority Priority of the chunk, lower is sooner.
+     * \return false if the chunk was already in the queue, its priority is then the lowest of both.
+     */
+    bool push(int x, int y, int64_t priority);
+
+    /**
+     * \brief  Remove the chunk with the lowest priority from the queue.
+     * \warning The queue must not be empty.
+     */
+    std::pair<int, int> pop();
+
+    /**
+     * \brief  Check if a chunk is in the queue.
+     */
+    bool contains(int x, int y) const;
+
+    /**
+     * \brief  Number of chunks in the queue.
+     */
+    size_t size() const;
+
+    /**
+     * \brief  Check if there is no chunk in the queue.
+     */
+    bool empty() const;
+
+    /**
+     * \brief  Remove every chunks, without counting them as cancelled.
+     */
+    void clear();
+
+    /**
+     * \brief  Change the priority of every chunks.
+     * \param  priority Function called as `priority(x, y, old_priority)` returning the new priority of a chunk.
+     */
+    template <typename Function>
+    void rekey(Function priority);
+
+    /**
+     * \brief  Remove chunks from the queue.
+     * \param  predicate Function called as `predicate(x, y, priority)` returning true for chunks to remove.
+     * \return The number of chunks removed.
+     */
+    template <typename Predicate>
+    size_t cancel(Predicate predicate);
+
+    /**
+     * \brief  Get the counters of the queue.
+     */
+    ChunkQueueStats getStats() const;
+
+private:
+    /**
+     * \brief  A chunk in the heap.
+     */
+    struct Entry
+    {
+        int x;            ///< x-coordinate of the chunk
+        int y;            ///< y-coordinate of the chunk
+        int64_t priority; ///< Priority of the chunk, lower is sooner
+    };
+
+    /**
+     * \brief  Move an entry towards the root while its parent has a higher priority.
+     */
+    void siftUp(size_t i);
+
+    /**
+     * \brief  Move an entry towards the leaves while a child has a lower priority.
+     */
+    void siftDown(size_t i);
+
+    /**
+     * \brief  Put an entry at a position of the heap, updating its index.
+     */
+    void place(size_t i, const Entry& entry);
+
+    /**
+     * \brief  Restore the heap property and the indices after entries were changed.
+     */
+    void rebuild();
+
+    std::vector<Entry> heap;      ///< Binary heap of the chunks
+    ChunkTable<size_t> positions; ///< Position of each chunk in the heap
+
+    ChunkQueueStats stats; ///< Counters of the queue, the length excepted
+};
+
+
+inline bool ChunkQueue::push(int x, int y, int64_t priority)
+{
+    size_t* position = positions.find(x, y);
+
+    if (position != nullptr)
+    {
+        stats.duplicates++;
+
+        if (priority < heap[*position].priority)
+        {
+            heap[*position].priority = priority;
+            siftUp(*position);
+        }
+
+        return false;
+    }
+
+    stats.pushed++;
+    heap.push_back(Entry{x, y, priority});
+    positions.insert(x, y, heap.size() - 1);
+    siftUp(heap.size() - 1);
+
+    return true;
+}
+
+inline std::pair<int, int> ChunkQueue::pop()
+{
+    assert(!heap.empty());
+
+    Entry top = heap.front();
+    positions.erase(top.x, top.y);
+
+    Entry last = heap.back();
+    heap.pop_back();
+
+    if (!heap.empty())
+    {
+        place(0, last);
+        siftDown(0);
+    }
+
+    return {top.x, top.y};
+}
+
+inline bool ChunkQueue::contains(int x, int y) const
+{
+    return positions.contains(x, y);
+}
+
+inline size_t ChunkQueue::size() const
+{
+    return heap.size();
+}
+
+inline bool ChunkQueue::empty() const
+{
+    return heap.empty();
+}
+
+inline void ChunkQueue::clear()
+{
+    heap.clear();
+    positions.clear();
+}
+
+template <typename Function>
+void ChunkQueue::rekey(Function priority)
+{
+    for (Entry& entry : heap)
+        entry.priority = priority(entry.x, entry.y, entry.priority);
+
+    rebuild();
+}
+
+template <typename Predicate>
+size_t ChunkQueue::cancel(Predicate predicate)
+{
+    size_t kept = 0;
+
+    for (size_t i = 0 ; i < heap.size() ; i++)
+    {
+        if (predicate(heap[i].x, heap[i].y, heap[i].priority))
+            positions.erase(heap[i].x, heap[i].y);
+        else
+            heap[kept++] = heap[i];
+    }
+
+    size_t cancelled = heap.size() - kept;
+    heap.resize(kept);
+    stats.cancelled += cancelled;
+
+    if (cancelled > 0)
+        rebuild();
+
+    return cancelled;
+}
+
+inline ChunkQueueStats ChunkQueue::getStats() const
+{
+    ChunkQueueStats result = stats;
+    result.length = heap.size();
+    return result;
+}
+
+inline void ChunkQueue::siftUp(size_t i)
+{
+    Entry entry = heap[i];
+
+    while (i > 0)
+    {
+        size_t parent = (i - 1) / 2;
+
+        if (heap[parent].priority <= entry.priority)
+            break;
+
+        place(i, heap[parent]);
+        i = parent;
+    }
+
+    place(i, entry);
+}
+
+inline void ChunkQueue::siftDown(size_t i)
+{
+    Entry entry = heap[i];
+
+    while (true)
+    {
+        size_t child = 2 * i + 1;
+
+        if (child >= heap.size())
+            break;
+
+        if (child + 1 < heap.size() && heap[child + 1].priority < heap[child].priority)
+            child++;
+
+        if (entry.priority <= heap[child].priority)
+            break;
+
+        place(i, heap[child]);
+        i = child;
+    }
+
+    place(i, entry);
+}
+
+inline void ChunkQueue::place(size_t i, const Entry& entry)
+{
+    heap[i] = entry;
+    *positions.find(entry.x, entry.y) = i;
+}
+
+inline void ChunkQueue::rebuild()
+{
+    // Floyd's construction, it also updates the position of each entry
+    for (size_t i = 0 ; i < heap.size() ; i++)
+        *positions.find(heap[i].x, heap[i].y) = i;
+
+    for (size_t i = heap.size() / 2 ; i-- > 0 ;)
+        siftDown(i);
+}
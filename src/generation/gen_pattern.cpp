@@ -49,7 +49,7 @@ Pattern generate_maze(int width, int height)
         visited[x][y] = true;
 
         std::vector<Point> rand_directions = {{0, +1}, {0, -1}, {+1, 0}, {-1, 0}};
-        std::random_shuffle(begin(rand_directions), end(rand_directions));
+        std::shuffle(begin(rand_directions), end(rand_directions), RandGen::engine());
 
         for (Point direction : rand_directions)
         {
@@ -114,13 +114,15 @@ Pattern generate_hallway(Point cell1, Point cell2)
 
 void cavestyle_patch(Pattern& pattern, int nb_additions)
 {
-    Pattern frontier;
+    // Cells next to the pattern, a cell is picked by its index and replaced by the last one
+    std::vector<Point> frontier;
+    Pattern in_frontier;
 
     // Function to add a new cell to frontier, if it isn't already in the pattern.
-    auto addSurrounding = [&pattern, &frontier](Point cell)
+    auto addSurrounding = [&pattern, &frontier, &in_frontier](Point cell)
     {
-        if (pattern.count(cell) == 0)
-            frontier.insert(cell);
+        if (!pattern.contains(cell) && in_frontier.insert(cell))
+            frontier.push_back(cell);
     };
 
     // Add cells around the first ones
@@ -133,22 +135,21 @@ void cavestyle_patch(Pattern& pattern, int nb_additions)
     }
 
     // Create noise
-    for(int nb_cells = 0 ; nb_cells < nb_additions ; nb_cells++)
+    for(int nb_cells = 0 ; nb_cells < nb_additions && !frontier.empty() ; nb_cells++)
     {
-        // Select a cell to insert
-        auto selected = frontier.begin();
+        // Select a cell to insert, it can't be selected anymore
+        size_t index = RandGen::uniform_int(0, static_cast<int>(frontier.size()) - 1);
+        Point selected = frontier[index];
+        frontier[index] = frontier.back();
+        frontier.pop_back();
 
-        std::advance(selected, RandGen::uniform_int(0, frontier.size()-1));
-        pattern.insert(*selected);
+        pattern.insert(selected);
 
         // Refresh frontier set of the pattern
-        addSurrounding((*selected) + std::make_pair(1, 0));
-        addSurrounding((*selected) + std::make_pair(0, 1));
-        addSurrounding((*selected) - std::make_pair(1, 0));
-        addSurrounding((*selected) - std::make_pair(0, 1));
-
-        // Can't select this cell anymore
-        frontier.erase(selected);
+        addSurrounding(selected + std::make_pair(1, 0));
+        addSurrounding(selected + std::make_pair(0, 1));
+        addSurrounding(selected - std::make_pair(1, 0));
+        addSurrounding(selected - std::make_pair(0, 1));
     }
 }
 
@@ -157,9 +158,289 @@ Pattern generate_cave(int size)
     if (size < 0)
         size = 1;
 
+    // Stairs can be placed on the two first cells
     Pattern cells;
     cells.insert({0, 0});
-    cavestyle_patch(cells, size-1);
+
+    if (size > 1)
+        cells.insert({1, 0});
+
+    cavestyle_patch(cells, size - static_cast<int>(cells.size()));
+    return cells;
+}
+
+
+/* *************** Cellular automaton *************** */
+
+namespace
+{
+    typedef uint64_t Word; ///< Bits of consecutive cells of a row
+
+    constexpr int WORD_BITS = 64;          ///< Number of cells in a word
+    constexpr int CELLULAR_WALLS = 45;     ///< Percentage of walls before the automaton runs
+    constexpr int CELLULAR_STEPS = 4;      ///< Number of steps of the automaton
+    constexpr float CELLULAR_FLOORS = .5f; ///< Approximate proportion of the square kept in the cave
+
+    /**
+     * \brief Cells of a square, as rows of bits.
+     *
+     * The bit `x % WORD_BITS` of the word `x / WORD_BITS` of the row `y` is the cell `(x, y)`. Bits after
+     * the last cell of each row, and rows outside of the grid are walls.
+     */
+    struct BitGrid
+    {
+        int side;               ///< Number of cells of each row and column
+        int row_words;          ///< Number of words of each row
+        std::vector<Word> bits; ///< Words of each row, one row after the other
+
+        /**
+         * \brief Create a grid full of walls.
+         */
+        explicit BitGrid(int nside) :
+            side(nside),
+            row_words((nside + WORD_BITS - 1) / WORD_BITS),
+            bits(static_cast<size_t>(nside) * row_words, ~Word(0))
+        {}
+
+        /**
+         * \brief Get a word of a row, rows outside of the grid are walls.
+         */
+        Word word(int y, int k) const
+        {
+            return y >= 0 && y < side ? bits[y * row_words + k] : ~Word(0);
+        }
+
+        bool test(int x, int y) const
+        {
+            return (bits[y * row_words + x / WORD_BITS] >> (x % WORD_BITS)) & 1;
+        }
+
+        void set(int x, int y, bool value)
+        {
+            Word mask = Word(1) << (x % WORD_BITS);
+            Word& row = bits[y * row_words + x / WORD_BITS];
+            row = value ? row | mask : row & ~mask;
+        }
+    };
+
+    /**
+     * \brief Move each cell of a row to the cell on its right, the first cell becomes a wall.
+     */
+    inline Word shift_right(const BitGrid& grid, int y, int k)
+    {
+        Word previous = k > 0 ? grid.word(y, k - 1) : ~Word(0);
+        return (grid.word(y, k) << 1) | (previous >> (WORD_BITS - 1));
+    }
+
+    /**
+     * \brief Move each cell of a row to the cell on its left, the last cell gets the wall after the row.
+     */
+    inline Word shift_left(const BitGrid& grid, int y, int k)
+    {
+        Word next = k + 1 < grid.row_words ? grid.word(y, k + 1) : ~Word(0);
+        return (grid.word(y, k) >> 1) | (next << (WORD_BITS - 1));
+    }
+
+    /**
+     * \brief Run a step of the automaton: a cell becomes a wall if at least 5 cells of its 3x3 square are walls.
+     */
+    void cellular_step(const BitGrid& grid, BitGrid& next)
+    {
+        // Bits after the last cell of a row stay walls
+        int last_bits = grid.side - (grid.row_words - 1) * WORD_BITS;
+        Word padding = last_bits == WORD_BITS ? 0 : ~Word(0) << last_bits;
+
+        for (int y = 0 ; y < grid.side ; y++)
+        {
+            for (int k = 0 ; k < grid.row_words ; k++)
+            {
+                // Number of walls of each 3x3 square, as 4 planes of bits
+                Word count[4] = {0, 0, 0, 0};
+
+                for (int dy = -1 ; dy <= 1 ; dy++)
+                {
+                    Word planes[3] = {shift_right(grid, y + dy, k), grid.word(y + dy, k), shift_left(grid, y + dy, k)};
+
+                    for (Word carry : planes)
+                    {
+                        for (Word& bit : count)
+                        {
+                            Word overflow = bit & carry;
+                            bit ^= carry;
+                            carry = overflow;
+                        }
+                    }
+                }
+
+                Word walls = count[3] | (count[2] & (count[1] | count[0]));
+
+                if (k == grid.row_words - 1)
+                    walls |= padding;
+
+                next.bits[y * grid.row_words + k] = walls;
+            }
+        }
+    }
+
+    /**
+     * \brief Set random walls in a square, then run the automaton on it.
+     */
+    BitGrid cellular_square(int side)
+    {
+        // Random walls, the border of the square always is a wall
+        BitGrid grid(side);
+        for (int y = 1 ; y < side - 1 ; y++)
+            for (int x = 1 ; x < side - 1 ; x++)
+                grid.set(x, y, RandGen::uniform_int(0, 99) < CELLULAR_WALLS);
+
+        BitGrid next(side);
+        for (int step = 0 ; step < CELLULAR_STEPS ; step++)
+        {
+            cellular_step(grid, next);
+            std::swap(grid, next);
+        }
+
+        return grid;
+    }
+
+    /**
+     * \brief Find the biggest group of connected floors of a grid.
+     * \param grid         The cells of the square.
+     * \param group        Filled with the group of each cell, -1 for the walls.
+     * \param biggest_size Set to the number of cells of the biggest group.
+     * \return The biggest group, or -1 if there are only walls.
+     */
+    int biggest_group(const BitGrid& grid, std::vector<int>& group, size_t& biggest_size)
+    {
+        int side = grid.side;
+        group.assign(side * side, -1);
+
+        std::vector<Point> stack;
+        int biggest = -1;
+        int nb_groups = 0;
+        biggest_size = 0;
+
+        for (int y = 0 ; y < side ; y++)
+        {
+            for (int x = 0 ; x < side ; x++)
+            {
+                if (grid.test(x, y) || group[y * side + x] != -1)
+                    continue;
+
+                size_t group_size = 0;
+                group[y * side + x] = nb_groups;
+                stack.push_back({x, y});
+
+                while (!stack.empty())
+                {
+                    Point cell = stack.back();
+                    stack.pop_back();
+                    group_size++;
+
+                    for (Point dir : {Point(1, 0), Point(-1, 0), Point(0, 1), Point(0, -1)})
+                    {
+                        Point neighbour = cell + dir;
+
+                        if (neighbour.first < 0 || neighbour.first >= side || neighbour.second < 0 || neighbour.second >= side)
+                            continue;
+
+                        int& neighbour_group = group[neighbour.second * side + neighbour.first];
+
+                        if (neighbour_group == -1 && !grid.test(neighbour.first, neighbour.second))
+                        {
+                            neighbour_group = nb_groups;
+                            stack.push_back(neighbour);
+                        }
+                    }
+                }
+
+                if (group_size > biggest_size)
+                {
+                    biggest = nb_groups;
+                    biggest_size = group_size;
+                }
+
+                nb_groups++;
+            }
+        }
+
+        return biggest;
+    }
+}
+
+Pattern generate_cellular_cave(int size)
+{
+    // Stairs can be placed on the two first cells
+    size_t target = std::max(size, 2);
+    int side = std::max(4, static_cast<int>(std::ceil(std::sqrt(target / CELLULAR_FLOORS))));
+
+    // The automaton erodes the floors, the square grows until the biggest group has enough cells
+    std::vector<int> group;
+    size_t biggest_size;
+    int biggest = biggest_group(cellular_square(side), group, biggest_size);
+
+    while (biggest_size < target)
+    {
+        int grown = biggest_size > 0 ? static_cast<int>(std::ceil(side * std::sqrt(static_cast<float>(target) / biggest_size)))
+                                     : 2 * side;
+        side = std::max(side + 1, grown);
+        biggest = biggest_group(cellular_square(side), group, biggest_size);
+    }
+
+    // The cell (0, 0) is the cell of the group closest to the center, with a floor on its right if possible
+    Point center(side / 2, side / 2);
+    Point origin;
+    int origin_dist = -1;
+
+    for (bool need_right : {true, false})
+    {
+        for (int y = 0 ; y < side ; y++)
+        {
+            for (int x = 0 ; x < side ; x++)
+            {
+                bool in_group = group[y * side + x] == biggest;
+                bool right = x + 1 < side && group[y * side + x + 1] == biggest;
+
+                if (in_group && (right || !need_right) && (origin_dist == -1 || distance({x, y}, center) < origin_dist))
+                {
+                    origin = {x, y};
+                    origin_dist = distance(origin, center);
+                }
+            }
+        }
+
+        if (origin_dist != -1)
+            break;
+    }
+
+    // Keep the cells of the group closest to the origin, the group is visited breadth first so that it stays connected.
+    // The cell (1, 0) is added even if the group is a single column.
+    Pattern cells({{0, 0}, {1, 0}});
+    std::vector<Point> queue = {origin};
+    group[origin.second * side + origin.first] = -1;
+
+    for (size_t i_cell = 0 ; i_cell < queue.size() && cells.size() < target ; i_cell++)
+    {
+        Point cell = queue[i_cell];
+        cells.insert(cell - origin);
+
+        for (Point dir : {Point(1, 0), Point(-1, 0), Point(0, 1), Point(0, -1)})
+        {
+            Point neighbour = cell + dir;
+
+            if (neighbour.first < 0 || neighbour.first >= side || neighbour.second < 0 || neighbour.second >= side)
+                continue;
+
+            int& neighbour_group = group[neighbour.second * side + neighbour.first];
+
+            if (neighbour_group == biggest)
+            {
+                neighbour_group = -1;
+                queue.push_back(neighbour);
+            }
+        }
+    }
+
     return cells;
 }
 
@@ -6,7 +6,9 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
 #include <tuple>
+#include <vector>
 
 #include "../rand.hpp"
 
@@ -46,12 +48,26 @@ Pattern generate_maze(int width, int height);
  * \param size The number of cell the room contains
  * \return A set containing cells of the cave
  *
- * The room will be randomized. It will be centered on coordinate (0, 0).
+ * The room will be randomized. It will be centered on coordinate (0, 0), the cell (1, 0) is also in the
+ * room when it has more than one cell.
  * \note If the size is less than 1, the room will still be of size 1.
  * \warning Some coordinates will be negative.
  */
 Pattern generate_cave(int size);
 
+/**
+ * \brief Generate a cave with a cellular automaton.
+ * \param size The number of cells of the cave, at least 2.
+ * \return The cells of the cave, which are connected and contain (0, 0) and (1, 0).
+ *
+ * Cells of a square are randomly set as walls or floors, then each cell becomes a wall when most of the
+ * cells around it are walls, a few times. The biggest group of connected floors is the cave: the square
+ * grows until the group has enough cells, then only the cells of the group closest to its center are kept.
+ * The automaton computes whole rows of cells at once, a bit for each cell.
+ * \warning Some coordinates will be negative.
+ */
+Pattern generate_cellular_cave(int size);
+
 /**
  * \brief Generate a hallway from point cell1 to cell2.
  * \param cell1 Coordinates of first extremity of the path.
@@ -64,5 +80,7 @@ Pattern generate_hallway(Point cell1, Point cell2);
  * \brief Add cells to a pattern so that it looks cave styled.
  * \param pattern The pattern to modify into cave styled.
  * \param nb_additions The number of cells to add to the pattern.
+ *
+ * Each new cell is picked uniformly among the cells next to the pattern, in constant time.
  */
 void cavestyle_patch(Pattern& pattern, int nb_additions);
@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+#include "generation_pool.hpp"
+
+
+namespace
+{
+    constexpr size_t NO_WORKER = SIZE_MAX; ///< Index of the current thread when it isn't in a pool
+
+    thread_local const GenerationPool* current_pool = nullptr; ///< Pool of the current thread
+    thread_local size_t current_worker = NO_WORKER;            ///< Index of the current thread in its pool
+}
+
+GenerationPool& GenerationPool::instance()
+{
+    static GenerationPool pool {std::max(2u, std::thread::hardware_concurrency()) - 1};
+    return pool;
+}
+
+GenerationPool::GenerationPool(unsigned int n_threads) :
+    pending(0),
+    stopping(false),
+    next_worker(0)
+{
+    assert(n_threads >= 1);
+
+    for (unsigned int i = 0 ; i < n_threads ; i++)
+        workers.push_back(std::make_unique<Worker>());
+
+    for (unsigned int i = 0 ; i < n_threads ; i++)
+        threads.emplace_back(&GenerationPool::workerLoop, this, i);
+}
+
+GenerationPool::~GenerationPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(pending_lock);
+        stopping = true;
+    }
+
+    pending_cond.notify_all();
+
+    for (auto& thread : threads)
+        thread.join();
+}
+
+void GenerationPool::submit(Job job, bool priority)
+{
+    size_t worker = current_pool == this ? current_worker : next_worker++ % workers.size();
+
+    {
+        std::lock_guard<std::mutex> lock(workers[worker]->lock);
+
+        if (priority)
+            workers[worker]->jobs.push_front(std::move(job));
+        else
+            workers[worker]->jobs.push_back(std::move(job));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pending_lock);
+        pending++;
+    }
+
+    pending_cond.notify_one();
+}
+
+unsigned int GenerationPool::threadCount() const
+{
+    return static_cast<unsigned int>(threads.size());
+}
+
+bool GenerationPool::takeJob(size_t worker, Job& job)
+{
+    // Own jobs first
+    {
+        std::lock_guard<std::mutex> lock(workers[worker]->lock);
+
+        if (!workers[worker]->jobs.empty())
+        {
+            job = std::move(workers[worker]->jobs.front());
+            workers[worker]->jobs.pop_front();
+            return true;
+        }
+    }
+
+    // Then the next job of another thread, jobs with priority are at the front
+    for (size_t i = 1 ; i < workers.size() ; i++)
+    {
+        Worker& victim = *workers[(worker + i) % workers.size()];
+        std::lock_guard<std::mutex> lock(victim.lock);
+
+        if (!victim.jobs.empty())
+        {
+            job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void GenerationPool::workerLoop(size_t worker)
+{
+    current_pool = this;
+    current_worker = worker;
+
+    while (true)
+    {
+        // Reserve one of the jobs submitted
+        {
+            std::unique_lock<std::mutex> lock(pending_lock);
+            pending_cond.wait(lock, [this] { return stopping || pending > 0; });
+
+            if (pending == 0)
+                return;
+
+            pending--;
+        }
+
+        // Jobs are counted once they are in a list, thus there is one for each reservation
+        Job job;
+        while (!takeJob(worker, job))
+            std::this_thread::yield();
+
+        job();
+    }
+}
@@ -0,0 +1,97 @@
+/**
+ * \file   generation/generation_pool.hpp
+ * \brief  Threads shared by every generators.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/**
+ * \brief  Pool of threads running the jobs of every generators of the process.
+ *
+ * \section Behaviour
+ *   Each thread of the pool has its own list of jobs. A thread takes the jobs at the front of its
+ *   list, and when its list is empty it steals the job at the front of the list of another thread.
+ *   Jobs submitted by a thread of the pool are put in its own list, the other ones are given to each
+ *   thread in turn. Jobs with priority are put at the front of the list, so that they are run next,
+ *   by the thread of the list or by a thread with nothing else to do.
+ *
+ *   Threads sleep while there is no job.
+ */
+class GenerationPool
+{
+public:
+    typedef std::function<void()> Job; ///< A task run by a thread of the pool
+
+    /**
+     * \brief  Get the pool shared by the generators, it has a thread per core but one.
+     */
+    static GenerationPool& instance();
+
+    /**
+     * \brief  Start the threads of a pool.
+     * \param  n_threads Number of threads, at least one.
+     */
+    explicit GenerationPool(unsigned int n_threads);
+
+    GenerationPool(const GenerationPool&) = delete;
+    GenerationPool& operator=(const GenerationPool&) = delete;
+
+    /**
+     * \brief  Wait for the threads to run the remaining jobs and stop them.
+     */
+    ~GenerationPool();
+
+    /**
+     * \brief  Give a job to the pool.
+     * \param  job      The job to run.
+     * \param  priority If set to true, the job is run before the jobs waiting without priority.
+     */
+    void submit(Job job, bool priority = false);
+
+    /**
+     * \brief  Number of threads of the pool.
+     */
+    unsigned int threadCount() const;
+
+private:
+    /**
+     * \brief  Jobs given to a thread of the pool.
+     */
+    struct Worker
+    {
+        std::deque<Job> jobs; ///< Jobs of the thread, taken and stolen from the front
+        std::mutex lock;      ///< Lock for jobs
+    };
+
+    /**
+     * \brief  Take a job from the list of a thread, or steal one from another thread.
+     * \return false if every lists are empty.
+     */
+    bool takeJob(size_t worker, Job& job);
+
+    /**
+     * \brief  Loop of a thread of the pool.
+     */
+    void workerLoop(size_t worker);
+
+    std::vector<std::unique_ptr<Worker>> workers; ///< The jobs of each thread
+    std::vector<std::thread> threads;             ///< Threads of the pool
+
+    std::mutex pending_lock;             ///< Lock for pending and stopping
+    std::condition_variable pending_cond; ///< Notified when a job is submitted or the pool stops
+    size_t pending;                      ///< Number of jobs submitted but not taken yet
+    bool stopping;                       ///< The threads must stop when there is no job left
+
+    std::atomic<size_t> next_worker; ///< Thread receiving the next job submitted from outside the pool
+};
@@ -1,143 +1,407 @@
+#include <cstdlib>
+
 #include "generator.hpp"
 
-using namespace std::chrono_literals;
+
+namespace
+{
+    constexpr int64_t NORMAL_PRIORITY = INT64_C(1) << 32; ///< Added to the priority of chunks requested without priority
+
+    constexpr uint32_t ROOMS_STREAM = 0; ///< Purpose of the random stream used to add rooms around a chunk
+
+    constexpr int LINK_DISTANCE = 2 * LinkIndex::CELL; ///< Distance at which rooms are linked without looking at every rooms
+
+    constexpr uint32_t REPLAY_SAVE = UINT32_MAX; ///< Starts saves holding the filled chunks instead of the rooms
+
+    /**
+     * \brief Get the priority of a chunk in the list of chunks to generate.
+     */
+    int64_t generation_priority(int x, int y, std::pair<int, int> focus, bool priority)
+    {
+        int64_t dx = x - focus.first;
+        int64_t dy = y - focus.second;
+
+        return dx * dx + dy * dy + (priority ? 0 : NORMAL_PRIORITY);
+    }
+}
 
 
-Generator::Generator()
+Generator::Generator() :
+    level_seed(0),
+    do_generate(false),
+    scheduled(false),
+    foreground(true),
+    focus(0, 0),
+    nb_published_fills(0),
+    replayable(false),
+    progress(0)
 {
     parameters.infinite = false;
     setFilledChunk(0, 0);
+    publish();
+    receive();
 }
 
-Generator::Generator(const GenerationMode& parameters) :
-    parameters(parameters)
+Generator::Generator(const GenerationMode& parameters, uint64_t seed) :
+    parameters(parameters),
+    level_seed(seed),
+    do_generate(false),
+    scheduled(false),
+    foreground(true),
+    focus(0, 0),
+    nb_published_fills(0),
+    replayable(true),
+    progress(0)
 {
-    if (parameters.infinite)
-    {
-        do_generate = true;
-        generating_thread = std::thread(&Generator::generationLoop, this);
-    }
-    else
-    {
-        do_generate = false;
-    }
+    // A finite level is generated by the pool once it is requested
+    startGeneration();
 }
 
 Generator::~Generator()
 {
-    if (do_generate)
-    {
-        do_generate = false;
-        generating_thread.join();
-    }
+    stopGeneration();
 }
 
-Chunk Generator::getChunkCells(int x, int y)
+Chunk Generator::takeChunkCells(int x, int y)
 {
-    if (!parameters.infinite && !isFilledChunk(0, 0)) {
-        addRooms(0, 0, parameters.nb_rooms);
-        setFilledChunk(0, 0);
+    if (!parameters.infinite && !ready.count({0, 0})) {
+        // The whole level is generated by the pool
+        preGenerateRadius(0, 0, 0, true);
+        while (!ready.count({0, 0}))
+            waitPublication();
     }
-    else if (parameters.infinite && !isLockedChunk(x, y)) {
+    else if (parameters.infinite && !locked.count({x, y})) {
         // Only generate this chunk
         generateRadius(x, y, 0);
     }
 
-    setLockedChunk(x, y);
-    std::lock_guard<std::mutex> lock(cache_lock);
+    receive();
+    lockChunk(x, y);
 
-    // Filter interesting cells and entities
-    if (cached_map.hasChunk(x, y))
-        return cached_map.chunkAt(x, y);
-    else
-        return Chunk();
+    // The chunk won't change anymore, it is given to the caller
+    Chunk cells;
+    PublishedChunk* chunk = published.find(x, y);
+
+    if (chunk != nullptr && chunk->has_cells)
+    {
+        if (chunk->cells)
+            cells = *chunk->cells;
+        chunk->cells = nullptr;
+        chunk->has_cells = false;
+
+        if (chunk->entities.empty())
+            published.erase(x, y);
+    }
+
+    return cells;
 }
 
 std::vector<std::pair<int, int>> Generator::getCachedChunks()
 {
     std::vector<std::pair<int, int>> ret;
+    receive();
 
-    for (const auto& item: cached_map.getChunks())
-    {
-        if (!isLockedChunk(item.first, item.second))
-            ret.push_back(item);
-    }
+    for (size_t i = 0 ; i < published.size() ; i++)
+        if (published.valueAt(i).has_cells)
+            ret.push_back(published.idAt(i));
 
     return ret;
 }
 
-std::vector<std::shared_ptr<Entity>> Generator::getChunkEntities(int x, int y)
+std::vector<std::shared_ptr<Entity>> Generator::takeChunkEntities(int x, int y)
 {
-    if (parameters.infinite && !isLockedChunk(x, y)) {
+    if (parameters.infinite && !locked.count({x, y})) {
         // Only generate this chunk
         generateRadius(x, y, 0);
     }
 
-    setLockedChunk(x, y);
-    std::vector<std::shared_ptr<Entity>> copy;
-    std::lock_guard<std::mutex> lock(cache_lock);
+    receive();
+    lockChunk(x, y);
 
-    if (cached_entities.count({x, y}))
-        for (auto& entity : cached_entities[{x, y}])
-            copy.push_back(entity->copy());
+    std::vector<std::shared_ptr<Entity>> entities;
+    PublishedChunk* chunk = published.find(x, y);
 
-    return copy;
+    if (chunk != nullptr)
+    {
+        entities = std::move(chunk->entities);
+        chunk->entities.clear();
+
+        if (!chunk->has_cells)
+            published.erase(x, y);
+    }
+
+    return entities;
 }
 
 void Generator::preGenerateRadius(int x, int y, int radius, bool priority)
 {
     assert(radius >= 0);
 
+    receive();
+    std::lock_guard<std::mutex> lock(to_generate_lock);
+
+    // Every room of a finite level is added around the chunk (0, 0)
     if (!parameters.infinite)
+    {
+        if (!ready.count({0, 0}))
+            to_generate.push(0, 0, 0);
+
+        schedule();
         return;
+    }
 
-    std::lock_guard<std::mutex> lock(to_generate_lock);
+    // Distances are now computed from the chunk the caller is waiting for
+    if (priority)
+        setFocus(x, y);
 
     // Radius of generated chunks
-    int gen_radius = radius + GEN_BORDER;
-    auto task = spiral(x, y, gen_radius);
+    int gen_radius = radius + Chunk::chunk_span(GEN_BORDER);
 
-    // We really want to generate the center first
-    if (priority)
-        std::reverse(begin(task), end(task));
+    // Chunks filled but not received yet are skipped by the generation
+    for (auto& chunk_id: spiral(x, y, gen_radius))
+        if (!ready.count(chunk_id))
+            to_generate.push(chunk_id.first, chunk_id.second,
+                             generation_priority(chunk_id.first, chunk_id.second, focus, priority));
 
-    for (auto& chunk_id: task)
-    {
-        if (priority)
-            to_generate.push_front(chunk_id);
-        else
-            to_generate.push_back(chunk_id);
-    }
+    schedule();
+}
+
+void Generator::preGenerateArea(int x_min, int y_min, int x_max, int y_max, int focus_x, int focus_y)
+{
+    assert(x_min <= x_max && y_min <= y_max);
+
+    if (!parameters.infinite)
+        return;
+
+    receive();
+    std::lock_guard<std::mutex> lock(to_generate_lock);
+    setFocus(focus_x, focus_y);
+
+    int border = Chunk::chunk_span(GEN_BORDER);
+
+    for (int x = x_min - border ; x <= x_max + border ; x++)
+        for (int y = y_min - border ; y <= y_max + border ; y++)
+            if (!ready.count({x, y}))
+                to_generate.push(x, y, generation_priority(x, y, focus, false));
+
+    schedule();
 }
 
-void Generator::generateRadius(int x, int y, int radius)
+size_t Generator::cancelOutside(int x, int y, int radius)
 {
     assert(radius >= 0);
 
+    return cancelOutside(x - radius, y - radius, x + radius, y + radius);
+}
+
+size_t Generator::cancelOutside(int x_min, int y_min, int x_max, int y_max)
+{
+    assert(x_min <= x_max && y_min <= y_max);
+
+    // The finite level is generated whatever the position of the caller
     if (!parameters.infinite)
+        return 0;
+
+    int border = Chunk::chunk_span(GEN_BORDER);
+    std::lock_guard<std::mutex> lock(to_generate_lock);
+
+    return to_generate.cancel([x_min, y_min, x_max, y_max, border](int cx, int cy, int64_t) {
+        return cx < x_min - border || cx > x_max + border || cy < y_min - border || cy > y_max + border;
+    });
+}
+
+size_t Generator::getFilledCount()
+{
+    receive();
+    return ready.size();
+}
+
+ChunkQueueStats Generator::getQueueStats()
+{
+    std::lock_guard<std::mutex> lock(to_generate_lock);
+    return to_generate.getStats();
+}
+
+void Generator::setFocus(int x, int y)
+{
+    if (focus == std::make_pair(x, y))
         return;
 
+    focus = {x, y};
+    to_generate.rekey([this](int cx, int cy, int64_t old_priority) {
+        return generation_priority(cx, cy, focus, old_priority < NORMAL_PRIORITY);
+    });
+}
+
+bool Generator::generateRadius(int x, int y, int radius)
+{
+    assert(radius >= 0);
+
+    if (!parameters.infinite)
+        return false;
+
+    // Chunks which are ready are taken without waiting for the generation
+    receive();
+    if (allReady(x, y, radius))
+        return false;
+
     preGenerateRadius(x, y, radius, true);
 
+    // Locked chunks won't change anymore, there is no need to wait for their surrounding
+    bool all_locked = true;
+
+    for (int nx = x - radius ; nx <= x + radius && all_locked ; nx++)
+        for (int ny = y - radius ; ny <= y + radius && all_locked ; ny++)
+            all_locked = locked.count({nx, ny}) != 0;
+
+    if (all_locked)
+        return false;
+
+    // The publications are received until every chunk is filled
+    bool waited = false;
+    while (!allReady(x, y, radius))
+    {
+        waited = true;
+        waitPublication();
+    }
+
+    return waited;
+}
+
+bool Generator::isReady(int x, int y)
+{
+    receive();
+
+    if (!parameters.infinite)
+        return ready.count({0, 0}) != 0;
+
+    return allReady(x, y, 0);
+}
+
+float Generator::getProgress()
+{
+    receive();
+
+    if (parameters.infinite || ready.count({0, 0}))
+        return 1.f;
+
+    // Each room is created, registered, and linked to the others
+    float steps = 3.f * std::max(parameters.nb_rooms, 1);
+    return std::min(progress.load() / steps, 0.99f);
+}
+
+bool Generator::allReady(int x, int y, int radius) const
+{
     // Radius of generated chunks
-    int gen_radius = radius + GEN_BORDER;
+    int gen_radius = radius + Chunk::chunk_span(GEN_BORDER);
 
     for (int nx = x - gen_radius ; nx <= x + gen_radius ; nx++)
         for (int ny = y - gen_radius ; ny <= y + gen_radius ; ny++)
-            while (!isFilledChunk(nx, ny))
-                std::this_thread::sleep_for(10ms);
+            if (!ready.count({nx, ny}))
+                return false;
+
+    return true;
+}
+
+void Generator::lockChunk(int x, int y)
+{
+    if (locked.insert({x, y}).second)
+        locks.push({x, y});
 }
 
-bool Generator::isLockedChunk(int x, int y)
+void Generator::waitPublication()
 {
-    std::lock_guard<std::mutex> lock(locked_lock);
-    return locked.find({x, y}) != end(locked);
+    {
+        std::unique_lock<std::mutex> lock(publication_lock);
+        publication_cond.wait(lock, [this] { return !publications.empty(); });
+    }
+
+    receive();
 }
 
-void Generator::setLockedChunk(int x, int y)
+void Generator::receive()
 {
-    std::lock_guard<std::mutex> lock(locked_lock);
-    locked.insert({x, y});
+    ChunkPublication publication;
+
+    while (publications.pop(publication))
+    {
+        const auto& id = publication.chunk;
+
+        if (publication.filled)
+            ready.insert(id);
+        // Chunks published before the generation knew they are locked are outdated
+        else if (!locked.count(id))
+        {
+            PublishedChunk& chunk = published(id.first, id.second);
+            chunk.cells = std::move(publication.cells);
+            chunk.has_cells = true;
+            chunk.entities = std::move(publication.entities);
+        }
+    }
+}
+
+void Generator::publish()
+{
+    receiveLocks();
+
+    for (size_t i = 0 ; i < unpublished.size() ; i++)
+    {
+        auto id = unpublished.idAt(i);
+        if (cache_locked.count(id))
+            continue;
+
+        ChunkPublication publication;
+        publication.chunk = id;
+
+        // The cells are shared rather than copied, the generation copies them before modifying them again
+        CachedChunk* cached = cached_cells.find(id.first, id.second);
+        if (cached != nullptr)
+        {
+            publication.cells = cached->cells;
+            cached->published = true;
+        }
+
+        auto entities = cached_entities.find(id);
+        if (entities != end(cached_entities))
+            publication.entities = entities->second;
+
+        publications.push(std::move(publication));
+    }
+
+    unpublished.clear();
+
+    // The chunks around a filled chunk are published before it
+    {
+        std::lock_guard<std::mutex> lock(filled_lock);
+
+        for ( ; nb_published_fills < fill_order.size() ; nb_published_fills++)
+        {
+            ChunkPublication publication;
+            publication.chunk = fill_order[nb_published_fills];
+            publication.filled = true;
+            publications.push(std::move(publication));
+        }
+    }
+
+    // The thread taking the chunks checks the queue with this lock held before waiting
+    {
+        std::lock_guard<std::mutex> lock(publication_lock);
+    }
+
+    publication_cond.notify_all();
+}
+
+void Generator::receiveLocks()
+{
+    std::pair<int, int> id;
+
+    while (locks.pop(id))
+    {
+        cache_locked.insert(id);
+        unpublished.erase(id.first, id.second);
+        cached_cells.erase(id.first, id.second);
+        cached_entities.erase(id);
+    }
 }
 
 bool Generator::isFilledChunk(int x, int y)
@@ -150,12 +414,18 @@ void Generator::setFilledChunk(int x, int y)
 {
     std::lock_guard<std::mutex> lock(filled_lock);
     filled.insert({x, y});
+    fill_order.push_back({x, y});
 }
 
 void Generator::addRooms(int x, int y, int n)
 {
     assert(n >= 0);
 
+    bool first_rooms = rooms.empty();
+
+    // Random numbers only depend on the level and the chunk, not on the thread nor on previous chunks
+    RandGen::seed(CounterEngine::key(level_seed, x, y, ROOMS_STREAM));
+
     // Create rooms of random size
     for (int i_room = 0 ; i_room < n ; i_room++)
     {
@@ -178,6 +448,10 @@ void Generator::addRooms(int x, int y, int n)
                     cells = generate_cave(room_size);
                     break;
 
+                case LevelType::Cellular:
+                    cells = generate_cellular_cave(room_size);
+                    break;
+
                 case LevelType::Flat:
                 default:
                     cells = generate_rectangle(room_size);
@@ -190,23 +464,39 @@ void Generator::addRooms(int x, int y, int n)
         // Place the room at the center of given chunk
         room.setPosition({(2*x + 1) * Chunk::SIZE / 2, (2*y + 1) * Chunk::SIZE / 2});
         rooms.push_back(room);
+        progress++;
     }
 
     if (rooms.size() > 1)
     {
         // Places rooms in a non-linear way, room of index 0 must not move
-        separate_rooms(rooms, parameters.room_margin, std::max(1, (int) rooms.size() - n), rooms.size());
+        size_t first_new = std::max(1, (int) rooms.size() - n);
+        gridRooms(first_new);
+        separate_rooms(rooms, parameters.room_margin, first_new, rooms.size(), room_grid);
 
         // Remove rooms that colapse, not the one of index 0
-        size_t i_room = std::max(1, (int) rooms.size() - n);
+        size_t i_room = first_new;
+        std::vector<size_t> near;
         while (i_room < rooms.size())
         {
             bool superposed = false;
 
-            // Check if a room colapse with i
-            for (size_t j_room = 0 ; j_room < i_room ; j_room++)
+            // Check if a room colapse with i, previous rooms are found from their position
+            const Room& room = rooms[i_room];
+            room_grid.near(room.getBounds().first + room.getPosition(), room.getBounds().second + room.getPosition(), 0, near);
+
+            for (size_t j_room : near)
+            {
+                if (!spaced(room, rooms[j_room], 1))
+                {
+                    superposed = true;
+                    break;
+                }
+            }
+
+            for (size_t j_room = first_new ; j_room < i_room && !superposed ; j_room++)
             {
-                if (!spaced(rooms[i_room], rooms[j_room], 1))
+                if (!spaced(room, rooms[j_room], 1))
                 {
                     superposed = true;
                     break;
@@ -229,7 +519,7 @@ void Generator::addRooms(int x, int y, int n)
     }
 
     // Add stairs
-    if (filled.empty())
+    if (first_rooms)
     {
         // Add entrance in first map
         rooms[0].addEntity(std::make_shared<Entity>(
@@ -257,88 +547,90 @@ void Generator::addRooms(int x, int y, int n)
 
     // Copy rooms to the cached map and entities
     for (size_t i_room = rooms.size() - n ; i_room < rooms.size() ; i_room++)
-    registerRoom(i_room);
+    {
+        registerRoom(i_room);
+        progress++;
+    }
 
     // Add ways between rooms
     updateLinks();
+
+    // Rooms and hallways are now at their final position
+    gridRooms(rooms.size());
 }
 
 void Generator::updateLinks()
 {
-    size_t nb_rooms = rooms.size();
+    size_t first_new = link_index.size();
 
-    // Create a union-find representing connections
-    std::vector<size_t> size_uf(nb_rooms, 1);
-    std::vector<size_t> link_uf(nb_rooms);
-    for (size_t i = 0 ; i < nb_rooms ; i++)
-        link_uf[i] = i;
+    // Index the rooms added since the last call, their positions won't change anymore
+    for (size_t i_room = first_new ; i_room < rooms.size() ; i_room++)
+        indexRoom(i_room);
 
-    // Access function for the union find
-    std::function<size_t(size_t)> comp_repr = [&comp_repr, &link_uf] (size_t i_room) -> size_t
-    {
-        assert(i_room < link_uf.size());
+    // Links of rooms loaded from a save are only known by room_links
+    if (first_new == 0)
+        for (const auto& link : room_links)
+            link_index.merge(link.first, link.second);
 
-        if (link_uf[i_room] == i_room)
-            return i_room;
+    // Vertices (dist(i, j), i, j, closest nodes of i and j) in an increasing order, only between rooms close to each other
+    typedef std::tuple<int, size_t, size_t, Point, Point> Edge;
+    std::priority_queue<Edge, std::vector<Edge>, std::greater<Edge>> candidates;
 
-        size_t repr = comp_repr(link_uf[i_room]);
-        link_uf[i_room] = repr;
-        return repr;
+    // The closest nodes are kept with the vertex, they are used again to add the hallway
+    auto add_candidate = [this, &candidates](size_t i, size_t j)
+    {
+        auto nodes = closest_nodes(rooms[i], rooms[j]);
+        int dist = distance(nodes.first + rooms[i].getPosition(), nodes.second + rooms[j].getPosition());
+        candidates.push(std::make_tuple(dist, i, j, nodes.first, nodes.second));
     };
 
-    // Function to merge two components of the union-find
-    auto comp_merge = [comp_repr, &link_uf, &size_uf](size_t a, size_t b)
+    auto add_candidates = [this, &add_candidate](size_t room, int distance)
     {
-        assert(a < link_uf.size());
-        assert(b < link_uf.size());
-
-        if (comp_repr(a) != comp_repr(b))
+        link_index.forEachNear(room, distance, [this, &add_candidate, room](size_t other)
         {
-            size_uf[comp_repr(a)] = size_uf[comp_repr(a)] + size_uf[comp_repr(b)];
-            link_uf[comp_repr(b)] = comp_repr(a);
-        }
+            if (link_index.find(other) != link_index.find(room))
+                add_candidate(room, other);
+        });
     };
 
-    // Update the union find with current links
-    for (auto &link : room_links)
-        comp_merge(link.first, link.second);
+    for (size_t i_room = first_new ; i_room < rooms.size() ; i_room++)
+        add_candidates(i_room, LINK_DISTANCE);
 
-    // Create vertices (dist(i, j), i, j) in an increasing order if i and j are not in the same component yet
-    typedef std::tuple<int, size_t, size_t> Edge;
-    std::priority_queue<Edge, std::vector<Edge>, std::greater<Edge>> candidates;
+    // Rooms added before were connected, thus one of the new rooms is out of the set of the first room
+    // as long as the level is not connected
+    int distance = LINK_DISTANCE;
 
-    for (size_t i = 0 ; i < nb_rooms ; i++)
+    // Force connexity of the level
+    while (link_index.setSize(0) < rooms.size())
     {
-        for (size_t j = 0 ; j < i ; j++)
+        // Rooms were pushed away from every other room, look further around the rooms which are not connected yet
+        while (candidates.empty())
         {
-            if (comp_repr(i) != comp_repr(j))
-            {
-                int dist = ntn_dist(rooms[i], rooms[j]);
-                candidates.push(std::make_tuple(dist, i, j));
-            }
+            distance *= 2;
+
+            for (size_t i_room = first_new ; i_room < rooms.size() ; i_room++)
+                if (link_index.find(i_room) != link_index.find(0))
+                    add_candidates(i_room, distance);
         }
-    }
 
-    // Force connexity of the level
-    while (size_uf[comp_repr(0)] < nb_rooms)
-    {
         int dist;
         size_t l, r;
-        std::tie(dist, l, r) = candidates.top();
+        Point node_l, node_r;
+        std::tie(dist, l, r, node_l, node_r) = candidates.top();
         candidates.pop();
 
         // If these two rooms are not linked yet
-        if (comp_repr(l) != comp_repr(r))
+        if (link_index.find(l) != link_index.find(r))
         {
             // Add path between the two rooms
-            auto close_points = closest_nodes(rooms[l], rooms[r]);
-            Point hall_start = close_points.first + rooms[l].getPosition();
-            Point hall_end = close_points.second + rooms[r].getPosition();
+            Point hall_start = node_l + rooms[l].getPosition();
+            Point hall_end = node_r + rooms[r].getPosition();
 
             Pattern path_cells;
             switch (parameters.type)
             {
                 case LevelType::Cave:
+                case LevelType::Cellular:
                     path_cells = generate_hallway(hall_start, hall_end);
                     cavestyle_patch(path_cells, path_cells.size());
                     break;
@@ -353,154 +645,237 @@ void Generator::updateLinks()
             path.setPosition(hall_start);
             rooms.push_back(path);
 
-            room_links.insert({l, nb_rooms});
-            room_links.insert({nb_rooms, r});
-            registerRoom(nb_rooms);
+            size_t path_room = rooms.size() - 1;
+            room_links.insert({l, path_room});
+            room_links.insert({path_room, r});
+            registerRoom(path_room);
 
-            // Update union-find
-            nb_rooms++;
-            assert(nb_rooms == rooms.size());
+            indexRoom(path_room);
+            link_index.merge(l, path_room);
+            link_index.merge(path_room, r);
+            progress++;
 
-            link_uf.push_back(nb_rooms-1);
-            size_uf.push_back(1);
+            // Insert new possible distances to the new path
+            add_candidates(path_room, LINK_DISTANCE);
+        }
+    }
+}
 
-            assert(l < link_uf.size());
-            assert(r < link_uf.size());
+void Generator::indexRoom(size_t room)
+{
+    assert(room == link_index.size());
 
-            comp_merge(l, nb_rooms-1);
-            comp_merge(nb_rooms-1, r);
+    Point position = rooms[room].getPosition();
+    auto bounds = rooms[room].getNodesBounds();
 
-            // Insert new possible distances to the new path
-            for (size_t i = 0 ; i < nb_rooms-1 ; i++)
-            {
-                int dist = ntn_dist(rooms[i], rooms[nb_rooms-1]);
-                candidates.push(std::make_tuple(dist, i, nb_rooms-1));
-            }
-        }
+    link_index.add(bounds.first + position, bounds.second + position);
+}
+
+void Generator::gridRooms(size_t last)
+{
+    assert(last <= rooms.size());
+
+    for (size_t room = room_grid.size() ; room < last ; room++)
+    {
+        Point position = rooms[room].getPosition();
+        auto bounds = rooms[room].getBounds();
+
+        room_grid.add(bounds.first + position, bounds.second + position);
     }
 }
 
 void Generator::registerRoom(size_t room)
 {
-    std::lock_guard<std::mutex> lock(cache_lock);
+    // The room is split by chunk, each chunk is then written at once
+    ChunkTable<ChunkRaster> raster;
+    rasterise_room(rooms[room], raster);
 
-    // Add floor everywhere we can
-    for (Point cell : rooms[room].getCells())
+    for (size_t i_chunk = 0 ; i_chunk < raster.size() ; i_chunk++)
     {
-        int x = (cell + rooms[room].getPosition()).first;
-        int y = (cell + rooms[room].getPosition()).second;
+        auto chunk_id = raster.idAt(i_chunk);
+        ChunkRaster& part = raster.valueAt(i_chunk);
 
-        if (!cached_map.hasCell(x, y)) {
-            auto cpos = Chunk::sector(x, y);
-            cached_map.setChunk(cpos.first, cpos.second, Chunk());
-        }
+        // Locked chunks were given away, they must not be written anymore
+        if (cache_locked.count(chunk_id))
+            continue;
 
-        cached_map.cellAt(x, y) = CellType::Floor;
-    }
+        // Add floor everywhere we can, and walls on the surrounding only where there is no floor yet
+        bool has_cells = false;
+        for (int y = 0 ; y < Chunk::SIZE ; y++)
+            has_cells = has_cells || part.floors[y] != 0 || part.walls[y] != 0;
 
-    // Add walls on the surrounding : only where there is no floor yet
-    for (Point cell : surrounding(rooms[room].getCells()))
-    {
-        int x = (cell + rooms[room].getPosition()).first;
-        int y = (cell + rooms[room].getPosition()).second;
+        if (has_cells || !part.entities.empty())
+            unpublished(chunk_id.first, chunk_id.second) = 1;
 
-        if (!cached_map.hasCell(x, y)) {
-            auto cpos = Chunk::sector(x, y);
-            cached_map.setChunk(cpos.first, cpos.second, Chunk());
-        }
+        if (has_cells)
+        {
+            CachedChunk& cached = cached_cells(chunk_id.first, chunk_id.second);
+            if (!cached.cells)
+                cached.cells = std::make_shared<Chunk>();
+            else if (cached.published)
+                cached.cells = std::make_shared<Chunk>(*cached.cells);
+            cached.published = false;
 
-        if (cached_map.cellAt(x, y) == CellType::Empty)
-            cached_map.cellAt(x, y) = CellType::Wall;
-    }
+            Chunk& chunk = *cached.cells;
 
-    // Add entities in the cache
-    for (auto entity : rooms[room].getEntities())
-    {
-        auto position = std::make_pair(entity->getPosition().x, entity->getPosition().y);
-        int x = (position + rooms[room].getPosition()).first;
-        int y = (position + rooms[room].getPosition()).second;
+            for (int y = 0 ; y < Chunk::SIZE ; y++)
+            {
+                if (part.floors[y] == 0 && part.walls[y] == 0)
+                    continue;
 
-        auto chunk_id = Chunk::sector(x, y);
-        cached_entities[chunk_id].push_back(entity->copy());
-        cached_entities[chunk_id].back()->setPosition({x, y});
+                for (int x = 0 ; x < Chunk::SIZE ; x++)
+                {
+                    if (BitChunk<Chunk::SIZE>::test(part.floors, x, y))
+                        chunk.cellAt(x, y) = CellType::Floor;
+                    else if (BitChunk<Chunk::SIZE>::test(part.walls, x, y) && chunk.cellAt(x, y) == CellType::Empty)
+                        chunk.cellAt(x, y) = CellType::Wall;
+                }
+            }
+        }
+
+        // Add entities in the cache
+        if (!part.entities.empty())
+        {
+            auto& entities = cached_entities[chunk_id];
+            entities.insert(end(entities), begin(part.entities), end(part.entities));
+        }
     }
 }
 
-void Generator::generationLoop()
+void Generator::generateStep()
 {
-    while (true)
+    std::unique_lock<std::mutex> lock(to_generate_lock);
+
+    while (do_generate && !(to_replay.empty() && to_generate.empty()))
     {
-        to_generate_lock.lock();
+        // Select a chunk to generate, rooms of a loaded save come first in the order they were added
+        bool replay = !to_replay.empty();
+        std::pair<int, int> chunk_id;
 
-        // Wait for at least one task
-        while (do_generate && to_generate.empty())
+        if (replay)
         {
-            to_generate_lock.unlock();
-            std::this_thread::sleep_for(10ms);
-            to_generate_lock.lock();
+            chunk_id = to_replay.front();
+            to_replay.pop_front();
         }
+        else
+            chunk_id = to_generate.pop();
+
+        lock.unlock();
 
-        if (!do_generate)
+        if (replay || !isFilledChunk(chunk_id.first, chunk_id.second))
         {
-            to_generate_lock.unlock();
-            break;
+            receiveLocks();
+            addRooms(chunk_id.first, chunk_id.second, parameters.infinite ? 1 : parameters.nb_rooms);
+            setFilledChunk(chunk_id.first, chunk_id.second);
+            publish();
         }
 
-        std::pair<int, int> chunk_id;
+        lock.lock();
+
+        // Let the other jobs of the pool run
+        if (!foreground)
+            break;
+    }
 
-        // Select a chunk to generate
-        chunk_id = to_generate.front();
-        to_generate.pop_front();
+    scheduled = false;
+    schedule();
 
-        to_generate_lock.unlock();
+    if (!scheduled)
+        idle_cond.notify_all();
+}
 
-        if (isFilledChunk(chunk_id.first, chunk_id.second))
-            continue;
+void Generator::schedule()
+{
+    if (!do_generate || scheduled || (to_replay.empty() && to_generate.empty()))
+        return;
 
-        addRooms(chunk_id.first, chunk_id.second, 1);
-        setFilledChunk(chunk_id.first, chunk_id.second);
-    }
+    scheduled = true;
+    GenerationPool::instance().submit([this] { generateStep(); }, foreground);
+}
+
+void Generator::startGeneration()
+{
+    std::lock_guard<std::mutex> lock(to_generate_lock);
+
+    do_generate = true;
+    schedule();
+}
+
+bool Generator::stopGeneration()
+{
+    std::unique_lock<std::mutex> lock(to_generate_lock);
+
+    if (!do_generate)
+        return false;
+
+    do_generate = false;
+    idle_cond.wait(lock, [this] { return !scheduled; });
+
+    return true;
+}
+
+void Generator::setForeground(bool is_foreground)
+{
+    foreground = is_foreground;
 }
 
 std::ostream& operator<<(std::ostream& stream, Generator& generator)
 {
     // Pause generation
-    bool paused_generation = false;
-    if (generator.do_generate)
+    bool paused_generation = generator.stopGeneration();
+
+    // Rooms which are not added again yet come after the ones added since the load
+    std::vector<std::pair<int, int>> order = generator.fill_order;
+    order.insert(end(order), begin(generator.to_replay), end(generator.to_replay));
+
+    // Long histories are saved as rooms, unless the rooms of a load are not all added again yet
+    if (generator.replayable && (order.size() <= MAX_REPLAY_FILLS || !generator.to_replay.empty()))
     {
-        paused_generation = true;
-        generator.do_generate = false;
-        generator.generating_thread.join();
+        uint32_t tag = REPLAY_SAVE;
+        uint32_t nb_locked = generator.locked.size();
+        uint32_t nb_filled = order.size();
+
+        stream.write(reinterpret_cast<char*>(&tag), sizeof(uint32_t));
+        stream.write(reinterpret_cast<char*>(&generator.level_seed), sizeof(uint64_t));
+        stream.write(reinterpret_cast<char*>(&nb_locked), sizeof(uint32_t));
+        stream.write(reinterpret_cast<char*>(&nb_filled), sizeof(uint32_t));
+
+        for (const auto& chunk: generator.locked)
+            stream << chunk;
+
+        for (const auto& chunk: order)
+            stream << chunk;
     }
+    else
+    {
+        uint32_t nb_locked = generator.locked.size();
+        uint32_t nb_filled = generator.filled.size();
+        uint32_t nb_rooms = generator.rooms.size();
+        uint32_t nb_links = generator.room_links.size();
 
-    uint32_t nb_locked = generator.locked.size();
-    uint32_t nb_filled = generator.filled.size();
-    uint32_t nb_rooms = generator.rooms.size();
-    uint32_t nb_links = generator.room_links.size();
+        stream.write(reinterpret_cast<char*>(&nb_locked), sizeof(uint32_t));
+        stream.write(reinterpret_cast<char*>(&nb_filled), sizeof(uint32_t));
+        stream.write(reinterpret_cast<char*>(&nb_rooms), sizeof(uint32_t));
+        stream.write(reinterpret_cast<char*>(&nb_links), sizeof(uint32_t));
 
-    stream.write(reinterpret_cast<char*>(&nb_locked), sizeof(uint32_t));
-    stream.write(reinterpret_cast<char*>(&nb_filled), sizeof(uint32_t));
-    stream.write(reinterpret_cast<char*>(&nb_rooms), sizeof(uint32_t));
-    stream.write(reinterpret_cast<char*>(&nb_links), sizeof(uint32_t));
+        for (const auto& chunk: generator.locked)
+            stream << chunk;
 
-    for (const auto& chunk: generator.locked)
-        stream << chunk;
+        for (const auto& chunk: generator.filled)
+            stream << chunk;
 
-    for (const auto& chunk: generator.filled)
-        stream << chunk;
+        for (const Room& room: generator.rooms)
+            stream << room;
 
-    for (const Room& room: generator.rooms)
-        stream << room;
+        for (const auto& link: generator.room_links)
+            stream << link;
 
-    for (const auto& link: generator.room_links)
-        stream << link;
+        stream.write(reinterpret_cast<char*>(&generator.level_seed), sizeof(uint64_t));
+    }
 
     // Restart generation
     if (paused_generation)
-    {
-        generator.do_generate = true;
-        generator.generating_thread = std::thread(&Generator::generationLoop, &generator);
-    }
+        generator.startGeneration();
 
     return stream;
 }
@@ -508,61 +883,121 @@ std::ostream& operator<<(std::ostream& stream, Generator& generator)
 std::istream& operator>>(std::istream& stream, Generator& generator)
 {
     // Pause generation
-    bool paused_generation = false;
-    if (generator.do_generate)
-    {
-        paused_generation = true;
-        generator.do_generate = false;
-        generator.generating_thread.join();
-    }
+    bool paused_generation = generator.stopGeneration();
+
+    // The generation is stopped, messages left in the queues are dropped by this thread
+    generator.receiveLocks();
+    generator.receive();
 
     generator.to_generate.clear();
+    generator.to_replay.clear();
     generator.locked.clear();
+    generator.published.clear();
+    generator.ready.clear();
+    generator.cache_locked.clear();
+    generator.unpublished.clear();
     generator.filled.clear();
+    generator.fill_order.clear();
+    generator.nb_published_fills = 0;
     generator.rooms.clear();
-    generator.cached_map = Map();
+    generator.room_links.clear();
+    generator.link_index.clear();
+    generator.room_grid.clear();
+    generator.cached_cells.clear();
     generator.cached_entities.clear();
 
-    uint32_t nb_locked, nb_filled, nb_rooms, nb_links;
-
+    uint32_t nb_locked;
     stream.read(reinterpret_cast<char*>(&nb_locked), sizeof(uint32_t));
-    stream.read(reinterpret_cast<char*>(&nb_filled), sizeof(uint32_t));
-    stream.read(reinterpret_cast<char*>(&nb_rooms), sizeof(uint32_t));
-    stream.read(reinterpret_cast<char*>(&nb_links), sizeof(uint32_t));
 
     std::pair<int, int> chunk_id;
 
-    for (size_t i = 0 ; i < nb_locked ; i++)
+    if (nb_locked == REPLAY_SAVE)
     {
-        stream >> chunk_id;
-        generator.locked.insert(chunk_id);
-    }
+        uint32_t nb_filled;
 
-    for (size_t i = 0 ; i < nb_filled ; i++)
-    {
-        stream >> chunk_id;
-        generator.filled.insert(chunk_id);
-    }
+        stream.read(reinterpret_cast<char*>(&generator.level_seed), sizeof(uint64_t));
+        stream.read(reinterpret_cast<char*>(&nb_locked), sizeof(uint32_t));
+        stream.read(reinterpret_cast<char*>(&nb_filled), sizeof(uint32_t));
 
-    for (size_t i = 0 ; i < nb_rooms ; i++)
-    {
-        generator.rooms.emplace_back();
-        stream >> generator.rooms.back();
-        generator.registerRoom(i);
-    }
+        for (size_t i = 0 ; i < nb_locked ; i++)
+        {
+            stream >> chunk_id;
+            generator.locked.insert(chunk_id);
+            generator.cache_locked.insert(chunk_id);
+        }
+
+        // Locked chunks won't change, waiting for their rooms is useless
+        for (size_t i = 0 ; i < nb_filled ; i++)
+        {
+            stream >> chunk_id;
+            generator.to_replay.push_back(chunk_id);
 
-    for (size_t i = 0 ; i < nb_links ; i++)
+            if (generator.locked.count(chunk_id))
+                generator.filled.insert(chunk_id);
+        }
+
+        // The finite map is generated again when a chunk is taken
+        if (!generator.parameters.infinite)
+        {
+            generator.to_replay.clear();
+            generator.filled.clear();
+        }
+
+        generator.replayable = true;
+    }
+    else
     {
-        stream >> chunk_id;
-        generator.room_links.insert(chunk_id);
+        uint32_t nb_filled, nb_rooms, nb_links;
+
+        stream.read(reinterpret_cast<char*>(&nb_filled), sizeof(uint32_t));
+        stream.read(reinterpret_cast<char*>(&nb_rooms), sizeof(uint32_t));
+        stream.read(reinterpret_cast<char*>(&nb_links), sizeof(uint32_t));
+
+        for (size_t i = 0 ; i < nb_locked ; i++)
+        {
+            stream >> chunk_id;
+            generator.locked.insert(chunk_id);
+            generator.cache_locked.insert(chunk_id);
+        }
+
+        for (size_t i = 0 ; i < nb_filled ; i++)
+        {
+            stream >> chunk_id;
+            generator.filled.insert(chunk_id);
+        }
+
+        for (size_t i = 0 ; i < nb_rooms ; i++)
+        {
+            generator.rooms.emplace_back();
+            stream >> generator.rooms.back();
+            generator.registerRoom(i);
+        }
+
+        for (size_t i = 0 ; i < nb_links ; i++)
+        {
+            stream >> chunk_id;
+            generator.room_links.insert(chunk_id);
+        }
+
+        // Older saves have no seed, the one given to the constructor is kept
+        uint64_t seed;
+        if (stream.read(reinterpret_cast<char*>(&seed), sizeof(uint64_t)))
+            generator.level_seed = seed;
+        else
+            stream.clear();
+
+        // The order in which rooms were added is unknown
+        generator.replayable = false;
     }
 
+    // Rooms already added are published, chunks waiting to be replayed will be published by the generation
+    generator.publish();
+    generator.receive();
+    generator.ready = generator.filled;
+
     // Restart generation
     if (paused_generation)
-    {
-        generator.do_generate = true;
-        generator.generating_thread = std::thread(&Generator::generationLoop, &generator);
-    }
+        generator.startGeneration();
 
     return stream;
 }
@@ -6,8 +6,11 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
 #include <list>
 #include <memory>
 #include <mutex>
@@ -17,16 +20,25 @@
 #include <tuple>
 #include <vector>
 
+#include "chunk_queue.hpp"
+#include "generation_pool.hpp"
+#include "link_index.hpp"
 #include "pattern.hpp"
 #include "room.hpp"
+#include "room_raster.hpp"
 #include "space.hpp"
+#include "spsc_queue.hpp"
 
+#include "../chunk_table.hpp"
 #include "../map.hpp"
 #include "../entity.hpp"
 
 
-// Number of chunks that will be generated on border of requested chunks
-constexpr int GEN_BORDER = 2;
+// Number of cells that will be generated on border of requested chunks
+constexpr int GEN_BORDER = 8;
+
+// Number of filled chunks beyond which a save holds the rooms, so that a load doesn't add them again
+constexpr size_t MAX_REPLAY_FILLS = 256;
 
 /**
  * \brief A level, with the map and the entities
@@ -35,6 +47,51 @@ struct Level
 {
     Map map;
     std::vector<std::shared_ptr<Entity>> entities;
+
+    bool saved = false;                  ///< The files of the level exist, changes can be appended to them
+    ChunkTable<uint8_t> dirty_entities;  ///< Chunks whose entities changed since the level was saved
+
+    /// Entities of the chunks added in advance, they join the level once their chunk is loaded
+    ChunkTable<std::vector<std::shared_ptr<Entity>>> streamed_entities;
+
+    /**
+     * \brief Mark the entities of the chunk of a cell as changed since the level was saved
+     */
+    void setEntitiesDirty(sf::Vector2i position)
+    {
+        auto chunk = Chunk::sector(position.x, position.y);
+        dirty_entities.insert(chunk.first, chunk.second, 1);
+    }
+};
+
+/**
+ * \brief  Message sent by the generation to the thread taking the chunks.
+ */
+struct ChunkPublication
+{
+    std::pair<int, int> chunk;                     ///< Coordinates of the chunk
+    bool filled = false;                           ///< The message only tells that rooms were added around the chunk
+    std::shared_ptr<const Chunk> cells;            ///< Cells of the chunk shared with the generation, nullptr if empty
+    std::vector<std::shared_ptr<Entity>> entities; ///< Entities of the chunk, they are not modified by the generation
+};
+
+/**
+ * \brief  Last content of a chunk received by the thread taking the chunks.
+ */
+struct PublishedChunk
+{
+    std::shared_ptr<const Chunk> cells;            ///< Cells of the chunk, nullptr if empty
+    bool has_cells = true;                         ///< The cells were not taken yet
+    std::vector<std::shared_ptr<Entity>> entities; ///< Entities of the chunk which were not taken yet
+};
+
+/**
+ * \brief  Cells of a chunk in the cache of the generation.
+ */
+struct CachedChunk
+{
+    std::shared_ptr<Chunk> cells; ///< Cells of the chunk
+    bool published = false;       ///< The cells are shared with the thread taking the chunks, they are copied before being modified
 };
 
 /**
@@ -54,6 +111,24 @@ struct Level
  *    - add entities on rooms
  *    - draw rooms on a cached map
  *   If the map has to be finite, theses steps will only be executed once, thus the generator will only have to answer using his cached map.
+ *
+ * \section Threads
+ *   The cached map is only used by the generation. After each chunk filled, the generation publishes the
+ *   chunks it modified in a queue without locks, followed by the chunks it filled. Published cells are shared
+ *   and never modified, the generation copies them before drawing another room on them, so that the cells of
+ *   most chunks are in memory once. The chunks are taken by a single thread from the last cells it received,
+ *   so that taking a chunk never waits for the generation when the chunk is ready. Locked chunks are sent back to the generation by another queue, rooms added before the
+ *   generation receives them are ignored on these chunks as on any other locked chunk.
+ *
+ *   Methods taking chunks, requesting them and saving the generator must be called by the same thread.
+ *
+ * \section Saves
+ *   Since the random numbers used to add rooms around a chunk only depend on the seed of the level and on the chunk,
+ *   the rooms are given back by adding them again around the same chunks in the same order. Thus a save only holds
+ *   the seed, the locked chunks and the chunks filled so far in order, while changes made by the player are saved
+ *   with the map and the entities of the level. The rooms are added again by the generation pool after a load,
+ *   before any other chunk. Once more than MAX_REPLAY_FILLS chunks are filled, adding them again would delay
+ *   the first chunks out of the locked area too much: the rooms and their links are saved instead.
  */
 class Generator
 {
@@ -67,11 +142,12 @@ public:
      * \brief    Main constructor. Initialisation of parameters.
      *
      * \param    parameters The configuration of the map generation.
+     * \param    seed       The seed of the level, each group of rooms uses its own random stream derived from it.
      * \warning  Note that we may need to use the generator exacly with the same queries to get the same map.
      */
-    Generator(const GenerationMode& parameters);
+    Generator(const GenerationMode& parameters, uint64_t seed = 0);
 
-    // a copy would need to restart a thread, and is very heavy
+    // jobs of the generation pool refer to the generator, and a copy is very heavy
     Generator(Generator&&) = delete;
     Generator(const Generator&) = delete;
 
@@ -81,12 +157,13 @@ public:
     ~Generator();
 
     /**
-     * \brief   Get the chunk of coordinates (x, y).
+     * \brief   Get the chunk of coordinates (x, y), it is locked and removed from the cache.
      * \param   x x-coordinate of the chunk.
      * \param   y y-coordinate of the chunk.
      * \return  The content of the queried chunk.
+     * \warning The content is given to the caller, querying it again returns an empty chunk.
      */
-    Chunk getChunkCells(int x, int y);
+    Chunk takeChunkCells(int x, int y);
 
     /**
      * \brief   Get the list of all cached chunks not requested so far.
@@ -95,12 +172,30 @@ public:
     std::vector<std::pair<int, int>> getCachedChunks();
 
     /**
-     * \brief Get the enties initially placed on the chunk of coordinates (x, y).
+     * \brief   Check if a chunk can be taken without waiting for the generation.
+     * \param   x x-coordinate of the chunk.
+     * \param   y y-coordinate of the chunk.
+     * \return  true if the rooms around the chunk and its border are published, it won't change anymore.
+     */
+    bool isReady(int x, int y);
+
+    /**
+     * \brief   Get the progress of the generation of a finite level.
+     * \return  A value from 0 to 1, 1 once the chunks of the level can be taken without waiting.
+     *
+     * A finite level is generated by the generation pool once a chunk is requested, with preGenerateRadius
+     * for instance, so that the caller can show the progress meanwhile.
+     */
+    float getProgress();
+
+    /**
+     * \brief Get the enties initially placed on the chunk of coordinates (x, y), they are removed from the cache.
      * \param   x x-coordinate of the chunk.
      * \param   y y-coordinate of the chunk.
      * \return  The list of the entities initially placed on the queried chunk.
+     * \warning The entities are given to the caller, querying them again returns an empty list.
      */
-    std::vector<std::shared_ptr<Entity>> getChunkEntities(int x, int y);
+    std::vector<std::shared_ptr<Entity>> takeChunkEntities(int x, int y);
 
     /**
      * \brief  Indicate to generate around a chunk.
@@ -108,34 +203,114 @@ public:
      * \param  x         x-coordinate of the chunk.
      * \param  radius    The radius of a square of center {x, y}.
      * \param  priority  If set to true this chunk is generated before other chunks without priority.
-     * \note   This function might only be used for infinite generation since the whole map is generated at creation for finite generation.
+     * \note   A finite level is generated at once around the chunk (0, 0), whatever the chunk requested.
      *
      * It means that the generated square has a diagonal from {x-radius, y-radius} to {x+radius, y+radius}.
      * It won't generate a chunk if it has already been generated.
+     *
+     * Chunks are generated by increasing distance to the center of the last request with priority,
+     * chunks requested with priority being generated first.
      */
     void preGenerateRadius(int x, int y, int radius, bool priority = false);
 
+    /**
+     * \brief  Indicate to generate the chunks of a rectangle, without priority.
+     * \param  x_min   x-coordinate of the chunks on the left.
+     * \param  y_min   y-coordinate of the chunks on the top.
+     * \param  x_max   x-coordinate of the chunks on the right.
+     * \param  y_max   y-coordinate of the chunks on the bottom.
+     * \param  focus_x x-coordinate of the chunk from which distances are now computed.
+     * \param  focus_y y-coordinate of the chunk from which distances are now computed.
+     *
+     * As with preGenerateRadius, a border is generated around the rectangle. Chunks are generated by
+     * increasing distance to the focus, until the next request with priority.
+     */
+    void preGenerateArea(int x_min, int y_min, int x_max, int y_max, int focus_x, int focus_y);
+
+    /**
+     * \brief  Forget the chunks waiting to be generated which are far from a chunk.
+     * \param  x      x-coordinate of the chunk.
+     * \param  y      y-coordinate of the chunk.
+     * \param  radius The radius of the square of center {x, y} which is kept, as given to preGenerateRadius.
+     * \return The number of chunks which won't be generated.
+     *
+     * The chunks are generated again if they are requested later.
+     */
+    size_t cancelOutside(int x, int y, int radius);
+
+    /**
+     * \brief  Forget the chunks waiting to be generated which are outside of a rectangle.
+     * \param  x_min x-coordinate of the chunks on the left, as given to preGenerateArea.
+     * \param  y_min y-coordinate of the chunks on the top.
+     * \param  x_max x-coordinate of the chunks on the right.
+     * \param  y_max y-coordinate of the chunks on the bottom.
+     * \return The number of chunks which won't be generated.
+     */
+    size_t cancelOutside(int x_min, int y_min, int x_max, int y_max);
+
+    /**
+     * \brief  Number of chunks filled so far, as published to the thread taking the chunks.
+     */
+    size_t getFilledCount();
+
+    /**
+     * \brief  Get the counters of the list of chunks waiting to be generated.
+     */
+    ChunkQueueStats getQueueStats();
+
+    /**
+     * \brief  Tell if the generator is the one of the level being played, which is the default.
+     * Jobs of generators in the foreground are run before other jobs of the generation pool.
+     */
+    void setForeground(bool is_foreground);
+
     /**
      * \brief  Same as preGenerateRadius, but the call will only end when the generation is over. Thus the priority used.
+     * The calling thread sleeps until the generation publishes the last chunk it waits for.
+     * It doesn't wait when every chunk of the square is locked, since they won't change anymore.
+     * \return true if the calling thread had to wait for the generation.
      */
-    void generateRadius(int x, int y, int radius);
+    bool generateRadius(int x, int y, int radius);
 
 
 private:
     /**
-     * \brief   Check if the cells of a chunk are locked.
-     * \param   x x-coordinate of the chunk.
-     * \param   y y-coordinate of the chunk.
-     * \return  Wether the chunk could or couldn't change.
+     * \brief  Check if the chunks of a square and its border are filled, according to the publications received.
+     * \note   Only called by the thread taking the chunks.
      */
-    bool isLockedChunk(int x, int y);
+    bool allReady(int x, int y, int radius) const;
 
     /**
-     * \brief  Assert that a chunk must now be locked.
+     * \brief  Assert that a chunk must now be locked, and tell it to the generation.
      * \param  x x-coordinate of the chunk.
      * \param  y y-coordinate of the chunk.
+     * \note   Only called by the thread taking the chunks.
+     */
+    void lockChunk(int x, int y);
+
+    /**
+     * \brief  Sleep until the generation publishes chunks, and receive them.
+     * \note   Only called by the thread taking the chunks.
+     */
+    void waitPublication();
+
+    /**
+     * \brief  Keep the last content of the chunks published by the generation, and the chunks it filled.
+     * \note   Only called by the thread taking the chunks.
+     */
+    void receive();
+
+    /**
+     * \brief  Publish the chunks modified since the last call, then the chunks filled since the last call.
+     * \note   Only called by the generation.
      */
-    void setLockedChunk(int x, int y);
+    void publish();
+
+    /**
+     * \brief  Remove the chunks locked since the last call from the cache.
+     * \note   Only called by the generation.
+     */
+    void receiveLocks();
 
     /**
      * \brief   Check if rooms have already been added to the chunk.
@@ -164,43 +339,108 @@ private:
     /**
      * \brief  Ensure connexity of the level.
      * Update room_links and create new hallways between rooms.
+     * Rooms added since the last call are only linked to the rooms close to them. The ones which are still
+     * not connected then look for rooms twice further each time, until the level is connected.
      */
     void updateLinks();
 
+    /**
+     * \brief  Add a room to link_index.
+     * \param  room The index of the room in `rooms`, rooms must be indexed in order.
+     */
+    void indexRoom(size_t room);
+
+    /**
+     * \brief  Add the rooms which are not in room_grid yet to it.
+     * \param  last The index of the first room not to add, rooms before it won't move anymore.
+     */
+    void gridRooms(size_t last);
+
     /**
      * \brief  Specify that a room has been added to the map.
      * \param  room The index of the room in `rooms`
      * This method must be called each time a room is added to the map.
+     * Cells and entities of the room which are on locked chunks are ignored.
      */
     void registerRoom(size_t room);
 
     /**
-     * \brief  Loop that generates any chunk given in the list.
+     * \brief  Job run by the generation pool, generating the chunks given in the list.
+     * A generator in the background gives the thread back to the pool after each chunk.
+     */
+    void generateStep();
+
+    /**
+     * \brief  Compute the priorities of the chunks to generate from the distance to another chunk.
+     * \note   to_generate_lock must be held.
+     */
+    void setFocus(int x, int y);
+
+    /**
+     * \brief  Give a job to the generation pool if there are chunks to generate and no job yet.
+     * \note   to_generate_lock must be held.
      */
-    void generationLoop();
+    void schedule();
+
+    /**
+     * \brief  Allow the generator to give jobs to the pool.
+     */
+    void startGeneration();
+
+    /**
+     * \brief  Prevent the generator from giving jobs to the pool, and wait for its current job to end.
+     * \return true if the generation was running.
+     */
+    bool stopGeneration();
 
 
     ///< Parameters for the generation
     GenerationMode parameters;
 
-    ///< Thread that actualy generates
-    std::thread generating_thread;
+    ///< Seed of the level, see CounterEngine::key
+    uint64_t level_seed;
 
     ///< Wether the process has to continue
     bool do_generate;
 
-    ///< A list of chunks we need to generate
-    // This list is read from its front, thus, most important tasks are put in the front
-    std::list<std::pair<int, int>> to_generate;
+    ///< Wether a job of the generator is waiting in the pool or running
+    bool scheduled;
+
+    ///< Wether the generator is the one of the current level, its jobs run first
+    std::atomic<bool> foreground;
+
+    ///< The chunks we need to generate, each chunk is in the queue at most once
+    ChunkQueue to_generate;
 
-    ///< Lock for to_generate
+    ///< Chunk from which distances giving the priority of chunks in to_generate are computed
+    std::pair<int, int> focus;
+
+    ///< Lock for to_generate, focus, do_generate and scheduled
     std::mutex to_generate_lock;
 
-    ///< Set of chunk we don't wan't to modify anymore
+    ///< Notified when the job of the generator ends
+    std::condition_variable idle_cond;
+
+    ///< Set of chunk we don't wan't to modify anymore, owned by the thread taking the chunks
     std::set<std::pair<int, int>> locked;
 
-    ///< Lock for locked
-    std::mutex locked_lock;
+    ///< Last content of the chunks which are not locked yet, owned by the thread taking the chunks
+    ChunkTable<PublishedChunk> published;
+
+    ///< Chunks filled according to the publications received, owned by the thread taking the chunks
+    std::set<std::pair<int, int>> ready;
+
+    ///< Chunks published by the generation
+    SpscQueue<ChunkPublication> publications;
+
+    ///< Chunks locked by the thread taking the chunks
+    SpscQueue<std::pair<int, int>> locks;
+
+    ///< Lock used to wait for publications
+    std::mutex publication_lock;
+
+    ///< Notified when chunks are published
+    std::condition_variable publication_cond;
 
     ///< Set of chunks that have already been built so far
     std::set<std::pair<int, int>> filled;
@@ -208,31 +448,56 @@ private:
     ///< Lock for filled
     std::mutex filled_lock;
 
+    ///< The chunks filled so far, in the order rooms were added around them, protected by filled_lock
+    std::vector<std::pair<int, int>> fill_order;
+
+    ///< Number of chunks of fill_order already published, owned by the generation
+    size_t nb_published_fills;
+
+    ///< Chunks of a loaded save around which rooms must be added again before any other chunk, protected by to_generate_lock
+    std::deque<std::pair<int, int>> to_replay;
+
+    ///< Wether the generation can be saved as fill_order, false for saves of every rooms
+    bool replayable;
+
     ///< List of rooms generated so far
     std::vector<Room> rooms;
 
-    ///< A cached version of the map we generated so far
-    Map cached_map;
+    ///< Locked chunks received by the generation, owned by the generation
+    std::set<std::pair<int, int>> cache_locked;
+
+    ///< The chunks generated so far which are not locked yet, owned by the generation
+    ChunkTable<CachedChunk> cached_cells;
 
-    ///< A cached version of entities for each chunk
+    ///< Entities of each chunk which is not locked yet, owned by the generation
     std::map<std::pair<int, int>, std::vector<std::shared_ptr<Entity>>> cached_entities;
 
-    ///< Lock for the cache
-    std::mutex cache_lock;
+    ///< Chunks of the cache modified since the last publication, owned by the generation
+    ChunkTable<uint8_t> unpublished;
 
     ///< Keep track of connections between rooms
     std::set<std::pair<size_t, size_t>> room_links;
 
+    ///< Connected rooms and position of the rooms, kept between calls to updateLinks
+    LinkIndex link_index;
+
+    ///< Bounding boxes of the rooms which won't move anymore, in the order of `rooms`
+    RoomGrid room_grid;
+
+    ///< Rooms created, registered and linked so far, to show the progress of the generation of a finite level
+    std::atomic<unsigned int> progress;
+
 
     /**
      * \brief  Serialisation of current state of the generation.
      * The parameters of the generations won't be saved.
+     * The rooms are only saved for generators loaded from a save holding every rooms.
      */
     friend std::ostream& operator<<(std::ostream& stream, Generator& generator);
 
     /**
      * \brief  Serialisation of current state of the generation.
-     * The parameters of the generations won't be saved.
+     * The parameters of the generations won't be saved, they must be the ones used before saving.
      */
     friend std::istream& operator>>(std::istream& stream, Generator& generator);
 };
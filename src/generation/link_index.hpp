@@ -0,0 +1,205 @@
+/**
+ * \file   generation/link_index.hpp
+ * \brief  Connections between rooms and spatial index of the rooms.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "space.hpp"
+
+#include "../chunk_table.hpp"
+
+
+/**
+ * \brief  Keep track of which rooms are connected, and find the rooms close to a place.
+ *
+ * \section Behaviour
+ *   Rooms are identified by their index in the list of rooms of a generator, and are added in
+ *   the same order. Connected rooms are kept in a union-find, which is never rebuilt: linking two
+ *   rooms only merges their sets.
+ *   The bounding box of each room is put in each cell of a grid of side CELL it overlaps, so that the
+ *   rooms close to a box are found by looking at a few cells of the grid.
+ */
+class LinkIndex
+{
+public:
+    static constexpr int CELL = 32; ///< Side of the cells of the grid, in cells of the map
+
+    /**
+     * \brief  Add a room, it is connected to no other room.
+     * \param  min Top-left corner of the bounding box of the room, in the map.
+     * \param  max Bottom-right corner of the bounding box of the room, included.
+     * \return The index of the room.
+     */
+    size_t add(Point min, Point max);
+
+    /**
+     * \brief  Number of rooms added.
+     */
+    size_t size() const;
+
+    /**
+     * \brief  Remove every rooms.
+     */
+    void clear();
+
+    /**
+     * \brief  Get the room representing the set of rooms connected to a room.
+     */
+    size_t find(size_t room);
+
+    /**
+     * \brief  Connect the sets of two rooms.
+     * \return false if the rooms were already connected.
+     */
+    bool merge(size_t a, size_t b);
+
+    /**
+     * \brief  Number of rooms connected to a room, including itself.
+     */
+    size_t setSize(size_t room);
+
+    /**
+     * \brief  Call a function on each room whose bounding box is close to the bounding box of a room.
+     * \param  room     The room whose neighbours are visited, it is not visited itself.
+     * \param  distance The maximal distance between both bounding boxes.
+     * \param  visit    Function called once as `visit(other)` for each room close enough.
+     */
+    template <typename Function>
+    void forEachNear(size_t room, int distance, Function visit);
+
+private:
+    /**
+     * \brief  Index of the cell of the grid containing a coordinate.
+     */
+    static int gridCell(int coordinate);
+
+    std::vector<size_t> parents; ///< Parent of each room in the union-find
+    std::vector<size_t> sizes;   ///< Number of rooms in the set of each representative
+
+    std::vector<std::pair<Point, Point>> bounds; ///< Bounding box of each room
+    ChunkTable<std::vector<size_t>> grid;        ///< Rooms overlapping each cell of the grid
+
+    std::vector<uint64_t> visits; ///< Last search in which each room was visited
+    uint64_t search = 0;          ///< Number of searches done, to visit each room once per search
+};
+
+
+inline size_t LinkIndex::add(Point min, Point max)
+{
+    assert(min.first <= max.first && min.second <= max.second);
+
+    size_t room = parents.size();
+
+    parents.push_back(room);
+    sizes.push_back(1);
+    bounds.push_back({min, max});
+    visits.push_back(0);
+
+    for (int x = gridCell(min.first) ; x <= gridCell(max.first) ; x++)
+        for (int y = gridCell(min.second) ; y <= gridCell(max.second) ; y++)
+            grid(x, y).push_back(room);
+
+    return room;
+}
+
+inline size_t LinkIndex::size() const
+{
+    return parents.size();
+}
+
+inline void LinkIndex::clear()
+{
+    parents.clear();
+    sizes.clear();
+    bounds.clear();
+    grid.clear();
+    visits.clear();
+    search = 0;
+}
+
+inline size_t LinkIndex::find(size_t room)
+{
+    assert(room < parents.size());
+
+    // Path halving, each room on the path now points to its grandparent
+    while (parents[room] != room)
+    {
+        parents[room] = parents[parents[room]];
+        room = parents[room];
+    }
+
+    return room;
+}
+
+inline bool LinkIndex::merge(size_t a, size_t b)
+{
+    a = find(a);
+    b = find(b);
+
+    if (a == b)
+        return false;
+
+    // The smaller set goes under the larger one
+    if (sizes[a] < sizes[b])
+        std::swap(a, b);
+
+    parents[b] = a;
+    sizes[a] += sizes[b];
+
+    return true;
+}
+
+inline size_t LinkIndex::setSize(size_t room)
+{
+    return sizes[find(room)];
+}
+
+template <typename Function>
+void LinkIndex::forEachNear(size_t room, int distance, Function visit)
+{
+    assert(room < bounds.size());
+    assert(distance >= 0);
+
+    Point min = bounds[room].first;
+    Point max = bounds[room].second;
+
+    search++;
+    visits[room] = search;
+
+    for (int x = gridCell(min.first - distance) ; x <= gridCell(max.first + distance) ; x++)
+    {
+        for (int y = gridCell(min.second - distance) ; y <= gridCell(max.second + distance) ; y++)
+        {
+            const std::vector<size_t>* cell = grid.find(x, y);
+
+            if (cell == nullptr)
+                continue;
+
+            for (size_t other : *cell)
+            {
+                if (visits[other] == search)
+                    continue;
+
+                visits[other] = search;
+
+                // Rooms of the same cells of the grid can still be far from each other
+                const auto& box = bounds[other];
+                if (box.first.first - max.first <= distance && min.first - box.second.first <= distance &&
+                    box.first.second - max.second <= distance && min.second - box.second.second <= distance)
+                    visit(other);
+            }
+        }
+    }
+}
+
+inline int LinkIndex::gridCell(int coordinate)
+{
+    // Rounded towards negative infinity
+    return coordinate >= 0 ? coordinate / CELL : -((-coordinate + CELL - 1) / CELL);
+}
@@ -1,61 +1,526 @@
 #include "pattern.hpp"
 
 
-int pattern_min_x(const Pattern& pattern)
+namespace
 {
-    return std::min_element(
-        begin(pattern), end(pattern),
-        [](const Point& a, const Point& b) {
-            return a.first < b.first;
+    typedef Pattern::Word Word;
+
+    constexpr int WORD_BITS = Pattern::WORD_BITS;
+
+    /**
+     * \brief Index of the lowest bit set in a word, which must not be 0.
+     */
+    inline int lowest_bit(Word word)
+    {
+#if defined(__GNUC__)
+        return __builtin_ctzll(word);
+#else
+        int bit = 0;
+        while (!(word & 1))
+        {
+            word >>= 1;
+            bit++;
+        }
+        return bit;
+#endif
+    }
+
+    /**
+     * \brief Index of the highest bit set in a word, which must not be 0.
+     */
+    inline int highest_bit(Word word)
+    {
+#if defined(__GNUC__)
+        return WORD_BITS - 1 - __builtin_clzll(word);
+#else
+        int bit = WORD_BITS - 1;
+        while (!(word >> (WORD_BITS - 1)))
+        {
+            word <<= 1;
+            bit--;
         }
-    )->first;
+        return bit;
+#endif
+    }
+
+    /**
+     * \brief Number of bits set in a word.
+     */
+    inline int count_bits(Word word)
+    {
+#if defined(__GNUC__)
+        return __builtin_popcountll(word);
+#else
+        int count = 0;
+        for ( ; word != 0 ; word &= word - 1)
+            count++;
+        return count;
+#endif
+    }
+
+    /**
+     * \brief Number of words needed to hold a number of cells.
+     */
+    inline int words_for(int cells)
+    {
+        return (cells + WORD_BITS - 1) / WORD_BITS;
+    }
+
+    /**
+     * \brief Division rounded towards negative infinity.
+     */
+    inline int floor_div(int value, int divisor)
+    {
+        return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+    }
 }
 
-int pattern_max_x(const Pattern& pattern)
+
+/* *************** Iteration over a pattern *************** */
+
+Pattern::const_iterator::const_iterator() :
+    pattern(nullptr),
+    word(0),
+    bits(0),
+    cell(0, 0)
+{}
+
+Pattern::const_iterator::const_iterator(const Pattern* npattern, size_t nword, Word nbits) :
+    pattern(npattern),
+    word(nword),
+    bits(nbits),
+    cell(0, 0)
+{
+    settle();
+}
+
+void Pattern::const_iterator::settle()
 {
-    return std::max_element(
-        begin(pattern), end(pattern),
-        [](const Point& a, const Point& b) {
-            return a.first < b.first;
+    size_t nb_words = pattern->bits.size();
+
+    while (bits == 0 && word < nb_words)
+    {
+        word++;
+        bits = word < nb_words ? pattern->bits[word] : 0;
+    }
+
+    if (word >= nb_words)
+        return;
+
+    int column = static_cast<int>(word / pattern->column_words);
+    int column_word = static_cast<int>(word % pattern->column_words);
+
+    cell = {
+        pattern->origin.first + column,
+        pattern->origin.second + column_word * WORD_BITS + lowest_bit(bits)
+    };
+}
+
+const Point& Pattern::const_iterator::operator*() const
+{
+    return cell;
+}
+
+const Point* Pattern::const_iterator::operator->() const
+{
+    return &cell;
+}
+
+Pattern::const_iterator& Pattern::const_iterator::operator++()
+{
+    // Remove the lowest bit
+    bits &= bits - 1;
+    settle();
+    return *this;
+}
+
+Pattern::const_iterator Pattern::const_iterator::operator++(int)
+{
+    const_iterator previous = *this;
+    ++(*this);
+    return previous;
+}
+
+bool Pattern::const_iterator::operator==(const const_iterator& other) const
+{
+    return pattern == other.pattern && word == other.word && bits == other.bits;
+}
+
+bool Pattern::const_iterator::operator!=(const const_iterator& other) const
+{
+    return !(*this == other);
+}
+
+
+/* *************** Definition of pattern *************** */
+
+constexpr int Pattern::WORD_BITS;
+
+Pattern::Pattern() :
+    origin(0, 0),
+    columns(0),
+    column_words(0),
+    nb_cells(0)
+{}
+
+Pattern::Pattern(std::initializer_list<Point> cells) :
+    Pattern(cells.begin(), cells.end())
+{}
+
+Pattern::Pattern(const std::set<Point>& cells) :
+    Pattern()
+{
+    if (cells.empty())
+        return;
+
+    // Cells of a set are sorted by abscissa, the box is allocated once
+    int min_y = cells.begin()->second;
+    int max_y = min_y;
+    for (const Point& cell : cells)
+    {
+        min_y = std::min(min_y, cell.second);
+        max_y = std::max(max_y, cell.second);
+    }
+
+    reserve({cells.begin()->first, min_y}, {cells.rbegin()->first, max_y});
+
+    for (const Point& cell : cells)
+        insert(cell);
+}
+
+std::set<Point> Pattern::toSet() const
+{
+    // Cells are iterated in the order of the set
+    return std::set<Point>(begin(), end());
+}
+
+bool Pattern::insert(const Point& cell)
+{
+    reserve(cell, cell);
+
+    // The cell is in the box now
+    size_t word = 0;
+    int bit = 0;
+    locate(cell, word, bit);
+
+    Word mask = Word(1) << bit;
+    if (bits[word] & mask)
+        return false;
+
+    bits[word] |= mask;
+    nb_cells++;
+    return true;
+}
+
+size_t Pattern::erase(const Point& cell)
+{
+    size_t word;
+    int bit;
+
+    if (!locate(cell, word, bit))
+        return 0;
+
+    Word mask = Word(1) << bit;
+    if (!(bits[word] & mask))
+        return 0;
+
+    bits[word] &= ~mask;
+    nb_cells--;
+    return 1;
+}
+
+void Pattern::clear()
+{
+    std::fill(bits.begin(), bits.end(), 0);
+    nb_cells = 0;
+}
+
+bool Pattern::contains(const Point& cell) const
+{
+    size_t word;
+    int bit;
+    return locate(cell, word, bit) && ((bits[word] >> bit) & 1);
+}
+
+size_t Pattern::count(const Point& cell) const
+{
+    return contains(cell) ? 1 : 0;
+}
+
+Pattern::const_iterator Pattern::find(const Point& cell) const
+{
+    size_t word;
+    int bit;
+
+    if (!locate(cell, word, bit) || !((bits[word] >> bit) & 1))
+        return end();
+
+    // Cells before this one in the word are skipped
+    return const_iterator(this, word, bits[word] & ~((Word(1) << bit) - 1));
+}
+
+size_t Pattern::size() const
+{
+    return nb_cells;
+}
+
+bool Pattern::empty() const
+{
+    return nb_cells == 0;
+}
+
+Pattern::const_iterator Pattern::begin() const
+{
+    return const_iterator(this, 0, bits.empty() ? 0 : bits[0]);
+}
+
+Pattern::const_iterator Pattern::end() const
+{
+    return const_iterator(this, bits.size(), 0);
+}
+
+std::pair<Point, Point> Pattern::bounds() const
+{
+    if (empty())
+        return {{0, 0}, {0, 0}};
+
+    int min_x = columns, max_x = -1;
+    int min_y = column_words * WORD_BITS, max_y = -1;
+
+    for (int x = 0 ; x < columns ; x++)
+    {
+        const Word* column = bits.data() + x * column_words;
+
+        for (int k = 0 ; k < column_words ; k++)
+        {
+            if (column[k] == 0)
+                continue;
+
+            min_x = std::min(min_x, x);
+            max_x = x;
+            min_y = std::min(min_y, k * WORD_BITS + lowest_bit(column[k]));
+            break;
         }
-    )->first;
+
+        for (int k = column_words - 1 ; k >= 0 ; k--)
+        {
+            if (column[k] == 0)
+                continue;
+
+            max_y = std::max(max_y, k * WORD_BITS + highest_bit(column[k]));
+            break;
+        }
+    }
+
+    return {origin + Point(min_x, min_y), origin + Point(max_x, max_y)};
 }
 
-int pattern_min_y(const Pattern& pattern)
+bool Pattern::intersects(const Pattern& other, Point offset) const
+{
+    if (empty() || other.empty())
+        return false;
+
+    // Columns of both bitmaps
+    int first = std::max(0, other.origin.first + offset.first - origin.first);
+    int last = std::min(columns, other.origin.first + other.columns + offset.first - origin.first);
+
+    for (int x = first ; x < last ; x++)
+    {
+        const Word* column = bits.data() + x * column_words;
+        Word common = 0;
+
+        for (int k = 0 ; k < column_words ; k++)
+            common |= column[k] & other.wordAt(origin.first + x - offset.first,
+                                               origin.second + k * WORD_BITS - offset.second);
+
+        if (common != 0)
+            return true;
+    }
+
+    return false;
+}
+
+void Pattern::merge(const Pattern& other, Point offset)
 {
-    return std::min_element(
-        begin(pattern), end(pattern),
-        [](const Point& a, const Point& b) {
-            return a.second < b.second;
+    if (other.empty())
+        return;
+
+    auto box = other.bounds();
+    reserve(box.first + offset, box.second + offset);
+
+    // Words of this bitmap the other pattern can be on
+    int first_word = (box.first.second + offset.second - origin.second) / WORD_BITS;
+    int last_word = (box.second.second + offset.second - origin.second) / WORD_BITS;
+
+    for (int x = box.first.first ; x <= box.second.first ; x++)
+    {
+        Word* column = bits.data() + (x + offset.first - origin.first) * column_words;
+
+        for (int k = first_word ; k <= last_word ; k++)
+        {
+            Word added = other.wordAt(x, origin.second + k * WORD_BITS - offset.second);
+            nb_cells += count_bits(added & ~column[k]);
+            column[k] |= added;
         }
-    )->second;
+    }
+}
+
+bool Pattern::operator==(const Pattern& other) const
+{
+    if (size() != other.size())
+        return false;
+
+    for (const Point& cell : *this)
+        if (!other.contains(cell))
+            return false;
+
+    return true;
+}
+
+bool Pattern::operator!=(const Pattern& other) const
+{
+    return !(*this == other);
+}
+
+Pattern::Word Pattern::wordAt(int x, int y) const
+{
+    int column = x - origin.first;
+
+    if (column < 0 || column >= columns)
+        return 0;
+
+    // The cells are on two consecutive words of the column
+    int relative = y - origin.second;
+    int word = floor_div(relative, WORD_BITS);
+    int shift = relative - word * WORD_BITS;
+
+    const Word* words = bits.data() + column * column_words;
+    Word low = word >= 0 && word < column_words ? words[word] : 0;
+    Word high = word + 1 >= 0 && word + 1 < column_words ? words[word + 1] : 0;
+
+    if (shift == 0)
+        return low;
+
+    return (low >> shift) | (high << (WORD_BITS - shift));
+}
+
+void Pattern::reserve(Point min, Point max)
+{
+    if (bits.empty())
+    {
+        reset(min, max.first - min.first + 1, words_for(max.second - min.second + 1));
+        return;
+    }
+
+    Point box_min = origin;
+    Point box_max = origin + Point(columns - 1, column_words * WORD_BITS - 1);
+
+    if (min.first >= box_min.first && min.second >= box_min.second &&
+        max.first <= box_max.first && max.second <= box_max.second)
+        return;
+
+    // Grow by half of the current size on each side which is too small
+    if (min.first < box_min.first)
+        box_min.first = min.first - columns / 2;
+    if (max.first > box_max.first)
+        box_max.first = max.first + columns / 2;
+    if (min.second < box_min.second)
+        box_min.second = min.second - column_words * WORD_BITS / 2;
+    if (max.second > box_max.second)
+        box_max.second = max.second + column_words * WORD_BITS / 2;
+
+    Pattern grown;
+    grown.reset(box_min, box_max.first - box_min.first + 1, words_for(box_max.second - box_min.second + 1));
+
+    for (int x = 0 ; x < columns ; x++)
+    {
+        Word* column = grown.bits.data() + (origin.first + x - box_min.first) * grown.column_words;
+
+        for (int k = 0 ; k < grown.column_words ; k++)
+            column[k] = wordAt(origin.first + x, box_min.second + k * WORD_BITS);
+    }
+
+    grown.nb_cells = nb_cells;
+    *this = std::move(grown);
+}
+
+void Pattern::reset(Point min, int ncolumns, int ncolumn_words)
+{
+    origin = min;
+    columns = ncolumns;
+    column_words = ncolumn_words;
+    bits.assign(static_cast<size_t>(columns) * column_words, 0);
+    nb_cells = 0;
+}
+
+bool Pattern::locate(const Point& cell, size_t& word, int& bit) const
+{
+    int column = cell.first - origin.first;
+    int relative = cell.second - origin.second;
+
+    if (column < 0 || column >= columns || relative < 0 || relative >= column_words * WORD_BITS)
+        return false;
+
+    word = static_cast<size_t>(column) * column_words + relative / WORD_BITS;
+    bit = relative % WORD_BITS;
+    return true;
+}
+
+
+/* *************** Functions on patterns *************** */
+
+int pattern_min_x(const Pattern& pattern)
+{
+    assert(!pattern.empty());
+    return pattern.bounds().first.first;
+}
+
+int pattern_max_x(const Pattern& pattern)
+{
+    assert(!pattern.empty());
+    return pattern.bounds().second.first;
+}
+
+int pattern_min_y(const Pattern& pattern)
+{
+    assert(!pattern.empty());
+    return pattern.bounds().first.second;
 }
 
 int pattern_max_y(const Pattern& pattern)
 {
-    return std::max_element(
-        begin(pattern), end(pattern),
-        [](const Point& a, const Point& b) {
-            return a.second < b.second;
-        }
-    )->second;
+    assert(!pattern.empty());
+    return pattern.bounds().second.second;
 }
 
 
 Pattern frontier(const Pattern& pattern)
 {
     Pattern frontier;
-    for (const Point& cell : pattern)
+    frontier.reset(pattern.origin, pattern.columns, pattern.column_words);
+
+    int nb_words = pattern.column_words;
+
+    for (int x = 0 ; x < pattern.columns ; x++)
     {
-        bool outside =
-            pattern.find(cell + std::make_pair(1, 0)) == end(pattern)
-         || pattern.find(cell - std::make_pair(1, 0)) == end(pattern)
-         || pattern.find(cell + std::make_pair(0, 1)) == end(pattern)
-         || pattern.find(cell - std::make_pair(0, 1)) == end(pattern);
-
-        if (outside)
-            frontier.insert(cell);
+        const Word* column = pattern.bits.data() + x * nb_words;
+        const Word* left = x > 0 ? column - nb_words : nullptr;
+        const Word* right = x + 1 < pattern.columns ? column + nb_words : nullptr;
+        Word* result = frontier.bits.data() + x * nb_words;
+
+        for (int k = 0 ; k < nb_words ; k++)
+        {
+            // Neighbours above and below are the bits next to each cell, they can be on the next word
+            Word up = (column[k] << 1) | (k > 0 ? column[k - 1] >> (WORD_BITS - 1) : 0);
+            Word down = (column[k] >> 1) | (k + 1 < nb_words ? column[k + 1] << (WORD_BITS - 1) : 0);
+            Word sides = (left ? left[k] : 0) & (right ? right[k] : 0);
+
+            // Cells with a missing neighbour
+            result[k] = column[k] & ~(up & down & sides);
+            frontier.nb_cells += count_bits(result[k]);
+        }
     }
+
     return frontier;
 }
 
@@ -63,17 +528,29 @@ Pattern surrounding(const Pattern& pattern)
 {
     Pattern surrounding;
 
-    for (const Point& cell : pattern)
+    if (pattern.empty())
+        return surrounding;
+
+    // The box grows by one cell on each side
+    surrounding.reset(pattern.origin - Point(1, 1), pattern.columns + 2, words_for(pattern.column_words * WORD_BITS + 2));
+
+    for (int x = 0 ; x < surrounding.columns ; x++)
     {
-        Point relat;
+        Word* result = surrounding.bits.data() + x * surrounding.column_words;
+        int abscissa = surrounding.origin.first + x;
 
-        for (relat.first = -1 ; relat.first <= 1 ; relat.first++)
+        for (int k = 0 ; k < surrounding.column_words ; k++)
         {
-            for (relat.second = -1 ; relat.second <= 1 ; relat.second ++)
-            {
-                if (pattern.find(cell + relat) == end(pattern))
-                    surrounding.insert(cell + relat);
-            }
+            int y = surrounding.origin.second + k * WORD_BITS;
+            Word dilated = 0;
+
+            // Cells with a cell of the pattern around them, diagonals included
+            for (int dx = -1 ; dx <= 1 ; dx++)
+                dilated |= pattern.wordAt(abscissa + dx, y - 1) | pattern.wordAt(abscissa + dx, y) |
+                           pattern.wordAt(abscissa + dx, y + 1);
+
+            result[k] = dilated & ~pattern.wordAt(abscissa, y);
+            surrounding.nb_cells += count_bits(result[k]);
         }
     }
 
@@ -101,20 +578,12 @@ bool spaced(Point position1, const Pattern& pattern1, Point position2, const Pat
 
 bool superposed(Point position1, const Pattern& pattern1, Point position2, const Pattern& pattern2)
 {
-    // The complexity would be pattern1.size() * log(pattern2.size())
-    if(pattern1.size() > pattern2.size())
+    // Words of the smaller pattern are compared to the other one
+    if (pattern1.size() > pattern2.size())
         return superposed(position2, pattern2, position1, pattern1);
 
-    for (const Point& cell : pattern1)
-    {
-        // Must check for all points P1 of pattern1, P2 of pattern2 :
-        //   position1 + P1 != position2 + P2
-        // pos_in_2 represents the theorical coordinate of a point of pattern1 in pattern2 :
-        Point pos_in_2 = position1 + cell - position2;
-        if (pattern2.find(pos_in_2) != end(pattern2))
-            return true;
-    }
-    return false;
+    // Cells position1 + P1 and position2 + P2 are the same if P1 = P2 + position2 - position1
+    return pattern1.intersects(pattern2, position2 - position1);
 }
 
 Pattern merged_patterns(const std::vector<Point>& positions, const std::vector<Pattern>& patterns)
@@ -123,11 +592,10 @@ Pattern merged_patterns(const std::vector<Point>& positions, const std::vector<P
     assert(positions.size() == patterns.size());
 
     // Contains the new postions of every cells
-    std::set<Point> fullMap;
+    Pattern fullMap;
 
     for (size_t i_pattern = 0 ; i_pattern < patterns.size() ; i_pattern++)
-        for(const Point& pattern_cell : patterns[i_pattern])
-            fullMap.insert(positions[i_pattern] + pattern_cell);
+        fullMap.merge(patterns[i_pattern], positions[i_pattern]);
 
     return fullMap;
 }
@@ -6,6 +6,9 @@
 #pragma once
 
 #include <cassert>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
 #include <set>
 #include <tuple>
 #include <vector>
@@ -18,8 +21,232 @@
 
 /**
  * \brief The set of cells contained in a pattern
+ *
+ * \section Layout
+ *   Cells are stored as a bitmap covering a box which contains every cell. The box is cut in columns,
+ *   the bit `i` of the column `x` being the cell `(origin.x + x, origin.y + i)`. Columns are stored one
+ *   after the other, each as the same number of words.
+ *   Cells are iterated column by column, from top to bottom, which is the order of a `std::set<Point>`.
+ *
+ *   Operations on whole patterns (frontier, surrounding, superposition, merge) work on words of columns
+ *   using shifts and bitwise operations, in loops without branches the compiler can vectorise.
+ *   The box grows when cells are inserted outside of it, it never shrinks.
+ */
+class Pattern
+{
+public:
+    typedef uint64_t Word;                  ///< Bits of consecutive cells of a column
+    static constexpr int WORD_BITS = 64;    ///< Number of cells in a word
+
+    /**
+     * \brief Iterate over the cells of a pattern, column by column.
+     */
+    class const_iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef Point value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const Point* pointer;
+        typedef const Point& reference;
+
+        /**
+         * \brief Create an iterator which is not attached to a pattern.
+         */
+        const_iterator();
+
+        const Point& operator*() const;
+        const Point* operator->() const;
+        const_iterator& operator++();
+        const_iterator operator++(int);
+        bool operator==(const const_iterator& other) const;
+        bool operator!=(const const_iterator& other) const;
+
+    private:
+        friend class Pattern;
+
+        /**
+         * \brief Create an iterator on the first cell of a word, or after if it is empty.
+         * \param pattern The pattern iterated.
+         * \param word    Index of the word in the bitmap of the pattern.
+         * \param bits    Bits of the word which are still to be iterated.
+         */
+        const_iterator(const Pattern* pattern, size_t word, Word bits);
+
+        /**
+         * \brief Go to the next cell, starting from the current word.
+         */
+        void settle();
+
+        const Pattern* pattern; ///< The pattern iterated
+        size_t word;            ///< Index of the current word in the bitmap
+        Word bits;              ///< Bits of the current word not iterated yet, the lowest one is the current cell
+        Point cell;             ///< The current cell
+    };
+
+    typedef const_iterator iterator;
+    typedef Point value_type;
+
+    /**
+     * \brief Create an empty pattern.
+     */
+    Pattern();
+
+    /**
+     * \brief Create a pattern from a list of cells.
+     */
+    Pattern(std::initializer_list<Point> cells);
+
+    /**
+     * \brief Create a pattern from a set of cells.
+     */
+    explicit Pattern(const std::set<Point>& cells);
+
+    /**
+     * \brief Create a pattern from a range of cells.
+     */
+    template <typename Iterator>
+    Pattern(Iterator begin, Iterator end);
+
+    /**
+     * \brief Get the cells of the pattern as a set.
+     */
+    std::set<Point> toSet() const;
+
+    /**
+     * \brief Add a cell.
+     * \return false if the cell was already in the pattern.
+     */
+    bool insert(const Point& cell);
+
+    /**
+     * \brief Remove a cell.
+     * \return The number of cells removed.
+     */
+    size_t erase(const Point& cell);
+
+    /**
+     * \brief Remove every cells, the box of the bitmap is kept.
+     */
+    void clear();
+
+    /**
+     * \brief Check if a cell is in the pattern.
+     */
+    bool contains(const Point& cell) const;
+
+    /**
+     * \brief Number of times a cell is in the pattern, 0 or 1.
+     */
+    size_t count(const Point& cell) const;
+
+    /**
+     * \brief Find a cell of the pattern.
+     * \return An iterator on the cell, or end() if it isn't in the pattern.
+     */
+    const_iterator find(const Point& cell) const;
+
+    /**
+     * \brief Number of cells of the pattern.
+     */
+    size_t size() const;
+
+    /**
+     * \brief Check if the pattern has no cell.
+     */
+    bool empty() const;
+
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    /**
+     * \brief Get the bounding box of the cells.
+     * \return The top-left and bottom-right corners of the box, ((0, 0), (0, 0)) if the pattern is empty.
+     */
+    std::pair<Point, Point> bounds() const;
+
+    /**
+     * \brief Check if the pattern has a cell in common with another pattern.
+     * \param other  The other pattern.
+     * \param offset Vector added to the cells of the other pattern.
+     */
+    bool intersects(const Pattern& other, Point offset) const;
+
+    /**
+     * \brief Add the cells of another pattern.
+     * \param other  The other pattern.
+     * \param offset Vector added to the cells of the other pattern.
+     */
+    void merge(const Pattern& other, Point offset);
+
+    bool operator==(const Pattern& other) const;
+    bool operator!=(const Pattern& other) const;
+
+    friend Pattern frontier(const Pattern& pattern);
+    friend Pattern surrounding(const Pattern& pattern);
+
+private:
+    /**
+     * \brief Get the bits of consecutive cells of a column.
+     * \param x The abscissa of the column.
+     * \param y The ordinate of the first cell.
+     * \return The word whose bit `i` is the cell `(x, y + i)`, cells outside of the box are empty.
+     */
+    Word wordAt(int x, int y) const;
+
+    /**
+     * \brief Make sure the box of the bitmap contains another box.
+     * \param min Top-left corner of the box to contain.
+     * \param max Bottom-right corner of the box to contain.
+     * The bitmap grows more than needed, so that inserting cells one by one is fast.
+     */
+    void reserve(Point min, Point max);
+
+    /**
+     * \brief Set the box of the bitmap, every cells are removed.
+     * \param min Top-left corner of the box.
+     * \param columns Number of columns of the box.
+     * \param column_words Number of words of each column.
+     */
+    void reset(Point min, int columns, int column_words);
+
+    /**
+     * \brief Find the word and the bit of a cell.
+     * \return false if the cell is outside of the box.
+     */
+    bool locate(const Point& cell, size_t& word, int& bit) const;
+
+    Point origin;           ///< Cell of the first bit of the first column
+    int columns;            ///< Number of columns of the bitmap
+    int column_words;       ///< Number of words of each column
+    std::vector<Word> bits; ///< Words of each column, one column after the other
+    size_t nb_cells;        ///< Number of cells of the pattern
+};
+
+
+template <typename Iterator>
+Pattern::Pattern(Iterator begin, Iterator end) :
+    Pattern()
+{
+    for (Iterator cell = begin ; cell != end ; ++cell)
+        insert(*cell);
+}
+
+/**
+ * \brief Get an iterator on the first cell of a pattern.
+ */
+inline Pattern::const_iterator begin(const Pattern& pattern)
+{
+    return pattern.begin();
+}
+
+/**
+ * \brief Get an iterator past the last cell of a pattern.
  */
-typedef std::set<Point> Pattern;
+inline Pattern::const_iterator end(const Pattern& pattern)
+{
+    return pattern.end();
+}
 
 
 /**
@@ -3,17 +3,31 @@
 
 /* *************** Definition of room *************** */
 
+/**
+ * \brief  Swap the coordinates of a point.
+ */
+static Point transposed(const Point& point)
+{
+    return {point.second, point.first};
+}
+
 Room::Room() :
     position({0, 0}),
-    treeCells(cells)
-{}
+    treeCells(cells.begin(), cells.end())
+{
+    indexNodes();
+    indexCells();
+}
 
 Room::Room(const Pattern& cells) :
     position({0, 0}),
     cells(cells),
     nodes(frontier(cells)),
-    treeCells(cells)
-{}
+    treeCells(cells.begin(), cells.end())
+{
+    indexNodes();
+    indexCells();
+}
 
 Point Room::getPosition() const
 {
@@ -25,7 +39,7 @@ void Room::setPosition(const Point& nposition)
     position = nposition;
 }
 
-Pattern Room::getCells() const
+const Pattern& Room::getCells() const
 {
     return cells;
 }
@@ -37,7 +51,7 @@ int Room::size() const
 
 bool Room::hasCell(const Point& cell) const
 {
-    return cells.find(cell - position) != end(cells);
+    return cells.contains(cell - position);
 }
 
 Pattern Room::getNodes() const
@@ -48,6 +62,52 @@ Pattern Room::getNodes() const
 void Room::setNodes(const Pattern& nnodes)
 {
     nodes = nnodes;
+    indexNodes();
+}
+
+std::pair<Point, Point> Room::getNodesBounds() const
+{
+    return nodes_bounds;
+}
+
+void Room::indexNodes()
+{
+    // Points are ordered by abscissa first
+    nodes_by_x.assign(begin(nodes), end(nodes));
+
+    nodes_by_y.clear();
+    for (const Point& node : nodes)
+        nodes_by_y.push_back(transposed(node));
+    std::sort(begin(nodes_by_y), end(nodes_by_y));
+    nodes_bounds = {{0, 0}, {0, 0}};
+
+    if (nodes.empty())
+        return;
+
+    nodes_bounds = {*begin(nodes), *begin(nodes)};
+
+    for (const Point& node : nodes)
+    {
+        nodes_bounds.first.first = std::min(nodes_bounds.first.first, node.first);
+        nodes_bounds.first.second = std::min(nodes_bounds.first.second, node.second);
+        nodes_bounds.second.first = std::max(nodes_bounds.second.first, node.first);
+        nodes_bounds.second.second = std::max(nodes_bounds.second.second, node.second);
+    }
+}
+
+std::pair<Point, Point> Room::getBounds() const
+{
+    return cells_bounds;
+}
+
+void Room::indexCells()
+{
+    // The position is checked by spaced, thus it must be in the box
+    cells_bounds = cells.bounds();
+    cells_bounds.first.first = std::min(cells_bounds.first.first, 0);
+    cells_bounds.first.second = std::min(cells_bounds.first.second, 0);
+    cells_bounds.second.first = std::max(cells_bounds.second.first, 0);
+    cells_bounds.second.second = std::max(cells_bounds.second.second, 0);
 }
 
 std::vector<std::shared_ptr<Entity>> Room::getEntities() const
@@ -70,11 +130,7 @@ bool spaced(const Room& room1, const Room& room2, int spacing)
     if (room2.hasCell(room1.getPosition()))
         return false;
 
-    for (const Point& cell : room1.cells)
-        if (room2.treeCells.closeTo(cell + room1.position - room2.position, spacing-1))
-            return false;
-
-    return true;
+    return !room2.treeCells.closeTo(room1.treeCells.getPoints(), room1.position - room2.position, spacing-1);
 }
 
 std::ostream& operator<<(std::ostream& stream, const Room& room)
@@ -132,33 +188,74 @@ std::istream& operator>>(std::istream& stream, Room& room)
     for (size_t i = 0 ; i < nb_entie ; i++)
         stream >> room.entities[i];
 
-    room.treeCells = KDTree(room.cells);
+    room.treeCells = KDTree(room.cells.begin(), room.cells.end());
+    room.indexNodes();
+    room.indexCells();
     return stream;
 }
 
 /* *************** General functions *************** */
 
-std::pair<Point, Point> closest_nodes(const Room& room1, const Room& room2)
+/**
+ * \brief  Find a pair of closest nodes between two rooms, their nodes being sorted by their first coordinate.
+ * \param  nodes1  The nodes of the first room.
+ * \param  nodes2  The nodes of the second room.
+ * \param  offset  The position of the first room relatively to the second room.
+ * \param  bounds2 The bounding box of the nodes of the second room.
+ * \return A pair of nodes of each room.
+ */
+static std::pair<Point, Point> closest_sorted_nodes(const std::vector<Point>& nodes1, const std::vector<Point>& nodes2,
+                                                    Point offset, const std::pair<Point, Point>& bounds2)
 {
-    assert(!room1.getNodes().empty());
-    assert(!room2.getNodes().empty());
+    const Point& min = bounds2.first;
+    const Point& max = bounds2.second;
 
     int best_dist = std::numeric_limits<int>::max();
     std::pair<int, int> best_cell1({0, 0});
     std::pair<int, int> best_cell2({0, 0});
 
-    for (const Point& cell1 : room1.getNodes())
+    // Start with the nodes on the side of room2, the next ones are further and further from it
+    bool backward = nodes1.front().first + nodes1.back().first + 2 * offset.first < min.first + max.first;
+
+    for (size_t i = 0 ; i < nodes1.size() && best_dist > 0 ; i++)
     {
-        for (const Point& cell2 : room2.getNodes())
+        const Point& cell1 = backward ? nodes1[nodes1.size() - 1 - i] : nodes1[i];
+        Point cell = cell1 + offset;
+
+        // No node of room2 is closer than its bounding box
+        int gap_first = std::max({0, min.first - cell.first, cell.first - max.first});
+        int gap_second = std::max({0, min.second - cell.second, cell.second - max.second});
+
+        if (gap_first + gap_second >= best_dist)
+        {
+            if (gap_first >= best_dist && (backward ? cell.first < min.first : cell.first > max.first))
+                break;
+
+            continue;
+        }
+
+        // Look at both sides of the node until the first coordinates are too far
+        auto start = std::lower_bound(begin(nodes2), end(nodes2), cell);
+
+        for (auto node = start ; node != end(nodes2) && node->first - cell.first < best_dist ; ++node)
         {
-            Point diff = room1.getPosition() + cell1 - cell2 - room2.getPosition();
-            int dist = std::abs(diff.first) + std::abs(diff.second);
+            int dist = distance(cell, *node);
+            if (dist < best_dist)
+            {
+                best_dist = dist;
+                best_cell1 = cell1;
+                best_cell2 = *node;
+            }
+        }
 
+        for (auto node = start ; node != begin(nodes2) && cell.first - (node - 1)->first < best_dist ; --node)
+        {
+            int dist = distance(cell, *(node - 1));
             if (dist < best_dist)
             {
                 best_dist = dist;
                 best_cell1 = cell1;
-                best_cell2 = cell2;
+                best_cell2 = *(node - 1);
             }
         }
     }
@@ -166,6 +263,34 @@ std::pair<Point, Point> closest_nodes(const Room& room1, const Room& room2)
     return std::make_pair(best_cell1, best_cell2);
 }
 
+std::pair<Point, Point> closest_nodes(const Room& room1, const Room& room2)
+{
+    assert(!room1.nodes.empty());
+    assert(!room2.nodes.empty());
+
+    // Search the nodes of the smaller room among the nodes of the bigger one
+    if (room1.nodes_by_x.size() > room2.nodes_by_x.size())
+    {
+        auto best_cells = closest_nodes(room2, room1);
+        return std::make_pair(best_cells.second, best_cells.first);
+    }
+
+    // Nodes are sorted along the axis on which the rooms are the most apart
+    Point offset = room1.position - room2.position;
+    Point centers = room1.nodes_bounds.first + room1.nodes_bounds.second + offset + offset
+                  - room2.nodes_bounds.first - room2.nodes_bounds.second;
+
+    if (std::abs(centers.first) >= std::abs(centers.second))
+        return closest_sorted_nodes(room1.nodes_by_x, room2.nodes_by_x, offset, room2.nodes_bounds);
+
+    auto best_cells = closest_sorted_nodes(
+        room1.nodes_by_y, room2.nodes_by_y, transposed(offset),
+        {transposed(room2.nodes_bounds.first), transposed(room2.nodes_bounds.second)}
+    );
+
+    return std::make_pair(transposed(best_cells.first), transposed(best_cells.second));
+}
+
 int ntn_dist(const Room& room1, const Room& room2)
 {
     assert(!room1.getNodes().empty());
@@ -178,12 +303,80 @@ int ntn_dist(const Room& room1, const Room& room2)
     return std::abs(diff.first) + std::abs(diff.second);
 }
 
+/**
+ * \brief  Check if the bounding boxes of two rooms are close enough for the rooms not to be spaced.
+ * \param  distance The maximal gap between the boxes on each axis.
+ */
+static bool bounds_close(const Room& room1, const Room& room2, int distance)
+{
+    Point min1 = room1.getBounds().first + room1.getPosition();
+    Point max1 = room1.getBounds().second + room1.getPosition();
+    Point min2 = room2.getBounds().first + room2.getPosition();
+    Point max2 = room2.getBounds().second + room2.getPosition();
+
+    return min2.first - max1.first <= distance && min1.first - max2.first <= distance &&
+           min2.second - max1.second <= distance && min1.second - max2.second <= distance;
+}
+
+/**
+ * \brief  Move apart two rooms which are not spaced enough.
+ * \param  i1_can_move Whether room1 can be moved.
+ * \param  i2_can_move Whether room2 can be moved, false for the rooms placed before the ones being separated.
+ * \param  spacing     The distance each room is moved by, along each axis.
+ * \param  direction1  Random shift applied to room1 at the end of the iteration.
+ * \param  direction2  Random shift applied to room2 at the end of the iteration.
+ */
+static void push_apart(Room& room1, Room& room2, bool i1_can_move, bool i2_can_move, int spacing,
+                       Point& direction1, Point& direction2)
+{
+    if (i1_can_move && room1.getPosition().first > room2.getPosition().first)
+        room1.setPosition(room1.getPosition() + std::make_pair(spacing, 0));
+
+    if (i1_can_move && room1.getPosition().second > room2.getPosition().second)
+        room1.setPosition(room1.getPosition() + std::make_pair(0, spacing));
+
+    if (i2_can_move && room1.getPosition().first < room2.getPosition().first)
+        room2.setPosition(room2.getPosition() + std::make_pair(spacing, 0));
+
+    if (i2_can_move && room1.getPosition().second < room2.getPosition().second)
+        room2.setPosition(room2.getPosition() + std::make_pair(0, spacing));
+
+    if (room1.getPosition() == room2.getPosition())
+    {
+        // Moves room2 in a random direction.
+        int delta_x = RandGen::uniform_int(-2, 2);
+        int delta_y = RandGen::uniform_int(-2, 2);
+
+        if (i1_can_move)
+            direction1 += {delta_x, delta_y};
+        else if (i2_can_move)
+            direction2 -= {delta_x, delta_y};
+    }
+}
+
 void separate_rooms(std::vector<Room>& rooms, int spacing, size_t left, size_t right)
+{
+    assert(left <= rooms.size());
+
+    RoomGrid grid;
+    for (size_t i_room = 0 ; i_room < left ; i_room++)
+    {
+        const Room& room = rooms[i_room];
+        grid.add(room.getBounds().first + room.getPosition(), room.getBounds().second + room.getPosition());
+    }
+
+    separate_rooms(rooms, spacing, left, right, grid);
+}
+
+void separate_rooms(std::vector<Room>& rooms, int spacing, size_t left, size_t right, const RoomGrid& grid)
 {
     assert(spacing >= 0);
     assert(left < rooms.size() && right <= rooms.size());
+    assert(grid.size() == left);
 
     size_t nb_rooms = rooms.size();
+    int distance = std::max(0, spacing - 1); // Maximal gap between bounding boxes of rooms that are not spaced
+    std::vector<size_t> near;
 
     int remaining_iterations = 10 * (right - left); // Maximum number of iterations
     bool go_on = true; // Set to true while we changed something
@@ -194,64 +387,60 @@ void separate_rooms(std::vector<Room>& rooms, int spacing, size_t left, size_t r
         go_on = false;
         std::vector<std::pair<int, int>> direction(nb_rooms, {0, 0});
 
-        for (size_t i1 = 0 ; i1 < nb_rooms ; i1++)
+        // Pairs are taken in the same order as if every pair with a room that can move was checked: a
+        // room is compared to the rooms of lower index, those that can't move first.
+        for (size_t i1 = left ; i1 < nb_rooms ; i1++)
         {
-            for (size_t i2 = 0 ; i2 < i1 ; i2++)
-            {
-                // Check wether we are allowed to move them
-                bool i1_can_move = left <= i1 && i1 < right;
-                bool i2_can_move = left <= i2 && i2 < right;
+            bool i1_can_move = i1 < right;
 
-                if (!i1_can_move && !i2_can_move)
-                    break;
+            // Rooms before left can only be compared to rooms that can move
+            if (!i1_can_move && left > 0)
+                break;
 
-                // Takes a distinct pair of rooms.
-                Room& room1 = rooms[i1];
-                Room& room2 = rooms[i2];
+            Room& room1 = rooms[i1];
+
+            // Rooms that can't move, the search is done again each time room1 moves
+            bool moved = i1_can_move;
+            size_t next = 0;
 
-                if (!spaced(room1, room2, spacing))
+            while (moved)
+            {
+                moved = false;
+                grid.near(room1.getBounds().first + room1.getPosition(),
+                          room1.getBounds().second + room1.getPosition(), distance, near);
+
+                for (size_t i2 : near)
                 {
-                    go_on = true;
+                    if (i2 < next)
+                        continue;
 
-                    if (i1_can_move && room1.getPosition().first > room2.getPosition().first)
-                    {
-                        int shift = spacing;//std::max(1.f, (room1.getPosition().first - room2.getPosition().first + spacing) / 6.f);
-                        // direction[i1] += {shift, 0};
-                        room1.setPosition(room1.getPosition() + std::make_pair(shift, 0));
-                    }
+                    next = i2 + 1;
 
-                    if (i1_can_move && room1.getPosition().second > room2.getPosition().second)
+                    if (!spaced(room1, rooms[i2], spacing))
                     {
-                        int shift = spacing;//std::max(1.f, (room1.getPosition().second - room2.getPosition().second + spacing) / 6.f);
-                        // direction[i1] += {0, shift};
-                        room1.setPosition(room1.getPosition() + std::make_pair(0, shift));
-                    }
+                        go_on = true;
 
-                    if (i2_can_move && room1.getPosition().first < room2.getPosition().first)
-                    {
-                        int shift = spacing;//std::max(1.f, (room2.getPosition().first - room1.getPosition().first + spacing) / 6.f);
-                        // direction[i2] += {shift, 0};
-                        room2.setPosition(room2.getPosition() + std::make_pair(shift, 0));
-                    }
+                        Point previous = room1.getPosition();
+                        push_apart(room1, rooms[i2], true, false, spacing, direction[i1], direction[i2]);
 
-                    if (i2_can_move && room1.getPosition().second < room2.getPosition().second)
-                    {
-                        int shift = spacing;//std::max(1.f, (room2.getPosition().second - room1.getPosition().second + spacing) / 6.f);
-                        // direction[i2] += {0, shift};
-                        room2.setPosition(room2.getPosition() + std::make_pair(0, shift));
+                        if (room1.getPosition() != previous)
+                        {
+                            moved = true;
+                            break;
+                        }
                     }
+                }
+            }
 
-                    if (room1.getPosition() == room2.getPosition())
-                    {
-                        // Moves room2 in a random direction.
-                        int delta_x = RandGen::uniform_int(-2, 2);
-                        int delta_y = RandGen::uniform_int(-2, 2);
-
-                        if (i1_can_move)
-                            direction[i1] += {delta_x, delta_y};
-                        else if (i2_can_move)
-                            direction[i2] -= {delta_x, delta_y};
-                    }
+            // Rooms that can move
+            for (size_t i2 = left ; i2 < std::min(i1, right) ; i2++)
+            {
+                Room& room2 = rooms[i2];
+
+                if (bounds_close(room1, room2, distance) && !spaced(room1, room2, spacing))
+                {
+                    go_on = true;
+                    push_apart(room1, room2, i1_can_move, true, spacing, direction[i1], direction[i2]);
                 }
             }
         }
@@ -280,12 +469,12 @@ void add_monsters(Room& room, float load)
     // Process cells we could place monsters on
     std::vector<std::pair<int, int>> candidates;
     for (const Point& cell : room.getCells())
-        if (forbidden.find(cell) == end(forbidden))
+        if (!forbidden.contains(cell))
             candidates.push_back(cell);
     nb_monsters = std::min(nb_monsters, candidates.size());
 
     // Select nb_monsters's indexes among all candidates
-    std::random_shuffle(begin(candidates), end(candidates));
+    std::shuffle(begin(candidates), end(candidates), RandGen::engine());
 
     for (size_t i_chosen = 0 ; i_chosen < nb_monsters ; i_chosen++)
     {
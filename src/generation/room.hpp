@@ -16,6 +16,7 @@
 
 #include "gen_pattern.hpp"
 #include "pattern.hpp"
+#include "room_grid.hpp"
 #include "space.hpp"
 
 
@@ -64,9 +65,8 @@ public:
     /**
      * \brief    Get the set of cells of the room.
      * \return   The set of cells of the room, relatively to its position.
-     * \warning  This will make a copy of all cells of the structure.
      */
-    Pattern getCells() const;
+    const Pattern& getCells() const;
 
     /**
      * \brief   Get the size of the room.
@@ -92,6 +92,18 @@ public:
      */
     void setNodes(const Pattern& nnodes);
 
+    /**
+     * \brief   Get the bounding box of the nodes of the room.
+     * \return  The top-left and bottom-right corners of the box, relatively to the room position.
+     */
+    std::pair<Point, Point> getNodesBounds() const;
+
+    /**
+     * \brief   Get the bounding box of the cells of the room, which also contains its position.
+     * \return  The top-left and bottom-right corners of the box, relatively to the room position.
+     */
+    std::pair<Point, Point> getBounds() const;
+
     /**
      * \brief   Get the set of entities placed in the room.
      * \return  A vector of pointer of entities.
@@ -112,13 +124,33 @@ public:
      */
     friend bool spaced(const Room& room1, const Room& room2, int spacing);
 
+    /**
+     * \brief  Find a pair of closest nodes between two rooms, see closest_nodes.
+     */
+    friend std::pair<Point, Point> closest_nodes(const Room& room1, const Room& room2);
+
 private:
+    /**
+     * \brief  Compute nodes_by_x, nodes_by_y and nodes_bounds from the nodes.
+     */
+    void indexNodes();
+
+    /**
+     * \brief  Compute cells_bounds from the cells.
+     */
+    void indexCells();
+
     Point position; ///< Center position of the room.
 
     Pattern cells; ///< Relative positions of the cells placed on the room.
     Pattern nodes; ///< Cells of the pattern that can be used to enter it.
 
     KDTree treeCells; ///< Alternative representation of cells
+    std::pair<Point, Point> cells_bounds; ///< Bounding box of the cells and of the origin, relatively to the position
+
+    std::vector<Point> nodes_by_x;        ///< Nodes sorted by abscissa, then by ordinate
+    std::vector<Point> nodes_by_y;        ///< Nodes with swapped coordinates, sorted by ordinate, then by abscissa
+    std::pair<Point, Point> nodes_bounds; ///< Bounding box of the nodes, relatively to the position
 
     std::vector<std::shared_ptr<Entity>> entities; ///< Entities placed on the room.
 
@@ -143,11 +175,25 @@ private:
  */
 void separate_rooms(std::vector<Room>& rooms, int spacing, size_t left, size_t right);
 
+/**
+ * \brief  Same as separate_rooms, with the rooms that can't be moved already indexed.
+ * \param  grid  Contains the bounding boxes of the rooms of index lower than left, at their position.
+ *
+ * A room is only compared with the rooms whose bounding box is close to its own bounding box, the rooms
+ * before left being found from the grid.
+ */
+void separate_rooms(std::vector<Room>& rooms, int spacing, size_t left, size_t right, const RoomGrid& grid);
+
 /**
  * \brief Find a pair of closest nodes between two rooms.
  * \param   room1  A room, where nodes are specified.
  * \param   room2  A room, where nodes are specified.
- * \return  A pair of the coordinates of the nodes.
+ * \return  A pair of the coordinates of the nodes, relatively to the position of their room.
+ *
+ * Nodes of both rooms are sorted along the axis on which the rooms are the most apart. Nodes of the room
+ * with less nodes are taken from the side of the other room, each one is compared to the nodes of the other
+ * room close to it on that axis, until the nodes are farther from the bounding box of the other room than
+ * the best pair found so far.
  */
 std::pair<Point, Point> closest_nodes(const Room& room1, const Room& room2);
 
@@ -0,0 +1,174 @@
+/**
+ * \file   generation/room_grid.hpp
+ * \brief  Grid of the bounding boxes of rooms, to find the rooms close to a room.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "space.hpp"
+
+#include "../chunk_table.hpp"
+
+
+/**
+ * \brief  Find the rooms whose bounding boxes are close to a box.
+ *
+ * \section Behaviour
+ *   Each room is put in every cell of side CELL its bounding box overlaps. A cell keeps the boxes
+ *   of its rooms as a structure of arrays, so that the boxes of a cell are tested against a box in a
+ *   single loop without branches, which the compiler can vectorise.
+ */
+class RoomGrid
+{
+public:
+    static constexpr int CELL = 32; ///< Side of the cells of the grid, in cells of the map
+
+    /**
+     * \brief  Add the bounding box of the next room.
+     * \param  min Top-left corner of the box, in the map.
+     * \param  max Bottom-right corner of the box, included.
+     * \return The index of the room.
+     */
+    size_t add(Point min, Point max);
+
+    /**
+     * \brief  Number of rooms added.
+     */
+    size_t size() const;
+
+    /**
+     * \brief  Remove every rooms.
+     */
+    void clear();
+
+    /**
+     * \brief  Find the rooms whose bounding boxes are close to a box.
+     * \param  min      Top-left corner of the box.
+     * \param  max      Bottom-right corner of the box, included.
+     * \param  distance Maximal gap between the boxes on each axis.
+     * \param  rooms    Set to the indices of the rooms found, in increasing order.
+     */
+    void near(Point min, Point max, int distance, std::vector<size_t>& rooms) const;
+
+private:
+    /**
+     * \brief  Bounding boxes of the rooms overlapping a cell of the grid, as a structure of arrays.
+     */
+    struct Cell
+    {
+        std::vector<int> min_x;      ///< Left side of each box
+        std::vector<int> min_y;      ///< Top side of each box
+        std::vector<int> max_x;      ///< Right side of each box, included
+        std::vector<int> max_y;      ///< Bottom side of each box, included
+        std::vector<uint32_t> rooms; ///< Index of the room of each box
+    };
+
+    /**
+     * \brief  Index of the cell of the grid containing a coordinate.
+     */
+    static int gridCell(int coordinate);
+
+    ChunkTable<Cell> grid; ///< Boxes of the rooms overlapping each cell of the grid
+    size_t n_rooms = 0;    ///< Number of rooms added
+
+    mutable std::vector<uint8_t> overlaps; ///< Result of the test of each box of a cell, kept to avoid allocations
+};
+
+
+/**
+ * \brief  Test boxes against a box, which is inflated by a distance.
+ * \param  n        Number of boxes.
+ * \param  min_x    Left side of each box.
+ * \param  min_y    Top side of each box.
+ * \param  max_x    Right side of each box, included.
+ * \param  max_y    Bottom side of each box, included.
+ * \param  min      Top-left corner of the box.
+ * \param  max      Bottom-right corner of the box, included.
+ * \param  distance Distance by which the box is inflated on each side.
+ * \param  overlaps Set to 1 for each box overlapping the inflated box, 0 otherwise.
+ */
+inline void boxes_overlap(size_t n, const int* min_x, const int* min_y, const int* max_x, const int* max_y,
+                          Point min, Point max, int distance, uint8_t* overlaps)
+{
+    const int left = min.first - distance;
+    const int top = min.second - distance;
+    const int right = max.first + distance;
+    const int bottom = max.second + distance;
+
+    // No branch, to allow vectorisation
+    for (size_t i = 0 ; i < n ; i++)
+        overlaps[i] = (min_x[i] <= right) & (max_x[i] >= left) & (min_y[i] <= bottom) & (max_y[i] >= top);
+}
+
+inline size_t RoomGrid::add(Point min, Point max)
+{
+    assert(min.first <= max.first && min.second <= max.second);
+
+    for (int x = gridCell(min.first) ; x <= gridCell(max.first) ; x++)
+    {
+        for (int y = gridCell(min.second) ; y <= gridCell(max.second) ; y++)
+        {
+            Cell& cell = grid(x, y);
+            cell.min_x.push_back(min.first);
+            cell.min_y.push_back(min.second);
+            cell.max_x.push_back(max.first);
+            cell.max_y.push_back(max.second);
+            cell.rooms.push_back(static_cast<uint32_t>(n_rooms));
+        }
+    }
+
+    return n_rooms++;
+}
+
+inline size_t RoomGrid::size() const
+{
+    return n_rooms;
+}
+
+inline void RoomGrid::clear()
+{
+    grid.clear();
+    n_rooms = 0;
+}
+
+inline void RoomGrid::near(Point min, Point max, int distance, std::vector<size_t>& rooms) const
+{
+    assert(distance >= 0);
+
+    rooms.clear();
+
+    for (int x = gridCell(min.first - distance) ; x <= gridCell(max.first + distance) ; x++)
+    {
+        for (int y = gridCell(min.second - distance) ; y <= gridCell(max.second + distance) ; y++)
+        {
+            const Cell* cell = grid.find(x, y);
+
+            if (cell == nullptr)
+                continue;
+
+            size_t n = cell->rooms.size();
+            overlaps.resize(n);
+            boxes_overlap(n, cell->min_x.data(), cell->min_y.data(), cell->max_x.data(), cell->max_y.data(),
+                          min, max, distance, overlaps.data());
+
+            for (size_t i = 0 ; i < n ; i++)
+                if (overlaps[i])
+                    rooms.push_back(cell->rooms[i]);
+        }
+    }
+
+    // Rooms overlapping several cells are found several times
+    std::sort(begin(rooms), end(rooms));
+    rooms.erase(std::unique(begin(rooms), end(rooms)), end(rooms));
+}
+
+inline int RoomGrid::gridCell(int coordinate)
+{
+    // Rounded towards negative infinity
+    return coordinate >= 0 ? coordinate / CELL : -((-coordinate + CELL - 1) / CELL);
+}
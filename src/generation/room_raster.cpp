@@ -0,0 +1,82 @@
+#include "room_raster.hpp"
+
+
+ChunkRaster::ChunkRaster()
+{
+    floors.fill(0);
+    walls.fill(0);
+}
+
+void rasterise_room(const Room& room, ChunkTable<ChunkRaster>& raster)
+{
+    typedef BitChunk<Chunk::SIZE> Bits;
+
+    raster.clear();
+    Point position = room.getPosition();
+
+    // Floors, the chunk of the previous cell is kept
+    std::pair<int, int> chunk_id;
+    ChunkRaster* chunk = nullptr;
+
+    for (const Point& cell : room.getCells())
+    {
+        int x = cell.first + position.first;
+        int y = cell.second + position.second;
+
+        if (chunk == nullptr || Chunk::sector(x, y) != chunk_id)
+        {
+            chunk_id = Chunk::sector(x, y);
+            chunk = &raster(chunk_id.first, chunk_id.second);
+        }
+
+        auto relative = Chunk::relative(x, y);
+        chunk->floors[relative.second] |= static_cast<Bits::Row>(Bits::Row(1) << relative.first);
+    }
+
+    // Chunks around the floors can have walls, they are added before taking pointers to the floors
+    size_t nb_floor_chunks = raster.size();
+    for (size_t i = 0 ; i < nb_floor_chunks ; i++)
+    {
+        auto id = raster.idAt(i);
+
+        for (int j = -1 ; j <= 1 ; j++)
+            for (int k = -1 ; k <= 1 ; k++)
+                raster(id.first + k, id.second + j);
+    }
+
+    // Walls are the dilated floors, without the floors
+    static const ChunkRaster::Plane no_floor = ChunkRaster().floors;
+
+    for (size_t i = 0 ; i < raster.size() ; i++)
+    {
+        auto id = raster.idAt(i);
+        std::array<const ChunkRaster::Plane*, 9> block;
+
+        for (int j = -1 ; j <= 1 ; j++)
+        {
+            for (int k = -1 ; k <= 1 ; k++)
+            {
+                const ChunkRaster* other = raster.find(id.first + k, id.second + j);
+                block[3 * (j + 1) + (k + 1)] = other != nullptr ? &other->floors : &no_floor;
+            }
+        }
+
+        ChunkRaster& current = raster.valueAt(i);
+        ChunkRaster::Plane dilated = Bits::dilate(block);
+
+        for (int y = 0 ; y < Chunk::SIZE ; y++)
+            current.walls[y] = static_cast<Bits::Row>(dilated[y] & ~current.floors[y]);
+    }
+
+    // Entities
+    for (const auto& entity : room.getEntities())
+    {
+        int x = entity->getPosition().x + position.first;
+        int y = entity->getPosition().y + position.second;
+        auto id = Chunk::sector(x, y);
+
+        auto copy = entity->copy();
+        copy->setPosition({x, y});
+        raster(id.first, id.second).entities.push_back(copy);
+    }
+}
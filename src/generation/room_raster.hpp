@@ -0,0 +1,44 @@
+/**
+ * \file   generation/room_raster.hpp
+ * \brief  Split the geometry of a room by the chunks of the map it covers.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "../bit_chunk.hpp"
+#include "../chunk.hpp"
+#include "../chunk_table.hpp"
+#include "../entity.hpp"
+
+#include "room.hpp"
+
+
+/**
+ * \brief  Cells and entities of a room which are in a chunk.
+ */
+struct ChunkRaster
+{
+    typedef BitChunk<Chunk::SIZE>::Plane Plane; ///< A boolean property of each cell of a chunk
+
+    /**
+     * \brief  Create the raster of a chunk with no cell of the room.
+     */
+    ChunkRaster();
+
+    Plane floors;                                  ///< Cells of the room
+    Plane walls;                                   ///< Cells around the room, diagonals included, which are not in the room
+    std::vector<std::shared_ptr<Entity>> entities; ///< Copies of the entities of the room, at their position in the map
+};
+
+/**
+ * \brief  Split the cells of a room, the cells around it and its entities by chunk.
+ * \param  room   The room, at its position in the map.
+ * \param  raster Set to the part of the room in each chunk it covers, or which is next to one of its cells.
+ *
+ * Floors are set column by column, cells of a column mostly being in the same chunk. The walls of a chunk
+ * are then computed at once from the floors of the chunks around it.
+ */
+void rasterise_room(const Room& room, ChunkTable<ChunkRaster>& raster);
@@ -1,5 +1,9 @@
+#include <limits>
+
 #include "space.hpp"
 
+#include "../utility.hpp"
+
 
 int distance(Point a, Point b)
 {
@@ -7,98 +11,108 @@ int distance(Point a, Point b)
 }
 
 
-KDTree::KDTree(const KDTree& ctree)
-{
-    vertical_cut = ctree.vertical_cut;
+KDTree::KDTree(const std::set<Point>& points) :
+    KDTree(std::begin(points), std::end(points))
+{}
 
-    if (ctree.center)
-        center = std::make_unique<Point>(*ctree.center);
+void KDTree::build(size_t begin, size_t end, bool vertically)
+{
+    if (end - begin <= 1)
+        return;
+
+    // Select the median point and order the two corresponding subtrees
+    size_t mid = begin + (end - begin) / 2;
+    std::nth_element(points.begin() + begin, points.begin() + mid, points.begin() + end, [vertically](const Point& a, const Point& b) {
+        if (vertically)
+            return a.first < b.first;
+        else
+            return a.second < b.second;
+    });
 
-    if (ctree.childs)
-        childs = std::make_unique<std::pair<KDTree, KDTree>>(ctree.childs->first, ctree.childs->second);
+    build(begin, mid, !vertically);
+    build(mid + 1, end, !vertically);
 }
 
-KDTree::KDTree(const std::set<Point>& points)
+bool KDTree::closeTo(Point point, int space) const
 {
-    std::vector<Point> copy;
-    std::copy(std::begin(points), std::end(points), std::back_inserter(copy));
-    *this = KDTree(std::begin(copy), std::end(copy), true);
+    if (boundsDistance(point) > space)
+        return false;
+
+    return closeTo(point, space, 0, points.size(), true);
 }
 
-KDTree::KDTree(std::vector<Point>::iterator begin, std::vector<Point>::iterator end, bool vertically) :
-    vertical_cut(vertically)
+bool KDTree::closeTo(const std::vector<Point>& cpoints, Point offset, int space) const
 {
-    if (begin == end)
-    {
-        // Create an empty tree
-        center = nullptr;
-        childs = nullptr;
-    }
-    else
+    for (const Point& cpoint : cpoints)
     {
-        // Select the median point and create the two corresponding subtrees
-        std::vector<Point>::iterator mid = begin + ((end - begin) / 2);
-        std::nth_element(begin, mid, end, [this](Point& a, Point& b) {
-            if (vertical_cut)
-                return a.first < b.first;
-            else
-                return a.second < b.second;
-        });
-
-        center = std::make_unique<Point>(*mid);
-        childs = std::make_unique<std::pair<KDTree, KDTree>>(
-            KDTree(begin, mid, !vertically),
-            KDTree(mid+1, end, !vertically)
-        );
+        Point point = cpoint + offset;
+
+        // Most points of a room far from this set are rejected here
+        if (boundsDistance(point) <= space && closeTo(point, space, 0, points.size(), true))
+            return true;
     }
+
+    return false;
 }
 
-bool KDTree::closeTo(Point point, int space) const
+const std::vector<Point>& KDTree::getPoints() const
 {
-    if (center == nullptr)
-        return false;
-    if (distance(*center, point) <= space)
-        return true;
+    return points;
+}
 
-    // Project the points on the axis we cutted.
-    int point_pos, center_pos;
-    if (vertical_cut)
-    {
-        point_pos = point.first;
-        center_pos = center->first;
-    }
-    else
-    {
-        point_pos = point.second;
-        center_pos = center->second;
-    }
+size_t KDTree::size() const
+{
+    return points.size();
+}
 
-    // Check if there is a trivial deduction to make.
-    if (std::abs(point_pos - center_pos) > space)
-    {
-        if (point_pos < center_pos)
-            return childs->first.closeTo(point, space);
-        else
-            return childs->second.closeTo(point, space);
-    }
-    else
+bool KDTree::closeTo(Point point, int space, size_t begin, size_t end, bool vertically) const
+{
+    while (begin < end)
     {
+        size_t mid = begin + (end - begin) / 2;
+        const Point& center = points[mid];
+
+        if (distance(center, point) <= space)
+            return true;
+
+        // Project the points on the axis we cutted.
+        int point_pos = vertically ? point.first : point.second;
+        int center_pos = vertically ? center.first : center.second;
+
+        // The side of the point is searched first, the other side only if it can be close enough
         if (point_pos < center_pos)
-            return childs->first.closeTo(point, space) || childs->second.closeTo(point, space);
+        {
+            if (closeTo(point, space, begin, mid, !vertically))
+                return true;
+
+            if (center_pos - point_pos > space)
+                return false;
+
+            begin = mid + 1;
+        }
         else
-            return childs->second.closeTo(point, space) || childs->first.closeTo(point, space);
+        {
+            if (closeTo(point, space, mid + 1, end, !vertically))
+                return true;
+
+            if (point_pos - center_pos > space)
+                return false;
+
+            end = mid;
+        }
+
+        vertically = !vertically;
     }
+
+    return false;
 }
 
-KDTree& KDTree::operator=(const KDTree& ctree)
+int KDTree::boundsDistance(Point point) const
 {
-    vertical_cut = ctree.vertical_cut;
-
-    if (ctree.center)
-        center = std::make_unique<Point>(*ctree.center);
-
-    if (ctree.childs)
-        childs = std::make_unique<std::pair<KDTree, KDTree>>(ctree.childs->first, ctree.childs->second);
+    if (points.empty())
+        return std::numeric_limits<int>::max();
 
-    return *this;
+    int dx = std::max({0, min.first - point.first, point.first - max.first});
+    int dy = std::max({0, min.second - point.second, point.second - max.second});
+    return dx + dy;
 }
@@ -6,7 +6,6 @@
 #pragma once
 
 #include <algorithm>
-#include <memory>
 #include <set>
 #include <tuple>
 #include <vector>
@@ -25,15 +24,27 @@ int distance(Point a, Point b);
 
 /**
  * \brief Partition a set of point as a kd-tree.
+ *
+ * The tree is implicit: its points are stored in a single array, the node of a range of the array being
+ * its median point. Nodes at an even depth cut the space vertically, the others horizontally. Points
+ * before the median of a range are on the left (resp. top) of the cut, points after it on its right
+ * (resp. bottom).
  */
 class KDTree
 {
 public:
     /**
-     * \brief  Default copy of a kd-tree.
-     * \param  ctree  The tree we need to copy.
+     * \brief Construct an empty kd-tree.
      */
-    KDTree(const KDTree& ctree);
+    KDTree() = default;
+
+    /**
+     * \brief Construct a kd-tree representing a range of points.
+     * \param begin The first point of the range.
+     * \param end   The end (excluded) of the range.
+     */
+    template <typename Iterator>
+    KDTree(Iterator begin, Iterator end);
 
     /**
      * \brief Construct a kd-tree representing an array of points.
@@ -50,27 +61,69 @@ public:
     bool closeTo(Point point, int space) const;
 
     /**
-     * \brief  Default copy of a kd-tree.
+     * \brief Check if one point of an array is closer than a given range.
+     * \param points Points of the space.
+     * \param offset Vector added to each point of the array.
+     * \param space  The maximal distance a point should be to this set.
+     * \return true if one of the points, moved by offset, is closer than 'space' to a point of the set.
+     */
+    bool closeTo(const std::vector<Point>& points, Point offset, int space) const;
+
+    /**
+     * \brief  Get the points of the tree, in the order of the tree.
      */
-    KDTree& operator=(const KDTree& ctree);
+    const std::vector<Point>& getPoints() const;
+
+    /**
+     * \brief  Number of points of the tree.
+     */
+    size_t size() const;
 
 private:
     /**
-     * \brief Construct a kd-tree representing a subarray of points.
+     * \brief Order a range of points as a subtree.
      * \param begin The begining of the subarray we add in the tree.
      * \param end The end (excluded) of the subarray we add in the tree.
+     * \param vertically Wether the cut of the root of the subtree is vertical.
      */
-    KDTree(std::vector<Point>::iterator begin, std::vector<Point>::iterator end, bool vertically);
-
-
-    bool vertical_cut; ///< Wether the cut is vertical or horizontal.
+    void build(size_t begin, size_t end, bool vertically);
 
-    std::unique_ptr<Point> center; ///< The point represented by the node, space is cut with a line passing through this point.
+    /**
+     * \brief Check if a point is closer than a given range to a subtree.
+     */
+    bool closeTo(Point point, int space, size_t begin, size_t end, bool vertically) const;
 
     /**
-     * \brief The two subtrees.
-     * If the cut is vertical, the first one is on the left of *center, and the second one on its right.
-     * If the cut is horizontal, the first one is on the top of *center, and the second one on its bottom.
+     * \brief Distance between a point and the bounding box of the tree.
      */
-    std::unique_ptr<std::pair<KDTree, KDTree>> childs; ///< The two subtrees.
+    int boundsDistance(Point point) const;
+
+
+    std::vector<Point> points; ///< Points of the tree, the root of each subtree is the median of its range
+
+    Point min; ///< Top-left corner of the bounding box of the points
+    Point max; ///< Bottom-right corner of the bounding box of the points
 };
+
+
+template <typename Iterator>
+KDTree::KDTree(Iterator begin, Iterator end) :
+    points(begin, end),
+    min(0, 0),
+    max(0, 0)
+{
+    if (points.empty())
+        return;
+
+    min = max = points.front();
+
+    for (const Point& point : points)
+    {
+        min.first = std::min(min.first, point.first);
+        min.second = std::min(min.second, point.second);
+        max.first = std::max(max.first, point.first);
+        max.second = std::max(max.second, point.second);
+    }
+
+    build(0, points.size(), true);
+}
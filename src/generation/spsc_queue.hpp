@@ -0,0 +1,121 @@
+/**
+ * \file   generation/spsc_queue.hpp
+ * \brief  Queue passing values from one thread to another without locks.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+
+/**
+ * \brief  Unbounded queue with a single producer and a single consumer.
+ *
+ * \section Behaviour
+ *   Values are kept in a linked list whose first node was already popped. The producer only writes the
+ *   last node and the consumer only reads the first one, they share nothing but the links between nodes,
+ *   which are released by the producer and acquired by the consumer.
+ *
+ *   The producer and the consumer may change thread, as long as the new thread synchronises with the
+ *   previous one, for example with a mutex.
+ */
+template <typename T>
+class SpscQueue
+{
+public:
+    /**
+     * \brief  Create an empty queue.
+     */
+    SpscQueue();
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    /**
+     * \brief  Destroy the values left in the queue.
+     */
+    ~SpscQueue();
+
+    /**
+     * \brief  Add a value at the end of the queue, only called by the producer.
+     */
+    void push(T value);
+
+    /**
+     * \brief  Remove the value at the front of the queue, only called by the consumer.
+     * \param  value Set to the value removed.
+     * \return false if the queue was empty, value is then unchanged.
+     */
+    bool pop(T& value);
+
+    /**
+     * \brief  Check if there is no value to pop, only called by the consumer.
+     */
+    bool empty() const;
+
+private:
+    /**
+     * \brief  A value of the queue and the link to the next one.
+     */
+    struct Node
+    {
+        T value;                 ///< The value, moved away from the first node
+        std::atomic<Node*> next; ///< The next node, or nullptr for the last one
+    };
+
+    Node* head; ///< Node of the last value popped, owned by the consumer
+    Node* tail; ///< Node of the last value pushed, owned by the producer
+};
+
+
+template <typename T>
+SpscQueue<T>::SpscQueue() :
+    head(new Node()),
+    tail(head)
+{
+    head->next.store(nullptr, std::memory_order_relaxed);
+}
+
+template <typename T>
+SpscQueue<T>::~SpscQueue()
+{
+    while (head != nullptr)
+    {
+        Node* next = head->next.load(std::memory_order_relaxed);
+        delete head;
+        head = next;
+    }
+}
+
+template <typename T>
+void SpscQueue<T>::push(T value)
+{
+    Node* node = new Node();
+    node->value = std::move(value);
+    node->next.store(nullptr, std::memory_order_relaxed);
+
+    // The value is written before the consumer can reach the node
+    tail->next.store(node, std::memory_order_release);
+    tail = node;
+}
+
+template <typename T>
+bool SpscQueue<T>::pop(T& value)
+{
+    Node* next = head->next.load(std::memory_order_acquire);
+    if (next == nullptr)
+        return false;
+
+    value = std::move(next->value);
+    delete head;
+    head = next;
+
+    return true;
+}
+
+template <typename T>
+bool SpscQueue<T>::empty() const
+{
+    return head->next.load(std::memory_order_acquire) == nullptr;
+}
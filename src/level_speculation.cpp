@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <utility>
+
+#include "level_speculation.hpp"
+
+
+constexpr int LevelSpeculator::PARK_FACTOR;
+
+LevelSpeculator::LevelSpeculator(int radius_, std::function<uint64_t()> seeds_) :
+    radius(radius_),
+    seeds(std::move(seeds_)),
+    distance(0),
+    speculating(false)
+{}
+
+void LevelSpeculator::reset(const GenerationMode& parameters_, int distance_)
+{
+    parameters = parameters_;
+    distance = distance_;
+    next = nullptr;
+    speculating = false;
+}
+
+void LevelSpeculator::update(bool deepest, sf::Vector2i hero, const std::vector<std::shared_ptr<Entity>>& entities,
+                             MapExploration& exploration)
+{
+    if (distance <= 0)
+        return;
+
+    // Closest stairs going down, only the level below the deepest one is unknown
+    int stairs_distance = std::numeric_limits<int>::max();
+    bool revealed = false;
+
+    for (const auto& entity : entities)
+    {
+        if (!deepest || entity->getType() != EntityType::Stairs || entity->getInteraction() != Interaction::GoDown)
+            continue;
+
+        sf::Vector2i stairs = entity->getPosition();
+        int d = std::max(std::abs(stairs.x - hero.x), std::abs(stairs.y - hero.y));
+        if (d < stairs_distance)
+        {
+            stairs_distance = d;
+            revealed = exploration.isExplored(stairs);
+        }
+    }
+
+    int park_distance = PARK_FACTOR * distance;
+
+    if (!speculating && stairs_distance <= park_distance && (revealed || stairs_distance <= distance))
+    {
+        if (!next)
+        {
+            next = std::make_shared<Generator>(parameters, seeds());
+            next->setForeground(false);
+        }
+
+        // Around the entrance, as loaded when the hero arrives
+        next->preGenerateRadius(0, 0, radius);
+        speculating = true;
+    }
+    else if (speculating && stairs_distance > park_distance)
+    {
+        // The chunks generated so far are kept for when the hero comes back
+        next->cancelOutside(0, 0, 0);
+        speculating = false;
+    }
+}
+
+std::shared_ptr<Generator> LevelSpeculator::takeGenerator()
+{
+    std::shared_ptr<Generator> generator = next ? next : std::make_shared<Generator>(parameters, seeds());
+
+    next = nullptr;
+    speculating = false;
+
+    return generator;
+}
+
+bool LevelSpeculator::isSpeculating() const
+{
+    return speculating;
+}
+
+bool LevelSpeculator::hasGenerator() const
+{
+    return next != nullptr;
+}
@@ -0,0 +1,89 @@
+/**
+ * \file level_speculation.hpp
+ * \brief Generate the next level of the dungeon before the hero goes down.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <SFML/System/Vector2.hpp>
+
+#include "generation/generator.hpp"
+
+#include "entity.hpp"
+#include "exploration.hpp"
+
+
+/**
+ * \brief Starts the generation of the level below the deepest one when the hero comes close to stairs going down.
+ *
+ * \section Behaviour
+ *   The generation starts when the closest stairs going down are revealed, or closer than a distance, the
+ *   entrance of the level being generated first, in the background. It is parked when the hero goes back
+ *   further than PARK_FACTOR times this distance, or leaves the deepest level: the chunks waiting to be
+ *   generated are cancelled and the chunks generated so far are kept. It is resumed when the hero comes back.
+ *
+ *   The generator is given to the level when the hero goes down, see takeGenerator.
+ *
+ * \note Distances are in cells, along the largest of the two axes.
+ */
+class LevelSpeculator
+{
+public:
+    static constexpr int PARK_FACTOR = 2; ///< The generation is parked when the hero is this many times further than the distance
+
+    /**
+     * \brief Create a speculator which doesn't generate anything until it is reset.
+     * \param radius Radius of the square of chunks generated around the entrance of the next level.
+     * \param seeds Draw the seed of a new level.
+     */
+    LevelSpeculator(int radius, std::function<uint64_t()> seeds);
+
+    /**
+     * \brief Forget the next level, for a new game for instance.
+     * \param parameters The configuration of the generation of the levels.
+     * \param distance Distance to stairs going down below which the next level is generated, 0 to never generate it.
+     */
+    void reset(const GenerationMode& parameters, int distance);
+
+    /**
+     * \brief Start, resume or park the generation of the next level from the position of the hero.
+     * \param deepest Whether the hero is on the deepest level.
+     * \param hero Position of the hero.
+     * \param entities The entities of the level, among which the stairs going down.
+     * \param exploration The exploration state of the level.
+     */
+    void update(bool deepest, sf::Vector2i hero, const std::vector<std::shared_ptr<Entity>>& entities,
+                MapExploration& exploration);
+
+    /**
+     * \brief Give the generator of the next level, when the hero goes down the stairs.
+     * \return The generator started in advance, or a new one if none was started.
+     *
+     * The generator is forgotten, the generation of the next level will start with a new one.
+     */
+    std::shared_ptr<Generator> takeGenerator();
+
+    /**
+     * \brief Check if the generation of the next level is running, false when it is parked.
+     */
+    bool isSpeculating() const;
+
+    /**
+     * \brief Check if the generation of the next level was started, parked or not.
+     */
+    bool hasGenerator() const;
+
+private:
+    int radius;                         ///< Radius of the square generated around the entrance
+    std::function<uint64_t()> seeds;    ///< Draw the seed of a new level
+    GenerationMode parameters;          ///< Configuration of the generation of the levels
+    int distance;                       ///< Distance below which the next level is generated, 0 if never
+
+    std::shared_ptr<Generator> next;    ///< Generator of the next level, nullptr if not started
+    bool speculating;                   ///< Whether next is generating, false once parked
+};
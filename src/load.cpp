@@ -1,5 +1,6 @@
 #include <fstream>
 
+#include "entity_journal.hpp"
 #include "game.hpp"
 
 
@@ -15,8 +16,11 @@ bool Game::loadGame(const std::string& save_name)
     dungeon.clear();
     exploration.clear();
     generators.clear();
+    pagers.clear();
+    speculator.reset(config.gen_options, config.speculation_distance);
 
     current_level = 0;
+    loaded_level = SIZE_MAX;
     map = nullptr;
     map_exploration = nullptr;
     entities = nullptr;
@@ -44,6 +48,12 @@ bool Game::loadGame(const std::string& save_name)
 
     load_dungeon(max_level, dungeon, exploration, generators, load_path, config.gen_options);
 
+    for (std::size_t i_level = 0 ; i_level < dungeon.size() ; i_level++)
+    {
+        pagers.push_back(createPager(i_level));
+        generators[i_level]->setForeground(i_level == current_level);
+    }
+
     map = &dungeon[current_level].map;
     generator = generators[current_level];
     entities = &dungeon[current_level].entities;
@@ -68,24 +78,30 @@ bool load_dungeon(uint32_t dungeon_size,
         Level& level = dungeon.back();
         MapExploration& map_exploration = exploration.back();
 
-        level.map.loadFromFile(save_path + "levels/map" + std::to_string(i_level) + ".dat");
-        map_exploration.load(save_path + "levels/exploration" + std::to_string(i_level) + ".dat");
+        const std::string map_path {save_path + "levels/map" + std::to_string(i_level) + ".dat"};
+        const std::string exploration_path {save_path + "levels/exploration" + std::to_string(i_level) + ".dat"};
 
-        std::ifstream entities_file {
-            save_path + "levels/entities" + std::to_string(i_level) + ".dat",
-            std::ios::binary
-        };
+        level.map.loadFromFile(map_path);
+        level.map.loadChangesFromFile(map_path + ".journal");
+        map_exploration.load(exploration_path);
+        map_exploration.loadChanges(exploration_path + ".journal");
+
+        const std::string entities_path {save_path + "levels/entities" + std::to_string(i_level) + ".dat"};
+        std::ifstream entities_file {entities_path, std::ios::binary};
         uint32_t n_entities {0};
         entities_file.read(reinterpret_cast<char*>(&n_entities), sizeof(uint32_t));
         level.entities.resize(n_entities);
         for (unsigned int i {0}; i < n_entities; ++i)
             entities_file >> level.entities[i];
+        load_entities_changes(entities_path + ".journal", level.entities);
 
         std::ifstream generator_file {
             save_path + "levels/generator" + std::to_string(i_level) + ".dat",
             std::ios::binary
         };
         generator_file >> *generators[i_level];
+
+        level.saved = true;
     }
 
     return true;
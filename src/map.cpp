@@ -2,140 +2,396 @@
 #include <fstream>
 
 #include "map.hpp"
+#include "rand.hpp"
 
 
-/* Implementation of the class Chunk */
+/* Implementation of the class BasicMap */
 
-Chunk::Chunk()
+template <int Size>
+BasicMap<Size>::BasicMap() :
+    last_key(0),
+    last_index(ChunkTable<Chunk>::NONE),
+    last_decoration_key(0),
+    last_decoration_index(ChunkTable<Chunk>::NONE)
+{}
+
+template <int Size>
+void BasicMap<Size>::setChunk(int x, int y, const Chunk& chunk)
 {
-    cells.fill(CellType::Empty);
+    invalidate(x, y);
+    chunks.insert(x, y, chunk);
+    dirty_chunks.insert(x, y, 1);
 }
 
-CellType& Chunk::cellAt(int x, int y)
+template <int Size>
+void BasicMap<Size>::setChunk(int x, int y, Chunk&& chunk)
 {
-    assert(x >= 0 && x < SIZE);
-    assert(y >= 0 && y < SIZE);
-
-    return cells[x + SIZE * y];
+    invalidate(x, y);
+    chunks.insert(x, y, std::move(chunk));
+    dirty_chunks.insert(x, y, 1);
 }
 
-CellType Chunk::cellAt(int x, int y) const
+template <int Size>
+typename BasicMap<Size>::Chunk& BasicMap<Size>::editChunk(int x, int y)
 {
-    assert(x >= 0 && x < SIZE);
-    assert(y >= 0 && y < SIZE);
+    invalidate(x, y);
+    dirty_chunks.insert(x, y, 1);
 
-    return cells[x + SIZE * y];
-}
+    Chunk* chunk = chunks.find(x, y);
 
-std::pair<int, int> Chunk::sector(int x, int y) {
-    if (x < 0) x -= SIZE - 1;
-    if (y < 0) y -= SIZE - 1;
+    // New chunks are added after the others, indices of other chunks are kept
+    if (chunk == nullptr)
+        return chunks.insert(x, y, Chunk());
 
-    return std::make_pair(x, y) / SIZE;
+    return *chunk;
 }
 
-std::pair<int, int> Chunk::relative(int x, int y) {
-    if (x < 0) x -= SIZE - 1;
-    if (y < 0) y -= SIZE - 1;
+template <int Size>
+typename BasicMap<Size>::Chunk BasicMap<Size>::extractChunk(int x, int y)
+{
+    Chunk* chunk = chunks.find(x, y);
 
-    return std::make_pair(x, y) % SIZE;
-}
+    if (chunk == nullptr)
+        return Chunk();
 
-/* Implementation of the class Map */
+    Chunk extracted = std::move(*chunk);
 
-Map::Map() {}
+    // Erasing moves the last chunk of the table
+    invalidate(x, y);
+    chunks.erase(x, y);
+    dirty_chunks.erase(x, y);
+    last_index = ChunkTable<Chunk>::NONE;
 
-void Map::setChunk(int x, int y, const Chunk& chunk)
-{
-    chunks[{x, y}] = chunk;
+    return extracted;
 }
 
-bool Map::hasCell(int x, int y) const
+template <int Size>
+bool BasicMap<Size>::hasCell(int x, int y) const
 {
-    std::pair<int, int> chunk_id = Chunk::sector(x, y);
-    return hasChunk(chunk_id.first, chunk_id.second);
+    return chunkIndexOfCell(x, y) != ChunkTable<Chunk>::NONE;
 }
 
-bool Map::hasChunk(int x, int y) const
+template <int Size>
+bool BasicMap<Size>::hasChunk(int x, int y) const
 {
-    std::pair<int, int> chunk_id = {x, y};
-    return chunks.find(chunk_id) != end(chunks);
+    return chunks.contains(x, y);
 }
 
-std::vector<std::pair<int, int>> Map::getChunks() const
+template <int Size>
+std::vector<std::pair<int, int>> BasicMap<Size>::getChunks() const
 {
     std::vector<std::pair<int, int>> ret;
+    ret.reserve(chunks.size());
 
-    for (const auto& item: chunks)
-        ret.push_back(item.first);
+    for (size_t i = 0 ; i < chunks.size() ; i++)
+        ret.push_back(chunks.idAt(i));
 
     return ret;
 }
 
-CellType& Map::cellAt(int x, int y)
+template <int Size>
+const typename BasicMap<Size>::Chunk* BasicMap<Size>::findChunk(int x, int y) const
+{
+    return chunks.find(x, y);
+}
+
+template <int Size>
+size_t BasicMap<Size>::chunkIndexOfCell(int x, int y) const
 {
     std::pair<int, int> chunk_id = Chunk::sector(x, y);
+    uint64_t key = ChunkTable<Chunk>::key(chunk_id.first, chunk_id.second);
+
+    // Most reads are close to the previous one
+    if (key != last_key || last_index == ChunkTable<Chunk>::NONE)
+    {
+        size_t index = chunks.indexOf(chunk_id.first, chunk_id.second);
+
+        if (index == ChunkTable<Chunk>::NONE)
+            return index;
+
+        last_key = key;
+        last_index = index;
+    }
+
+    return last_index;
+}
+
+template <int Size>
+void BasicMap<Size>::setCell(int x, int y, CellType type)
+{
+    size_t index = chunkIndexOfCell(x, y);
     std::pair<int, int> relt_pos = Chunk::relative(x, y);
 
-    // Create a new chunk if needed
-    assert(hasCell(x, y));
+    // The chunk must exist
+    assert(index != ChunkTable<Chunk>::NONE);
 
-    return chunks[chunk_id].cellAt(relt_pos.first, relt_pos.second);
+    std::pair<int, int> chunk_id = chunks.idAt(index);
+    invalidate(chunk_id.first, chunk_id.second);
+    dirty_chunks.insert(chunk_id.first, chunk_id.second, 1);
+
+    chunks.valueAt(index).cellAt(relt_pos.first, relt_pos.second) = type;
 }
 
-CellType& Map::cellAt(sf::Vector2i coords)
+template <int Size>
+void BasicMap<Size>::setCell(sf::Vector2i coords, CellType type)
+{
+    setCell(coords.x, coords.y, type);
+}
+
+template <int Size>
+CellType BasicMap<Size>::cellAt(int x, int y) const
+{
+    size_t index = chunkIndexOfCell(x, y);
+
+    if (index == ChunkTable<Chunk>::NONE)
+        return CellType::Empty;
+
+    std::pair<int, int> relt_pos = Chunk::relative(x, y);
+    return chunks.valueAt(index).cellAt(relt_pos.first, relt_pos.second);
+}
+
+template <int Size>
+CellType BasicMap<Size>::cellAt(sf::Vector2i coords) const
 {
     return cellAt(coords.x, coords.y);
 }
 
-CellType Map::cellAt(int x, int y) const
+template <int Size>
+typename BasicMap<Size>::Chunk BasicMap<Size>::chunkAt(int x, int y) const
+{
+    assert(chunks.contains(x, y));
+
+    return *chunks.find(x, y);
+}
+
+template <int Size>
+const BitChunk<Size>& BasicMap<Size>::bitChunkAt(int x, int y) const
 {
-    if (!hasCell(x, y))
+    static const BitChunk<Size> empty_chunk;
+
+    size_t index = bit_chunks.indexOf(x, y);
+
+    if (index != ChunkTable<BitChunk<Size>>::NONE)
+        return bit_chunks.valueAt(index);
+
+    const Chunk* chunk = chunks.find(x, y);
+
+    if (chunk == nullptr)
+        return empty_chunk;
+
+    return bit_chunks.insert(x, y, BitChunk<Size>(*chunk));
+}
+
+template <int Size>
+std::array<const typename BitChunk<Size>::Plane*, 9> BasicMap<Size>::planeBlock(int x, int y, CellType type) const
+{
+    assert(type != CellType::Empty);
+
+    // Build every planes before taking pointers to them, building one can move the others
+    for (int j = -1 ; j <= 1 ; j++)
+        for (int i = -1 ; i <= 1 ; i++)
+            bitChunkAt(x + i, y + j);
+
+    std::array<const typename BitChunk<Size>::Plane*, 9> block;
+
+    for (int j = -1 ; j <= 1 ; j++)
     {
-        return CellType::Empty;
+        for (int i = -1 ; i <= 1 ; i++)
+        {
+            const BitChunk<Size>& bit_chunk = bitChunkAt(x + i, y + j);
+            block[3 * (j + 1) + (i + 1)] = type == CellType::Wall ? &bit_chunk.walls() : &bit_chunk.floors();
+        }
+    }
+
+    return block;
+}
+
+template <int Size>
+typename BitChunk<Size>::Plane BasicMap<Size>::wallNextPlane(int x, int y) const
+{
+    const ChunkMasks<Size>* cached = masks.find(x, y);
+
+    if (cached != nullptr)
+        return cached->wall_next;
+
+    return BitChunk<Size>::dilate(planeBlock(x, y, CellType::Wall));
+}
+
+template <int Size>
+const ChunkMasks<Size>& BasicMap<Size>::chunkMasks(int x, int y) const
+{
+    const ChunkMasks<Size>* cached = masks.find(x, y);
+
+    if (cached != nullptr)
+        return *cached;
+
+    ChunkMasks<Size> result;
+    result.wall_next = wallNextPlane(x, y);
+
+    for (int i = 0 ; i < 4 ; i++)
+    {
+        sf::Vector2i next = sf::Vector2i(x, y) + to_vector2i(directions[i]);
+
+        result.wall_next_at[i] =
+            BitChunk<Size>::neighbours(result.wall_next, wallNextPlane(next.x, next.y), directions[i]);
     }
-    else
+
+    std::array<const typename BitChunk<Size>::Plane*, 9> block = planeBlock(x, y, CellType::Floor);
+    result.floor_next = BitChunk<Size>::dilate(block);
+
+    for (int i = 0 ; i < 4 ; i++)
     {
-        std::pair<int, int> chunk_id = Chunk::sector(x, y);
-        std::pair<int, int> relt_pos = Chunk::relative(x, y);
+        sf::Vector2i next = sf::Vector2i(x, y) + to_vector2i(directions[i]);
 
-        return chunks.at(chunk_id).cellAt(relt_pos.first, relt_pos.second);
+        result.floor_at[i] = BitChunk<Size>::neighbours(
+            *block[4], *block[3 * (next.y - y + 1) + (next.x - x + 1)], directions[i]);
     }
+
+    return masks.insert(x, y, result);
 }
 
-CellType Map::cellAt(sf::Vector2i coords) const
+template <int Size>
+CellDecoration BasicMap<Size>::decorationAt(int x, int y) const
 {
-    return cellAt(coords.x, coords.y);
+    std::pair<int, int> chunk_id = Chunk::sector(x, y);
+    std::pair<int, int> relt_pos = Chunk::relative(x, y);
+    uint64_t key = ChunkTable<Chunk>::key(chunk_id.first, chunk_id.second);
+
+    if (key != last_decoration_key || last_decoration_index == ChunkTable<Chunk>::NONE)
+    {
+        size_t index = decorations.indexOf(chunk_id.first, chunk_id.second);
+
+        if (index == ChunkTable<Chunk>::NONE)
+        {
+            if (!chunks.contains(chunk_id.first, chunk_id.second))
+                return CellDecoration();
+
+            decorations.insert(chunk_id.first, chunk_id.second, buildDecoration(chunk_id.first, chunk_id.second));
+            index = decorations.size() - 1;
+        }
+
+        last_decoration_key = key;
+        last_decoration_index = index;
+    }
+
+    return decorations.valueAt(last_decoration_index)[relt_pos.first + (relt_pos.second << Chunk::SHIFT)];
 }
 
-Chunk Map::chunkAt(int x, int y) const
+template <int Size>
+ChunkDecoration<Size> BasicMap<Size>::buildDecoration(int x, int y) const
 {
-    assert(chunks.find({x, y}) != end(chunks));
+    ChunkMasks<Size> chunk_masks = chunkMasks(x, y);
+    const Chunk& chunk = *chunks.find(x, y);
+    ChunkDecoration<Size> decoration;
+
+    for (int j = 0 ; j < Size ; j++)
+    {
+        for (int i = 0 ; i < Size ; i++)
+        {
+            CellDecoration& cell = decoration[i + (j << Chunk::SHIFT)];
+            sf::Vector2i coords = {x * Size + i, y * Size + j};
 
-    return chunks.at({x, y});
+            if (BitChunk<Size>::test(chunk_masks.wall_next, i, j))
+                cell.floor_neighborhood = Direction::Down | Direction::Up | Direction::Left | Direction::Right;
+
+            for (int k = 0 ; k < 4 ; k++)
+            {
+                if (BitChunk<Size>::test(chunk_masks.wall_next_at[k], i, j))
+                    cell.floor_neighborhood |= directions[k];
+                if (BitChunk<Size>::test(chunk_masks.floor_at[k], i, j))
+                    cell.wall_neighborhood |= directions[k];
+            }
+
+            // The variant is the one the renderer used to draw for these coordinates
+            RandRender::seed(std::hash<sf::Vector2i>{}(coords));
+            cell.variant = static_cast<uint8_t>(RandRender::uniform_int(0, 5));
+
+            if (chunk.cellAt(i, j) != CellType::Wall)
+                continue;
+
+            cell.below = cellAt(coords + sf::Vector2i(0, 1));
+
+            for (int k = 0 ; k < 4 ; k++)
+            {
+                Direction dir1 = directions[k], dir2 = directions[(k+1) & 3];
+
+                if (has_direction(cell.wall_neighborhood, dir1) || has_direction(cell.wall_neighborhood, dir2))
+                    continue;
+
+                cell.corners |= static_cast<uint8_t>(1 << k);
+                if (cellAt(coords + to_vector2i(dir1 | dir2)) == CellType::Floor)
+                    cell.floor_corners |= static_cast<uint8_t>(1 << k);
+            }
+        }
+    }
+
+    return decoration;
 }
 
-bool Map::wallNext(int x, int y) const
+template <int Size>
+void BasicMap<Size>::invalidate(int x, int y)
 {
-    for (int i = -1; i <= 1; i++)
+    bit_chunks.erase(x, y);
+
+    if (masks.empty() && decorations.empty())
+        return;
+
+    // Masks use the wall_next plane of neighbours, which depends on their own neighbours
+    for (int j = -2 ; j <= 2 ; j++)
     {
-        for (int j = -1; j <= 1; j++)
+        for (int i = -2 ; i <= 2 ; i++)
         {
-            if (cellAt(x + i, y + j) == CellType::Wall)
-                return true;
+            masks.erase(x + i, y + j);
+            decorations.erase(x + i, y + j);
         }
     }
 
-    return false;
+    last_decoration_index = ChunkTable<Chunk>::NONE;
+}
+
+template <int Size>
+bool BasicMap<Size>::wallNext(int x, int y) const
+{
+    std::pair<int, int> chunk_id = Chunk::sector(x, y);
+    std::pair<int, int> relt_pos = Chunk::relative(x, y);
+
+    return BitChunk<Size>::test(chunkMasks(chunk_id.first, chunk_id.second).wall_next,
+                                relt_pos.first, relt_pos.second);
 }
 
-bool Map::wallNext(sf::Vector2i coords) const
+template <int Size>
+bool BasicMap<Size>::wallNext(sf::Vector2i coords) const
 {
     return wallNext(coords.x, coords.y);
 }
 
 
-bool Map::loadFromFile(const std::string& filename)
+template <int Size>
+bool BasicMap<Size>::isDirty(int x, int y) const
+{
+    return dirty_chunks.contains(x, y);
+}
+
+template <int Size>
+bool BasicMap<Size>::isModified() const
+{
+    return !dirty_chunks.empty();
+}
+
+template <int Size>
+void BasicMap<Size>::markClean(int x, int y)
+{
+    dirty_chunks.erase(x, y);
+}
+
+template <int Size>
+void BasicMap<Size>::markClean()
+{
+    dirty_chunks.clear();
+}
+
+template <int Size>
+bool BasicMap<Size>::loadFromFile(const std::string& filename)
 {
     std::ifstream file;
     file.open(filename);
@@ -144,11 +400,13 @@ bool Map::loadFromFile(const std::string& filename)
         return false;
 
     file >> *this;
+    markClean();
 
     return true;
 }
 
-void Map::saveToFile(const std::string& filename) const
+template <int Size>
+void BasicMap<Size>::saveToFile(const std::string& filename) const
 {
     std::ofstream file(filename);
 
@@ -160,34 +418,179 @@ void Map::saveToFile(const std::string& filename) const
     return;
 }
 
-std::ostream& operator<<(std::ostream& stream, const Map& map)
+template <int Size>
+bool BasicMap<Size>::saveChangesToFile(const std::string& filename) const
 {
-    int size = map.chunks.size();
-    stream.write(reinterpret_cast<const char*>(&size), sizeof(int));
+    std::ofstream file(filename, std::ios::app | std::ios::binary);
 
-    for (const auto& item : map.chunks) {
-        stream.write(reinterpret_cast<const char*>(&item.first), sizeof(std::pair<int, int>));
-        stream.write(reinterpret_cast<const char*>(&item.second), sizeof(Chunk));
+    if (!file.is_open())
+        return false;
+
+    // A partial map with the dirty chunks which are still there
+    BasicMap<Size> changes;
+
+    for (size_t i = 0 ; i < dirty_chunks.size() ; i++)
+    {
+        std::pair<int, int> chunk_id = dirty_chunks.idAt(i);
+        const Chunk* chunk = chunks.find(chunk_id.first, chunk_id.second);
+
+        if (chunk != nullptr)
+            changes.chunks.insert(chunk_id.first, chunk_id.second, *chunk);
+    }
+
+    file << changes;
+
+    return true;
+}
+
+template <int Size>
+bool BasicMap<Size>::loadChangesFromFile(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+
+    if (!file.is_open())
+        return false;
+
+    // Reading a map overwrites the chunks it contains and keeps the other ones
+    while (file.peek() != std::ifstream::traits_type::eof() && file >> *this)
+        continue;
+
+    markClean();
+
+    return true;
+}
+
+namespace
+{
+    constexpr int FORMAT_MARKER = -1;  ///< Written instead of the number of chunks by current format
+    constexpr int FORMAT_VERSION = 1;  ///< Version of the format of the map
+    constexpr int LEGACY_CHUNK_SIZE = 4; ///< Size of the chunks in maps saved before the version 1
+
+    /**
+     * \brief Get the position of a cell stored in a chunk of a map saved before the version 1.
+     * \param chunk Coordinate of the chunk.
+     * \param relative Coordinate of the cell in the chunk.
+     * \return The coordinate of the cell in the map.
+     *
+     * Old maps didn't store cells of chunks with negative coordinates at their natural position.
+     */
+    int legacy_cell(int chunk, int relative)
+    {
+        if (chunk < 0)
+            return LEGACY_CHUNK_SIZE * chunk + (relative + LEGACY_CHUNK_SIZE - 1) % LEGACY_CHUNK_SIZE;
+
+        return LEGACY_CHUNK_SIZE * chunk + relative;
+    }
+}
+
+template <int Size>
+std::ostream& operator<<(std::ostream& stream, const BasicMap<Size>& map)
+{
+    int header[] = {FORMAT_MARKER, FORMAT_VERSION, static_cast<int>(map.chunks.size()), Size};
+    stream.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+    for (size_t i = 0 ; i < map.chunks.size() ; i++) {
+        std::pair<int, int> chunk_id = map.chunks.idAt(i);
+        int origin[] = {chunk_id.first * Size, chunk_id.second * Size};
+
+        stream.write(reinterpret_cast<const char*>(origin), sizeof(origin));
+        stream.write(reinterpret_cast<const char*>(&map.chunks.valueAt(i)), sizeof(BasicChunk<Size>));
     }
 
     return stream;
 }
 
-std::istream& operator>>(std::istream& stream, Map& map)
+template <int Size>
+std::istream& operator>>(std::istream& stream, BasicMap<Size>& map)
 {
+    // Cells are written directly in the chunks
+    map.bit_chunks.clear();
+    map.masks.clear();
+    map.decorations.clear();
+    map.last_decoration_index = ChunkTable<BasicChunk<Size>>::NONE;
+
     int size;
     stream.read(reinterpret_cast<char*>(&size), sizeof(int));
 
+    // Map saved before the version 1 of the format: chunks of 4 cells identified by their coordinates
+    if (size >= 0)
+    {
+        for (int i = 0 ; i < size ; i++)
+        {
+            std::pair<int, int> chunk_id;
+            std::array<CellType, LEGACY_CHUNK_SIZE*LEGACY_CHUNK_SIZE> cells;
+
+            stream.read(reinterpret_cast<char*>(&chunk_id), sizeof(std::pair<int, int>));
+            stream.read(reinterpret_cast<char*>(cells.data()), sizeof(cells));
+
+            for (int y = 0 ; y < LEGACY_CHUNK_SIZE ; y++) {
+                for (int x = 0 ; x < LEGACY_CHUNK_SIZE ; x++) {
+                    int cell_x = legacy_cell(chunk_id.first, x);
+                    int cell_y = legacy_cell(chunk_id.second, y);
+                    std::pair<int, int> sector = BasicChunk<Size>::sector(cell_x, cell_y);
+                    std::pair<int, int> relative = BasicChunk<Size>::relative(cell_x, cell_y);
+
+                    map.chunks(sector.first, sector.second).cellAt(relative.first, relative.second) =
+                        cells[x + LEGACY_CHUNK_SIZE * y];
+                }
+            }
+        }
+
+        return stream;
+    }
+
+    int version, chunk_size;
+    stream.read(reinterpret_cast<char*>(&version), sizeof(int));
+    stream.read(reinterpret_cast<char*>(&size), sizeof(int));
+    stream.read(reinterpret_cast<char*>(&chunk_size), sizeof(int));
+
+    if (version != FORMAT_VERSION || chunk_size <= 0) {
+        stream.setstate(std::ios::failbit);
+        return stream;
+    }
+
+    std::vector<CellType> cells(chunk_size * chunk_size);
+
     for (int i = 0 ; i < size ; i++)
     {
-        std::pair<int, int> chunk_id;
-        Chunk chunk_ct;
+        int origin[2];
+        stream.read(reinterpret_cast<char*>(origin), sizeof(origin));
+
+        // Chunks of the same size can be read directly
+        if (chunk_size == Size && origin[0] % Size == 0 && origin[1] % Size == 0) {
+            BasicChunk<Size> chunk_ct;
+            stream.read(reinterpret_cast<char*>(&chunk_ct), sizeof(BasicChunk<Size>));
+            map.chunks.insert(origin[0] / Size, origin[1] / Size, chunk_ct);
+            continue;
+        }
+
+        // Otherwise, cells are dispatched in the chunks of the current size
+        stream.read(reinterpret_cast<char*>(cells.data()), cells.size());
 
-        stream.read(reinterpret_cast<char*>(&chunk_id), sizeof(std::pair<int, int>));
-        stream.read(reinterpret_cast<char*>(&chunk_ct), sizeof(Chunk));
+        for (int y = 0 ; y < chunk_size ; y++) {
+            for (int x = 0 ; x < chunk_size ; x++) {
+                std::pair<int, int> sector = BasicChunk<Size>::sector(origin[0] + x, origin[1] + y);
+                std::pair<int, int> relative = BasicChunk<Size>::relative(origin[0] + x, origin[1] + y);
 
-        map.chunks[chunk_id] = chunk_ct;
+                map.chunks(sector.first, sector.second).cellAt(relative.first, relative.second) =
+                    cells[x + chunk_size * y];
+            }
+        }
     }
 
     return stream;
 }
+
+
+/* Explicit instantiations of the sizes of chunks which can be used */
+
+#define INSTANTIATE_CHUNK_SIZE(Size) \
+    template class BasicMap<Size>; \
+    template std::ostream& operator<< <Size>(std::ostream& stream, const BasicMap<Size>& map); \
+    template std::istream& operator>> <Size>(std::istream& stream, BasicMap<Size>& map);
+
+INSTANTIATE_CHUNK_SIZE(4)
+INSTANTIATE_CHUNK_SIZE(8)
+INSTANTIATE_CHUNK_SIZE(16)
+INSTANTIATE_CHUNK_SIZE(32)
+INSTANTIATE_CHUNK_SIZE(64)
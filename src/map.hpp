@@ -7,97 +7,64 @@
 
 #include <algorithm>
 #include <array>
+#include <cassert>
 #include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <iterator>
 #include <tuple>
-#include <map>
 #include <string>
 #include <vector>
 
+#include <SFML/Graphics/Rect.hpp>
 #include <SFML/System/Vector2.hpp>
 
+#include "bit_chunk.hpp"
+#include "chunk.hpp"
+#include "chunk_table.hpp"
+#include "decoration.hpp"
 #include "entity.hpp"
 #include "utility.hpp"
 
 
-/**
- * \brief Static information about the behaviour of the cell
- */
-enum class CellType : uint8_t
-{
-    Empty = 0, ///< A cell that can't contain anything
-    Floor = 1, ///< A cell you can walk on
-    Wall  = 2  ///< A wall
-};
-
-/**
- * \brief Represents a section of the map.
- */
-class Chunk
-{
-public:
-    constexpr static int SIZE = 4; ///< width and height of the chunks.
-
-    /**
-     * \brief Create a chunk full of empty cells.
-     */
-    Chunk();
-
-    /**
-     * \brief Get a read-write access to a cell by its coordinates
-     * \param x X coordinate of the cell
-     * \param y Y coordinate of the cell
-     * \return Reference to the cell
-     * `x` and `y` must be in the ranges `[0, SIZE)` and `[0, SIZE)`
-     */
-    CellType& cellAt(int x, int y);
+template <int Size>
+class BasicMap;
 
-    /**
-     * \brief Get a read only access to a cell by its coordinates
-     * \param x X coordinate of the cell
-     * \param y Y coordinate of the cell
-     * \return The cell type of the cell
-     * `x` and `y` can be outside the ranges `[0, SIZE)` and `[0, SIZE)`
-     * in which case CellType::Empty is returned
-     */
-    CellType cellAt(int x, int y) const;
+template <int Size>
+std::ostream& operator<<(std::ostream& stream, const BasicMap<Size>& map);
 
-    /**
-     * \brief Get the coordinates of the chunk which contains a given cell.
-     * \param x X coordinate of the cell in the map
-     * \param y Y coordinate of the cell in the map
-     * \return A pair containing the coordinates of the chunk.
-     */
-    static std::pair<int, int> sector(int x, int y);
-
-    /**
-     * \brief Get the coordinates corresponding to a given cell, in its chunk.
-     * \param x X coordinate of the cell in the map
-     * \param y Y coordinate of the cell in the map
-     * \return A pair containing the coordinates of the chunk.
-     */
-    static std::pair<int, int> relative(int x, int y);
-
-private:
-    std::array<CellType, SIZE*SIZE> cells; ///< The type of each cells in the chunk
-};
+template <int Size>
+std::istream& operator>>(std::istream& stream, BasicMap<Size>& map);
 
 /**
  * \brief Represents an entire level
+ * \param Size Width and height of the chunks of the map.
  *
  * The map is of a fixed shape.
  * It describes its cells but also what entities are on it.
+ *
+ * Chunks are stored in a ChunkTable, and the last chunk accessed through a cell is remembered:
+ * consecutive reads of cells of the same chunk don't need any lookup in the table.
+ *
+ * Queries about the neighbourhood of cells are answered for a whole chunk at once with bit planes
+ * (see BitChunk), which are built when needed and kept until a cell of the area is modified.
+ * The decoration of cells is derived from them and cached the same way, so that drawing a chunk
+ * only computes it again when the chunk or one of its neighbours changes.
+ *
+ * Chunks which are set or edited, or whose cells are set, are marked as dirty until the map is
+ * marked as clean, so that a save only needs to write the chunks which changed (see saveChangesToFile).
+ * \warning Since reading the map updates these caches, a map must not be read from several threads at once.
  */
-class Map
+template <int Size>
+class BasicMap
 {
 public:
+    typedef BasicChunk<Size> Chunk; ///< Type of the chunks of the map
 
     /**
      * \brief Create an empty map
      */
-    Map();
+    BasicMap();
 
     /**
      * \brief Set a chunk.
@@ -107,6 +74,30 @@ public:
      */
     void setChunk(int x, int y, const Chunk& chunk);
 
+    /**
+     * \brief Set a chunk, moving its content in the map.
+     * \param x x-coordinate of the chunk.
+     * \param y y-coordinate of the chunk.
+     * \param chunk The chunk we want to add.
+     */
+    void setChunk(int x, int y, Chunk&& chunk);
+
+    /**
+     * \brief Get a read-write access to a whole chunk, it is created empty if it doesn't exist.
+     * \param x x-coordinate of the chunk.
+     * \param y y-coordinate of the chunk.
+     * \return Reference to the chunk, valid until a chunk is added or removed.
+     */
+    Chunk& editChunk(int x, int y);
+
+    /**
+     * \brief Remove a chunk from the map and get its content.
+     * \param x x-coordinate of the chunk.
+     * \param y y-coordinate of the chunk.
+     * \return The chunk that was removed, or an empty chunk if it didn't exist.
+     */
+    Chunk extractChunk(int x, int y);
+
     /**
      * \brief Check wether a chunk is in the generated part of the map.
      * \param x The x-coordinate of the chunk we are interested in.
@@ -129,21 +120,21 @@ public:
     bool hasCell(int x, int y) const;
 
     /**
-     * \brief Get a read-write access to a cell by its coordinates
+     * \brief Change a cell given its coordinates
      * \param x X coordinate of the cell
      * \param y Y coordinate of the cell
-     * \return Reference to the cell
-     * \note The chunk must be specified.
+     * \param type The new type of the cell
+     * \note The chunk must be specified, it is marked as dirty and the caches of its area are dropped.
      */
-    CellType& cellAt(int x, int y);
+    void setCell(int x, int y, CellType type);
 
     /**
-     * \brief Get a read-write access to a cell by its coordinates
+     * \brief Change a cell given its coordinates
      * \param coords Coordinates of the cell
-     * \return Reference to the cell
-     * \note The chunk must be specified.
+     * \param type The new type of the cell
+     * \note The chunk must be specified, it is marked as dirty and the caches of its area are dropped.
      */
-    CellType& cellAt(sf::Vector2i coords);
+    void setCell(sf::Vector2i coords, CellType type);
 
     /**
      * \brief Get a read only access to a cell by its coordinates
@@ -162,6 +153,17 @@ public:
      */
     CellType cellAt(sf::Vector2i coords) const;
 
+    /**
+     * \brief Visit the cells of a rectangle row by row, looking up each chunk only once.
+     * \param area The rectangle of cells to visit.
+     * \param visitor Function called as `visitor(x, y, cells, length)` for each span of `length` cells of a
+     *        row starting at `(x, y)`. `cells` points to the cells of the span, or is nullptr if they are in
+     *        chunks which don't exist, consecutive missing chunks of a row being reported as a single span.
+     * \warning The visitor must not modify the map.
+     */
+    template <typename Visitor>
+    void forEachSpan(sf::IntRect area, Visitor visitor) const;
+
     /**
      * \brief Get a read only access to a chunk given its coordinates
      * \param x X coordinate of the chunk
@@ -170,6 +172,32 @@ public:
      */
     Chunk chunkAt(int x, int y) const;
 
+    /**
+     * \brief Get a pointer to a chunk given its coordinates
+     * \param x X coordinate of the chunk
+     * \param y Y coordinate of the chunk
+     * \return A pointer to the chunk, or nullptr if it doesn't exist.
+     * \warning The pointer is invalidated when a chunk is added to the map.
+     */
+    const Chunk* findChunk(int x, int y) const;
+
+    /**
+     * \brief Get the neighbourhood of every cells of a chunk.
+     * \param x X coordinate of the chunk
+     * \param y Y coordinate of the chunk
+     * \return The masks of the chunk, the chunk doesn't need to exist.
+     * \warning The reference is invalidated by the next call and when the map is modified.
+     */
+    const ChunkMasks<Size>& chunkMasks(int x, int y) const;
+
+    /**
+     * \brief Get the decoration of a cell, it is computed for the whole chunk if needed.
+     * \param x X coordinate of the cell
+     * \param y Y coordinate of the cell
+     * \return The decoration of the cell, a default one if its chunk doesn't exist.
+     */
+    CellDecoration decorationAt(int x, int y) const;
+
     /**
      * \brief Check if there is a wall next to a cell
      */
@@ -181,7 +209,27 @@ public:
     bool wallNext(sf::Vector2i coords) const;
 
     /**
-     * \brief Load the map from a file
+     * \brief Check if a chunk was modified since the map was loaded or marked as clean.
+     */
+    bool isDirty(int x, int y) const;
+
+    /**
+     * \brief Check if a chunk of the map was modified since the map was loaded or marked as clean.
+     */
+    bool isModified() const;
+
+    /**
+     * \brief Mark a chunk as saved.
+     */
+    void markClean(int x, int y);
+
+    /**
+     * \brief Mark every chunks as saved.
+     */
+    void markClean();
+
+    /**
+     * \brief Load the map from a file, every chunks are clean afterwards.
      * \param filename Path of the file
      */
     bool loadFromFile(const std::string& filename);
@@ -192,13 +240,96 @@ public:
      */
     void saveToFile(const std::string& filename) const;
 
+    /**
+     * \brief Append the dirty chunks of the map to a journal.
+     * \param filename Path of the journal
+     * \return false if the journal can't be written.
+     *
+     * The changes are written in the format of the map, thus a journal is a sequence of partial maps.
+     * Dirty chunks which aren't in the map anymore are not written.
+     */
+    bool saveChangesToFile(const std::string& filename) const;
+
+    /**
+     * \brief Apply the changes of a journal to the map, in the order they were written.
+     * \param filename Path of the journal
+     * \return false if there is no journal.
+     */
+    bool loadChangesFromFile(const std::string& filename);
+
 private:
+    /**
+     * \brief Find the chunk containing a cell, looking at the last chunk accessed first.
+     * \param x X coordinate of the cell
+     * \param y Y coordinate of the cell
+     * \return The index of the chunk in `chunks`, or ChunkTable::NONE if it doesn't exist.
+     */
+    size_t chunkIndexOfCell(int x, int y) const;
+
+    /**
+     * \brief Get the bit planes of a chunk, they are built if needed.
+     * \return The planes of the chunk, or planes of empty cells if it doesn't exist.
+     * \warning The reference is invalidated when the bit planes of another chunk are built.
+     */
+    const BitChunk<Size>& bitChunkAt(int x, int y) const;
+
+    /**
+     * \brief Get the planes of a block of 3x3 chunks, row by row, as expected by BitChunk::dilate.
+     * \param x X coordinate of the chunk at the center of the block
+     * \param y Y coordinate of the chunk at the center of the block
+     * \param type Type of the cells of the planes, Floor or Wall
+     * \warning The pointers are invalidated when the bit planes of another chunk are built.
+     */
+    std::array<const typename BitChunk<Size>::Plane*, 9> planeBlock(int x, int y, CellType type) const;
+
+    /**
+     * \brief Get the cells of a chunk with a wall next to them, see ChunkMasks::wall_next.
+     */
+    typename BitChunk<Size>::Plane wallNextPlane(int x, int y) const;
+
+    /**
+     * \brief Compute the decoration of every cells of an existing chunk.
+     */
+    ChunkDecoration<Size> buildDecoration(int x, int y) const;
+
+    /**
+     * \brief Forget the bit planes, masks and decorations which depend on a chunk.
+     * It must be called before the chunk is modified.
+     */
+    void invalidate(int x, int y);
+
     /**
      * \brief The content of each chunks
      */
-    std::map<std::pair<int, int>, Chunk> chunks;
+    ChunkTable<Chunk> chunks;
+
+    ChunkTable<uint8_t> dirty_chunks; ///< Chunks modified since the map was saved, removed chunks excepted
+
+    mutable uint64_t last_key;  ///< Key of the last chunk accessed through a cell
+    mutable size_t last_index;  ///< Index of the last chunk accessed through a cell, or ChunkTable::NONE
+
+    mutable ChunkTable<BitChunk<Size>> bit_chunks; ///< Bit planes of the chunks which were queried
+    mutable ChunkTable<ChunkMasks<Size>> masks;    ///< Masks of the chunks which were queried
+
+    mutable ChunkTable<ChunkDecoration<Size>> decorations; ///< Decoration of the chunks which were drawn
+    mutable uint64_t last_decoration_key;   ///< Key of the last chunk whose decoration was read
+    mutable size_t last_decoration_index;   ///< Index of the decoration of this chunk, or ChunkTable::NONE
 
 
-    friend std::ostream& operator<<(std::ostream& stream, const Map& map);
-    friend std::istream& operator>>(std::istream& stream, Map& map);
+    /**
+     * \brief Serialisation of the map.
+     *
+     * Chunks are written with the coordinates of their first cell and their size, thus a map can be
+     * read by a program using a different size of chunks.
+     */
+    friend std::ostream& operator<< <>(std::ostream& stream, const BasicMap& map);
+
+    /**
+     * \brief Unserialisation of the map, it also reads maps saved with an older format.
+     */
+    friend std::istream& operator>> <>(std::istream& stream, BasicMap& map);
 };
+
+typedef BasicMap<CHUNK_SIZE> Map; ///< Maps used by the game
+
+#include "map.inl"
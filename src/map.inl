@@ -0,0 +1,52 @@
+template <int Size>
+template <typename Visitor>
+void BasicMap<Size>::forEachSpan(sf::IntRect area, Visitor visitor) const
+{
+    if (area.width <= 0 || area.height <= 0)
+        return;
+
+    int right = area.left + area.width;
+    int bottom = area.top + area.height;
+    std::pair<int, int> first = Chunk::sector(area.left, area.top);
+    std::pair<int, int> last = Chunk::sector(right - 1, bottom - 1);
+
+    // Chunks of the current row of chunks
+    std::vector<const Chunk*> band(last.first - first.first + 1);
+
+    for (int chunk_y = first.second ; chunk_y <= last.second ; chunk_y++)
+    {
+        for (int chunk_x = first.first ; chunk_x <= last.first ; chunk_x++)
+            band[chunk_x - first.first] = chunks.find(chunk_x, chunk_y);
+
+        int top = std::max(area.top, chunk_y * Size);
+        int end = std::min(bottom, (chunk_y + 1) * Size);
+
+        for (int y = top ; y < end ; y++)
+        {
+            const int relative_y = y & (Size - 1);
+            int x = area.left;
+
+            while (x < right)
+            {
+                int i_chunk = Chunk::sector(x, y).first - first.first;
+                const Chunk* chunk = band[i_chunk];
+
+                if (chunk != nullptr)
+                {
+                    int length = std::min(right, (first.first + i_chunk + 1) * Size) - x;
+                    visitor(x, y, chunk->rowAt(relative_y) + (x & (Size - 1)), length);
+                    x += length;
+                    continue;
+                }
+
+                // Merge the following missing chunks
+                while (i_chunk + 1 < static_cast<int>(band.size()) && band[i_chunk + 1] == nullptr)
+                    i_chunk++;
+
+                int length = std::min(right, (first.first + i_chunk + 1) * Size) - x;
+                visitor(x, y, static_cast<const CellType*>(nullptr), length);
+                x += length;
+            }
+        }
+    }
+}
@@ -0,0 +1,76 @@
+#include "../ressources.hpp"
+#include "../utility.hpp"
+#include "loading.hpp"
+
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+
+
+LoadingMenu::LoadingMenu(std::shared_ptr<Generator> generator_, std::size_t level_) :
+    generator(generator_),
+    level(level_),
+    progress(0.f)
+{
+    text.setFont(RessourceManager::getFont());
+    text.setString("Generating the level");
+    text.setCharacterSize(30);
+    text.setColor(sf::Color::Yellow);
+
+    sf::Vector2f position = {
+        Configuration::default_configuration.width / 2.f,
+        Configuration::default_configuration.height / 3.f
+    };
+    text.setPosition(position - vec::size(text.getLocalBounds()) / 2.f);
+}
+
+void LoadingMenu::update()
+{
+    progress = generator->getProgress();
+}
+
+void LoadingMenu::handleInput(const sf::Event&, const Configuration&)
+{
+}
+
+MenuEvent LoadingMenu::menuEvent()
+{
+    MenuEvent event {};
+
+    // The level is entered once its entrance can be taken without waiting
+    if (generator->isReady(0, 0))
+    {
+        event.type = MenuEvent::LevelGenerated;
+        event.level = level;
+    }
+
+    return event;
+}
+
+bool LoadingMenu::displayGame()
+{
+    return false;
+}
+
+void LoadingMenu::render(sf::RenderTarget& target)
+{
+    const float width = Configuration::default_configuration.width / 2.f;
+    const float height = 20.f;
+
+    sf::Vector2f position = {
+        (Configuration::default_configuration.width - width) / 2.f,
+        2.f * Configuration::default_configuration.height / 3.f - height / 2.f
+    };
+
+    sf::RectangleShape bar_bg {{width, height}};
+    bar_bg.setPosition(position);
+    bar_bg.setFillColor({50, 50, 50});
+    bar_bg.setOutlineColor(sf::Color::White);
+    bar_bg.setOutlineThickness(2.f);
+
+    sf::RectangleShape bar {{progress * width, height}};
+    bar.setPosition(position);
+    bar.setFillColor(sf::Color::Yellow);
+
+    target.draw(text);
+    target.draw(bar_bg);
+    target.draw(bar);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <memory>
+
+#include <SFML/Graphics.hpp>
+
+#include "../generation/generator.hpp"
+#include "../config.hpp"
+#include "menu.hpp"
+
+
+class LoadingMenu : public Menu
+{
+public:
+
+    explicit LoadingMenu(std::shared_ptr<Generator> generator, std::size_t level);
+
+    virtual void update() override final;
+    virtual void handleInput(const sf::Event& event, const Configuration& config) override final;
+    virtual MenuEvent menuEvent() override final;
+
+    virtual bool displayGame() override final;
+    virtual void render(sf::RenderTarget& target) override final;
+
+private:
+
+    std::shared_ptr<Generator> generator;
+    std::size_t level;
+    float progress;
+
+    sf::Text text;
+};
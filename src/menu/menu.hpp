@@ -23,11 +23,13 @@ struct MenuEvent
         NewGame,
         LoadGame,
         SaveGame,
-        NextMenu
+        NextMenu,
+        LevelGenerated
     } type = Nothing;
     std::string save_path = Configuration::user_path;
     Class hero_class = Class::Warrior;
     std::shared_ptr<Menu> next_menu = nullptr;
+    std::size_t level = 0;
 };
 
 /**
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "game_over.hpp"
+#include "loading.hpp"
 #include "menu.hpp"
 #include "main.hpp"
 #include "new_game.hpp"
@@ -5,6 +5,8 @@
 
 #pragma once
 
+#include <cstdint>
+#include <limits>
 #include <random>
 
 
@@ -15,6 +17,78 @@ enum class RandomType
     Generation
 };
 
+/**
+ * \brief Counter-based random engine
+ *
+ * The n-th number of a stream is computed from n and the key of the stream only, using the
+ * "Squares" function of B. Widynski. Thus streams with different keys are independent, and
+ * a stream can be recreated anywhere from its key.
+ */
+class CounterEngine
+{
+public:
+    typedef uint32_t result_type; ///< Type of the numbers generated
+
+    /**
+     * \brief Create the stream of a key
+     */
+    explicit CounterEngine(uint64_t key = 1);
+
+    /**
+     * \brief Compute a key from the parameters identifying a stream
+     * \param seed The seed of the stream, for instance the seed of a level
+     * \param x X coordinate of the chunk the stream is used for
+     * \param y Y coordinate of the chunk the stream is used for
+     * \param purpose What the stream is used for, so that several streams can be used for the same chunk
+     */
+    static uint64_t key(uint64_t seed, int x, int y, uint32_t purpose);
+
+    /**
+     * \brief Restart the engine on the stream of a key
+     */
+    void seed(uint64_t key);
+
+    /**
+     * \brief Get the next number of the stream
+     */
+    result_type operator()();
+
+    /**
+     * \brief Skip numbers of the stream
+     */
+    void discard(unsigned long long n);
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+private:
+    /**
+     * \brief Mix the bits of a number (finaliser of SplitMix64)
+     */
+    static uint64_t mix(uint64_t value);
+
+    uint64_t stream_key; ///< Key of the stream, it must have well spread bits
+    uint64_t counter;    ///< Index of the next number of the stream
+};
+
+/**
+ * \brief Type of the engine used for each kind of random numbers
+ */
+template <RandomType T>
+struct RandomEngine
+{
+    typedef std::minstd_rand type;
+};
+
+/**
+ * \brief Generation uses independent streams for each chunk, see CounterEngine
+ */
+template <>
+struct RandomEngine<RandomType::Generation>
+{
+    typedef CounterEngine type;
+};
+
 /**
  * \brief Handle the generation of random numbers
  */
@@ -22,6 +96,7 @@ template <RandomType T>
 class Random
 {
 public:
+    typedef typename RandomEngine<T>::type Engine; ///< Type of the internal engine
 
     Random() = delete;
 
@@ -55,13 +130,63 @@ public:
      */
     static float uniform_float(float a, float b);
 
+    /**
+     * \brief Get the internal engine, to shuffle a sequence for instance
+     */
+    static Engine& engine();
+
 private:
 
-    static std::minstd_rand random_engine; ///< The internal random engine
+    static thread_local Engine random_engine; ///< The internal random engine, each thread has its own
 };
 
+inline CounterEngine::CounterEngine(uint64_t key)
+{
+    seed(key);
+}
+
+inline uint64_t CounterEngine::mix(uint64_t value)
+{
+    value = (value ^ (value >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+    value = (value ^ (value >> 27)) * UINT64_C(0x94D049BB133111EB);
+    return value ^ (value >> 31);
+}
+
+inline uint64_t CounterEngine::key(uint64_t seed, int x, int y, uint32_t purpose)
+{
+    uint64_t coords = (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+    return mix(mix(seed) ^ mix(coords + UINT64_C(0x9E3779B97F4A7C15)) ^ (static_cast<uint64_t>(purpose) << 1));
+}
+
+inline void CounterEngine::seed(uint64_t key)
+{
+    // The key is mixed again since seeds are usually small numbers
+    stream_key = mix(key) | 1;
+    counter = 0;
+}
+
+inline CounterEngine::result_type CounterEngine::operator()()
+{
+    uint64_t x = counter * stream_key;
+    uint64_t y = x;
+    uint64_t z = y + stream_key;
+
+    counter++;
+
+    x = x * x + y; x = (x >> 32) | (x << 32);
+    x = x * x + z; x = (x >> 32) | (x << 32);
+    x = x * x + y; x = (x >> 32) | (x << 32);
+
+    return static_cast<result_type>((x * x + z) >> 32);
+}
+
+inline void CounterEngine::discard(unsigned long long n)
+{
+    counter += n;
+}
+
 template <RandomType T>
-std::minstd_rand Random<T>::random_engine;
+thread_local typename Random<T>::Engine Random<T>::random_engine;
 
 template <RandomType T>
 int Random<T>::uniform_int(int a, int b)
@@ -77,6 +202,12 @@ float Random<T>::uniform_float(float a, float b)
     return distribution(random_engine);
 }
 
+template <RandomType T>
+typename Random<T>::Engine& Random<T>::engine()
+{
+    return random_engine;
+}
+
 typedef Random<RandomType::Game> Rand;
 typedef Random<RandomType::Render> RandRender;
 typedef Random<RandomType::Generation> RandGen;
@@ -53,14 +53,17 @@ void Renderer::drawGame(const Map& map,
     // Draw the map
     sf::IntRect viewport = {entity_center_view->getPosition() - world_view_size / 2, world_view_size};
 
-    for (int x = viewport.left; x < viewport.left + viewport.width; x++)
+    // Walls are drawn over the cell above them, thus cells are drawn from top to bottom
+    sf::IntRect drawn_area = {viewport.left, viewport.top, viewport.width, viewport.height + 1};
+    map.forEachSpan(drawn_area, [&](int x, int y, const CellType* cells, int length)
     {
-        for (int y = viewport.top; y < viewport.top + viewport.height + 1; y++)
-        {
-            CellType cell = map.cellAt(x, y);
-            drawCell({x, y}, cell, map, map_exploration, config);
-        }
-    }
+        // Nothing is drawn on missing chunks
+        if (cells == nullptr)
+            return;
+
+        for (int i = 0 ; i < length ; i++)
+            drawCell({x + i, y}, cells[i], map, map_exploration, config);
+    });
 
     // Draw the entities
     for (const auto& entity : entities)
@@ -303,25 +306,13 @@ void Renderer::drawCell(sf::Vector2i coords, CellType cell, const Map& map, MapE
     if (!wall_visible && !cell_explored)
         return;
 
-    RandRender::seed(std::hash<sf::Vector2i>{}(coords));
-
     sf::Vector2f pos = tile_size * static_cast<sf::Vector2f>(coords);
 
-    Direction floor_neighborhood = Direction::None;
-    if (map.wallNext(coords))
-    {
-        floor_neighborhood = Direction::Down | Direction::Up | Direction::Left | Direction::Right;
-    }
-    else
-    {
-        for (Direction dir : directions)
-        {
-            if (map.wallNext(coords + to_vector2i(dir)))
-                floor_neighborhood |= dir;
-        }
-    }
+    // The decoration is only computed again when the map changes around the cell
+    CellDecoration decoration = map.decorationAt(coords.x, coords.y);
 
-    sf::Vector2f tex_coords = RessourceManager::getTileTextureCoords(CellType::Floor, floor_neighborhood);
+    sf::Vector2f tex_coords =
+        RessourceManager::getTileTextureCoords(CellType::Floor, decoration.floor_neighborhood, decoration.variant);
 
     if (cell_visible || (cell == CellType::Wall && next_visible))
         cell_shade[coords] = std::min(255, cell_shade[coords] + 5);
@@ -357,22 +348,15 @@ void Renderer::drawCell(sf::Vector2i coords, CellType cell, const Map& map, MapE
     if (cell != CellType::Wall)
         return;
 
-    Direction wall_neighborhood = Direction::None;
-    for (Direction dir : directions)
-    {
-        if (map.cellAt(coords + to_vector2i(dir)) == CellType::Floor)
-            wall_neighborhood |= dir;
-    }
-
     // Lower part of walls
     sf::Vector2f wall_tex_coords =
         RessourceManager::getTileTextureCoords(CellType::Empty, Direction::None);
-    if (map.cellAt(coords + sf::Vector2i(0, 1)) == CellType::Empty ||
+    if (decoration.below == CellType::Empty ||
         !map_exploration.isExplored(coords + sf::Vector2i(0, 1)))
         wall_tex_coords = RessourceManager::getTileTextureCoords(CellType::Wall, Direction::None)
             + sf::Vector2f(0.f, tile_size);
-    if (has_direction(wall_neighborhood, Direction::Down))
-        wall_tex_coords = RessourceManager::getTileTextureCoords(CellType::Wall, wall_neighborhood)
+    if (has_direction(decoration.wall_neighborhood, Direction::Down))
+        wall_tex_coords = RessourceManager::getTileTextureCoords(CellType::Wall, decoration.wall_neighborhood)
             + sf::Vector2f(0.f, tile_size);
 
     v1.texCoords = v2.texCoords = v3.texCoords = v4.texCoords = wall_tex_coords;
@@ -389,7 +373,7 @@ void Renderer::drawCell(sf::Vector2i coords, CellType cell, const Map& map, MapE
     map_vertices_bg.push_back(v4);
 
     // Upper part of walls
-    wall_tex_coords = RessourceManager::getTileTextureCoords(CellType::Wall, wall_neighborhood);
+    wall_tex_coords = RessourceManager::getTileTextureCoords(CellType::Wall, decoration.wall_neighborhood);
 
     v1.position.y -= tile_size;
     v2.position.y -= tile_size;
@@ -413,12 +397,10 @@ void Renderer::drawCell(sf::Vector2i coords, CellType cell, const Map& map, MapE
     // Corners of walls
     for (int i = 0; i < 4; ++i)
     {
-        Direction dir1 = directions[i], dir2 = directions[(i+1) & 3],
-            dir_corner = dir1 | dir2;
-        if (map.cellAt(coords + to_vector2i(dir1)) != CellType::Floor &&
-            map.cellAt(coords + to_vector2i(dir2)) != CellType::Floor)
+        Direction dir_corner = directions[i] | directions[(i+1) & 3];
+        if (decoration.corners & (1 << i))
         {
-            CellType corner_cell = map.cellAt(coords + to_vector2i(dir_corner));
+            bool floor_corner = decoration.floor_corners & (1 << i);
 
             sf::Vector2f offset = {0.f, 0.f};
             float height = 0.f;
@@ -428,7 +410,7 @@ void Renderer::drawCell(sf::Vector2i coords, CellType cell, const Map& map, MapE
             if (has_direction(dir_corner, Direction::Down))
             {
                 offset.y += tile_size / 2.f;
-                if (corner_cell == CellType::Floor)
+                if (floor_corner)
                     height = tile_size;
             }
 
@@ -439,7 +421,7 @@ void Renderer::drawCell(sf::Vector2i coords, CellType cell, const Map& map, MapE
             v4.position += {tile_size / 2.f, tile_size / 2.f + height};
 
             sf::Vector2f corner_tex_coords = {256.f, 32.f};
-            if (corner_cell != CellType::Floor)
+            if (!floor_corner)
                 corner_tex_coords = {320.f, 128.f};
 
             v1.texCoords = v2.texCoords = v3.texCoords = v4.texCoords = corner_tex_coords + offset;
@@ -207,17 +207,17 @@ void compute_animation(sf::Vector2i sprite_size,
 }
 
 
-sf::Vector2f RessourceManager::getTileTextureCoords(CellType cell_type, Direction neighborhood)
+sf::Vector2f RessourceManager::getTileTextureCoords(CellType cell_type, Direction neighborhood, int variant)
 {
     if (cell_type == CellType::Floor)
     {
         if (neighborhood == Direction::None)
-            return {RandRender::uniform_int(0, 5) * 32.f, 128.f};
+            return {variant * 32.f, 128.f};
         if (has_direction(neighborhood, Direction::Down) &&
             has_direction(neighborhood, Direction::Up) &&
             has_direction(neighborhood, Direction::Left) &&
             has_direction(neighborhood, Direction::Right))
-            return {RandRender::uniform_int(0, 5) * 32.f, 0.f};
+            return {variant * 32.f, 0.f};
 
         return ground_texture_coords[static_cast<int>(neighborhood)];
     }
@@ -80,7 +80,13 @@ public:
     { ressources_path = ressources_path_; };
 
 
-    static sf::Vector2f getTileTextureCoords(CellType cell_type, Direction neighborhood);
+    /**
+     * \brief Get the position of a tile in the tileset.
+     * \param cell_type Type of the cell
+     * \param neighborhood Sides of the tile which are next to another type of cell
+     * \param variant Variant of the tile for floors which have several ones, in `[0, 5]`
+     */
+    static sf::Vector2f getTileTextureCoords(CellType cell_type, Direction neighborhood, int variant = 0);
 
     static sf::Texture& getTexture(Textures texture_type);
     static sf::Font& getFont();
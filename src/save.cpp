@@ -5,14 +5,25 @@
 // For mkdir
 #include <cstdlib>
 
+#include "entity_journal.hpp"
 #include "game.hpp"
 
 
-bool save_dungeon(const std::vector<Level>& dungeon,
-                  const std::vector<MapExploration>& exploration,
+bool save_dungeon(std::vector<Level>& dungeon,
+                  std::vector<MapExploration>& exploration,
                   const std::vector<std::shared_ptr<Generator>>& generators,
+                  const std::vector<std::shared_ptr<ChunkPager>>& pagers,
                   const std::string& save_path);
 
+/**
+ * \brief Get the size of a file, 0 if it doesn't exist.
+ */
+static std::streamoff file_size(const std::string& path)
+{
+    std::ifstream file {path, std::ios::binary | std::ios::ate};
+    return file ? static_cast<std::streamoff>(file.tellg()) : 0;
+}
+
 bool Game::saveGame()
 {
     std::cout << "Saving game" << std::endl;
@@ -38,7 +49,7 @@ bool Game::saveGame()
 
     save_file.close();
 
-    save_dungeon(dungeon, exploration, generators, save_path);
+    save_dungeon(dungeon, exploration, generators, pagers, save_path);
 
     std::fstream saves {Configuration::user_path + "saves/saves.data"};
     if (!saves)
@@ -58,32 +69,91 @@ bool Game::saveGame()
     return true;
 }
 
-bool save_dungeon(const std::vector<Level>& dungeon,
-                  const std::vector<MapExploration>& exploration,
+bool save_dungeon(std::vector<Level>& dungeon,
+                  std::vector<MapExploration>& exploration,
                   const std::vector<std::shared_ptr<Generator>>& generators,
+                  const std::vector<std::shared_ptr<ChunkPager>>& pagers,
                   const std::string& save_path)
 {
     for (uint32_t i_level = 0; i_level < dungeon.size(); ++i_level)
     {
-        const Level& level = dungeon[i_level];
-        level.map.saveToFile(save_path + "levels/map" + std::to_string(i_level) + ".dat");
-
-        exploration[i_level].save(save_path + "levels/exploration" + std::to_string(i_level) + ".dat");
-
-        std::ofstream entities_file {
-            save_path + "levels/entities" + std::to_string(i_level) + ".dat",
-            std::ios::trunc | std::ios::binary
-        };
-        uint32_t n_entities = level.entities.size();
-        entities_file.write(reinterpret_cast<char*>(&n_entities), sizeof(uint32_t));
-        for (const auto& entity : level.entities)
-            entities_file << entity;
+        Level& level = dungeon[i_level];
+        const std::string level_path {save_path + "levels/"};
+        const std::string map_path {level_path + "map" + std::to_string(i_level) + ".dat"};
+        const std::string exploration_path {level_path + "exploration" + std::to_string(i_level) + ".dat"};
+        const std::string entities_path {level_path + "entities" + std::to_string(i_level) + ".dat"};
+
+        // Changes are appended to journals, which are merged in the level once they get bigger than it
+        bool map_snapshot = !level.saved || file_size(map_path + ".journal") > file_size(map_path);
+        bool entities_snapshot = !level.saved || file_size(entities_path + ".journal") > file_size(entities_path);
+
+        // Whole files must include the paged chunks, otherwise only the ones which changed are needed
+        ChunkPager& pager = *pagers[i_level];
+        if (map_snapshot || entities_snapshot)
+            pager.pageInAll(level.map, level.entities);
+        else
+        {
+            pager.pageInDirty(level.map, level.entities);
+
+            // The entities of a chunk are saved together
+            for (size_t i = 0 ; i < level.dirty_entities.size() ; i++)
+            {
+                auto chunk = level.dirty_entities.idAt(i);
+                if (pager.contains(chunk.first, chunk.second))
+                    pager.pageIn(chunk.first, chunk.second, level.map, level.entities);
+            }
+        }
+
+        if (map_snapshot)
+        {
+            level.map.saveToFile(map_path);
+            std::ofstream {map_path + ".journal", std::ios::trunc};
+        }
+        else if (level.map.isModified())
+            level.map.saveChangesToFile(map_path + ".journal");
+
+        level.map.markClean();
+
+        if (!level.saved || file_size(exploration_path + ".journal") > file_size(exploration_path))
+        {
+            exploration[i_level].save(exploration_path);
+            std::ofstream {exploration_path + ".journal", std::ios::trunc};
+        }
+        else if (exploration[i_level].isModified())
+            exploration[i_level].saveChanges(exploration_path + ".journal");
+
+        exploration[i_level].markClean();
+
+        // The entities kept aside for the chunks added in advance are saved with the level
+        std::vector<std::shared_ptr<Entity>> saved_entities = level.entities;
+        for (size_t i = 0 ; i < level.streamed_entities.size() ; i++)
+        {
+            const auto& streamed = level.streamed_entities.valueAt(i);
+            saved_entities.insert(saved_entities.end(), streamed.begin(), streamed.end());
+        }
+
+        if (entities_snapshot)
+        {
+            std::ofstream entities_file {entities_path, std::ios::trunc | std::ios::binary};
+            uint32_t n_entities = saved_entities.size();
+            entities_file.write(reinterpret_cast<char*>(&n_entities), sizeof(uint32_t));
+            for (const auto& entity : saved_entities)
+                entities_file << entity;
+
+            std::ofstream {entities_path + ".journal", std::ios::trunc};
+        }
+        else if (!level.dirty_entities.empty())
+            save_entities_changes(entities_path + ".journal", saved_entities, level.dirty_entities);
+
+        level.dirty_entities.clear();
 
         std::ofstream generator_file {
-            save_path + "levels/generator" + std::to_string(i_level) + ".dat",
+            level_path + "generator" + std::to_string(i_level) + ".dat",
             std::ios::trunc | std::ios::binary
         };
         generator_file << *generators[i_level];
+
+        level.saved = true;
     }
 
     return true;
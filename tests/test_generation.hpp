@@ -1,12 +1,24 @@
 #include <cxxtest/TestSuite.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <iterator>
 #include <map>
 #include <random>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "../src/generation/chunk_queue.hpp"
+#include "../src/generation/generation_pool.hpp"
 #include "../src/generation/generator.hpp"
+#include "../src/generation/link_index.hpp"
+#include "../src/generation/room.hpp"
+#include "../src/generation/room_grid.hpp"
+#include "../src/generation/room_raster.hpp"
+#include "../src/generation/spsc_queue.hpp"
 
 #include "../src/map.hpp"
 #include "../src/entity.hpp"
@@ -30,6 +42,16 @@ constexpr int MAX_MARGIN = 50;
 constexpr int ROOM_MIN_SIZE = 50;
 constexpr int ROOM_MAX_SIZE = 300;
 
+// Number of rooms on each side of the grid of rooms compared by benchmarks
+constexpr int BENCH_ROOMS = 16;
+
+// Number of rings of chunks generated by benchmarks, and number of rings timed together
+constexpr int BENCH_RINGS = 12;
+constexpr int BENCH_RINGS_STEP = 3;
+
+// Number of values passed between two threads
+constexpr int NB_QUEUE_VALUES = 100000;
+
 
 class GeneratorTester : public CxxTest::TestSuite
 {
@@ -48,7 +70,7 @@ public:
             gen_options.room_max_size = ROOM_MAX_SIZE;
             gen_options.nb_rooms = Rand::uniform_int(MIN_ROOMS, MAX_ROOMS);
             gen_options.room_margin = Rand::uniform_int(MIN_MARGIN, MAX_MARGIN);
-            gen_options.type = static_cast<LevelType>(Rand::uniform_int(0, 1));
+            gen_options.type = static_cast<LevelType>(Rand::uniform_int(0, 2));
             gen_options.monster_load = 3.f;
             gen_options.maze_density = 0.1f;
             gen_options.infinite = false;
@@ -58,11 +80,10 @@ public:
             TS_TRACE("type : " + std::to_string(static_cast<int>(gen_options.type)));
 
             std::random_device r;
-            int seed = r();
-            RandGen::seed(seed);
+            uint64_t seed = r();
             TS_TRACE("Seed : " + std::to_string(seed));
 
-            Generator generator(gen_options);
+            Generator generator(gen_options, seed);
             Map map;
             std::vector<std::shared_ptr<Entity>> entities;
 
@@ -71,9 +92,9 @@ public:
             {
                 for (int y = 0 ; y < NB_CHUNK ; y++)
                 {
-                    map.setChunk(x, y, generator.getChunkCells(x, y));
+                    map.setChunk(x, y, generator.takeChunkCells(x, y));
 
-                    auto new_entities = generator.getChunkEntities(x, y);
+                    auto new_entities = generator.takeChunkEntities(x, y);
                     entities.insert(end(entities), begin(new_entities), end(new_entities));
                 }
             }
@@ -96,4 +117,709 @@ public:
             }
         }
     }
+
+    /* Test that chunks are given once, and leave the cache of the generator
+     */
+    void testTakeChunk()
+    {
+        GenerationMode gen_options = generationMode(MAX_ROOMS, MAX_MARGIN, LevelType::Flat, false);
+
+        Generator generator(gen_options);
+
+        // The first room is centered on the chunk (0, 0), which holds the entrance
+        Map map;
+        const Map& const_map = map;
+        map.setChunk(0, 0, generator.takeChunkCells(0, 0));
+        auto entities = generator.takeChunkEntities(0, 0);
+
+        TS_ASSERT(!entities.empty());
+        for (auto& entity : entities)
+            TS_ASSERT_EQUALS(const_map.cellAt(entity->getPosition()), CellType::Floor);
+
+        // Nothing is left in the generator
+        Chunk again = generator.takeChunkCells(0, 0);
+        for (int x = 0 ; x < Chunk::SIZE ; x++)
+            for (int y = 0 ; y < Chunk::SIZE ; y++)
+                TS_ASSERT_EQUALS(again.cellAt(x, y), CellType::Empty);
+
+        TS_ASSERT(generator.takeChunkEntities(0, 0).empty());
+
+        for (auto chunk_id : generator.getCachedChunks())
+            TS_ASSERT(chunk_id != std::make_pair(0, 0));
+    }
+
+    /* Test that a finite level is generated in the background once requested, with a progress growing to 1.
+     */
+    void testFiniteProgress()
+    {
+        GenerationMode gen_options = generationMode(100, 4, LevelType::Cave, false);
+
+        Generator generator(gen_options, 5);
+        TS_ASSERT_EQUALS(generator.getProgress(), 0.f);
+        TS_ASSERT(!generator.isReady(0, 0));
+
+        generator.preGenerateRadius(0, 0, 0);
+
+        float last = 0.f;
+        while (!generator.isReady(0, 0))
+        {
+            float progress = generator.getProgress();
+            TS_ASSERT(progress >= last && progress < 1.f);
+            last = progress;
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        TS_ASSERT_EQUALS(generator.getProgress(), 1.f);
+        TS_ASSERT(!generator.takeChunkEntities(0, 0).empty());
+    }
+
+    /* Test that a level generated in the background and parked gives the same entrance as when it is waited for.
+     */
+    void testSpeculativeGeneration()
+    {
+        GenerationMode gen_options;
+        gen_options.room_min_size = ROOM_MIN_SIZE;
+        gen_options.room_max_size = ROOM_MAX_SIZE;
+        gen_options.room_margin = 4;
+        gen_options.type = LevelType::Cave;
+        gen_options.monster_load = 3.f;
+        gen_options.maze_density = 0.1f;
+        gen_options.infinite = true;
+
+        Generator speculative(gen_options, 11);
+        speculative.setForeground(false);
+        speculative.preGenerateRadius(0, 0, 2);
+
+        while (!speculative.isReady(0, 0))
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        // Parking keeps the chunks generated so far
+        speculative.cancelOutside(0, 0, 0);
+        TS_ASSERT(speculative.isReady(0, 0));
+
+        Generator waited(gen_options, 11);
+        Chunk expected = waited.takeChunkCells(0, 0);
+        Chunk chunk = speculative.takeChunkCells(0, 0);
+
+        for (int x = 0 ; x < Chunk::SIZE ; x++)
+            for (int y = 0 ; y < Chunk::SIZE ; y++)
+                TS_ASSERT_EQUALS(chunk.cellAt(x, y), expected.cellAt(x, y));
+
+        TS_ASSERT_EQUALS(speculative.takeChunkEntities(0, 0).size(), waited.takeChunkEntities(0, 0).size());
+    }
+
+    /* Test that the queue of chunks to generate gives chunks by priority, once each.
+     */
+    void testChunkQueue()
+    {
+        ChunkQueue queue;
+
+        for (int x = -5 ; x <= 5 ; x++)
+            for (int y = -5 ; y <= 5 ; y++)
+                TS_ASSERT(queue.push(x, y, x * x + y * y));
+
+        // Pushing again only lowers the priority
+        TS_ASSERT(!queue.push(0, 0, 100));
+        TS_ASSERT(!queue.push(5, 5, -1));
+        TS_ASSERT_EQUALS(queue.size(), 121u);
+        TS_ASSERT_EQUALS(queue.getStats().duplicates, 2u);
+        TS_ASSERT_EQUALS(queue.pop(), std::make_pair(5, 5));
+        TS_ASSERT_EQUALS(queue.pop(), std::make_pair(0, 0));
+
+        // Move the center to (4, 4) and forget chunks on the other side
+        queue.rekey([](int x, int y, int64_t) { return (x - 4) * (x - 4) + (y - 4) * (y - 4); });
+        TS_ASSERT_EQUALS(queue.cancel([](int x, int y, int64_t) { return x < 0 || y < 0; }), 119u - 34u);
+        TS_ASSERT(!queue.contains(-1, 3));
+        TS_ASSERT_EQUALS(queue.getStats().length, 34u);
+
+        int64_t last = -1;
+        while (!queue.empty())
+        {
+            auto chunk = queue.pop();
+            int64_t priority = (chunk.first - 4) * (chunk.first - 4) + (chunk.second - 4) * (chunk.second - 4);
+
+            TS_ASSERT(priority >= last);
+            TS_ASSERT(!queue.contains(chunk.first, chunk.second));
+            last = priority;
+        }
+    }
+
+    /* Test that values pushed by a thread are popped by another one in order, once each.
+     */
+    void testSpscQueue()
+    {
+        SpscQueue<std::vector<int>> queue;
+        TS_ASSERT(queue.empty());
+
+        std::thread producer([&queue] {
+            for (int i = 0 ; i < NB_QUEUE_VALUES ; i++)
+                queue.push({i, -i});
+        });
+
+        int next = 0;
+        std::vector<int> value;
+        while (next < NB_QUEUE_VALUES)
+        {
+            if (!queue.pop(value))
+                continue;
+
+            if (value != std::vector<int>{next, -next})
+                break;
+
+            next++;
+        }
+
+        producer.join();
+        TS_ASSERT_EQUALS(next, NB_QUEUE_VALUES);
+        TS_ASSERT(!queue.pop(value));
+
+        // Values left in the queue are destroyed with it
+        queue.push({1});
+    }
+
+    /* Test that every jobs given to a pool are run once, including jobs submitted by other jobs.
+     */
+    void testGenerationPool()
+    {
+        std::atomic<int> runs {0};
+
+        {
+            GenerationPool pool {3};
+
+            for (int i = 0 ; i < 100 ; i++)
+            {
+                pool.submit([&pool, &runs] {
+                    runs++;
+                    pool.submit([&runs] { runs++; }, true);
+                });
+            }
+
+            // The pool runs the remaining jobs before stopping
+        }
+
+        TS_ASSERT_EQUALS(runs.load(), 200);
+    }
+
+    /* Test that a thread with no job steals the jobs with priority of another thread first.
+     */
+    void testPoolStealsPriority()
+    {
+        std::atomic<bool> busy {false};
+        std::atomic<bool> released {false};
+        std::atomic<int> first {0};
+
+        GenerationPool pool {2};
+
+        // Each thread is given one of these jobs, the second one waits until the first one gave it jobs
+        pool.submit([&] {
+            while (!busy)
+                std::this_thread::yield();
+
+            pool.submit([&first] { int none = 0; first.compare_exchange_strong(none, 1); });
+            pool.submit([&first] { int none = 0; first.compare_exchange_strong(none, 2); }, true);
+            released = true;
+
+            // The other thread steals a job while this one is busy
+            while (first == 0)
+                std::this_thread::yield();
+        });
+        pool.submit([&] {
+            busy = true;
+            while (!released)
+                std::this_thread::yield();
+        });
+
+        while (first == 0)
+            std::this_thread::yield();
+
+        TS_ASSERT_EQUALS(first.load(), 2);
+    }
+
+    /* Test that a save only holds the filled chunks, and that the rooms are added again after loading it.
+     */
+    void testReplaySave()
+    {
+        GenerationMode gen_options = generationMode(1, MAX_MARGIN, LevelType::Flat, true);
+
+        // Fill the chunks around (0, 0) and lock the chunk (0, 0)
+        const size_t side = 3 + 2 * Chunk::chunk_span(GEN_BORDER);
+        Generator generator(gen_options, 77);
+        generator.generateRadius(0, 0, 1);
+        TS_ASSERT(generator.isReady(1, -1));
+        TS_ASSERT(!generator.isReady(1000, 1000));
+        generator.takeChunkCells(0, 0);
+        generator.takeChunkEntities(0, 0);
+
+        std::stringstream save;
+        save << generator;
+        TS_ASSERT_EQUALS(save.str().size(), 3 * sizeof(uint32_t) + sizeof(uint64_t) + (1 + side * side) * 2 * sizeof(int32_t));
+
+        Generator loaded(gen_options);
+        save >> loaded;
+
+        // Wait for the rooms to be added again
+        loaded.generateRadius(0, 0, 1);
+
+        for (int x = -1 ; x <= 1 ; x++)
+        {
+            for (int y = -1 ; y <= 1 ; y++)
+            {
+                if (x == 0 && y == 0)
+                    continue;
+
+                const Chunk saved_cells = generator.takeChunkCells(x, y);
+                const Chunk loaded_cells = loaded.takeChunkCells(x, y);
+                TS_ASSERT(std::equal(saved_cells.rowAt(0), saved_cells.rowAt(0) + Chunk::SIZE * Chunk::SIZE,
+                                     loaded_cells.rowAt(0)));
+
+                assertSameEntities(generator.takeChunkEntities(x, y), loaded.takeChunkEntities(x, y));
+            }
+        }
+
+        // Locked chunks stay empty
+        TS_ASSERT(loaded.takeChunkEntities(0, 0).empty());
+    }
+
+    /* Test that a save of a long history holds the rooms, so that a load doesn't need to add them again.
+     */
+    void testLongHistorySave()
+    {
+        GenerationMode gen_options = generationMode(1, MAX_MARGIN, LevelType::Flat, true);
+
+        // Fill more chunks than a save can replay
+        const int radius = 8;
+        const size_t side = 2 * radius + 1 + 2 * Chunk::chunk_span(GEN_BORDER);
+        TS_ASSERT_LESS_THAN(MAX_REPLAY_FILLS, side * side);
+
+        Generator generator(gen_options, 78);
+        generator.generateRadius(0, 0, radius);
+        generator.takeChunkCells(0, 0);
+        generator.takeChunkEntities(0, 0);
+
+        std::stringstream save;
+        save << generator;
+
+        Generator loaded(gen_options);
+        save >> loaded;
+
+        // The filled chunks are ready without adding their rooms again
+        TS_ASSERT(loaded.isReady(radius, -radius));
+
+        for (int x = radius - 1 ; x <= radius ; x++)
+        {
+            const Chunk saved_cells = generator.takeChunkCells(x, -radius);
+            const Chunk loaded_cells = loaded.takeChunkCells(x, -radius);
+            TS_ASSERT(std::equal(saved_cells.rowAt(0), saved_cells.rowAt(0) + Chunk::SIZE * Chunk::SIZE,
+                                 loaded_cells.rowAt(0)));
+
+            assertSameEntities(generator.takeChunkEntities(x, -radius), loaded.takeChunkEntities(x, -radius));
+        }
+    }
+
+    /* Test that rooms are connected in sets, and found from rooms close to them.
+     */
+    void testLinkIndex()
+    {
+        LinkIndex index;
+
+        // A row of rooms of 10x10 cells, spaced by 20 cells
+        for (int i = 0 ; i < 20 ; i++)
+            TS_ASSERT_EQUALS(index.add({30 * i, 0}, {30 * i + 9, 9}), static_cast<size_t>(i));
+
+        // Rooms up to 51 cells away from the room 10
+        std::vector<size_t> near;
+        index.forEachNear(10, 51, [&near](size_t room) { near.push_back(room); });
+        std::sort(begin(near), end(near));
+        TS_ASSERT_EQUALS(near, (std::vector<size_t>{8, 9, 11, 12}));
+
+        TS_ASSERT(index.merge(0, 1));
+        TS_ASSERT(index.merge(2, 1));
+        TS_ASSERT(!index.merge(0, 2));
+        TS_ASSERT_EQUALS(index.find(0), index.find(2));
+        TS_ASSERT_DIFFERS(index.find(0), index.find(3));
+        TS_ASSERT_EQUALS(index.setSize(2), 3u);
+        TS_ASSERT_EQUALS(index.setSize(3), 1u);
+
+        // Negative coordinates
+        size_t left = index.add({-100, -100}, {-90, -90});
+        near.clear();
+        index.forEachNear(left, 100, [&near](size_t room) { near.push_back(room); });
+        TS_ASSERT_EQUALS(near, (std::vector<size_t>{0}));
+
+        index.clear();
+        TS_ASSERT_EQUALS(index.size(), 0u);
+    }
+
+    void testRoomGrid()
+    {
+        RoomGrid grid;
+
+        // A row of rooms of 10x10 cells, spaced by 20 cells
+        for (int i = 0 ; i < 20 ; i++)
+            TS_ASSERT_EQUALS(grid.add({30 * i, 0}, {30 * i + 9, 9}), static_cast<size_t>(i));
+
+        std::vector<size_t> near;
+        grid.near({300, 0}, {309, 9}, 21, near);
+        TS_ASSERT_EQUALS(near, (std::vector<size_t>{9, 10, 11}));
+
+        grid.near({300, 0}, {309, 9}, 20, near);
+        TS_ASSERT_EQUALS(near, (std::vector<size_t>{10}));
+
+        // Boxes overlapping several cells of the grid are found once
+        grid.near({-1000, -5}, {1000, 5}, 0, near);
+        TS_ASSERT_EQUALS(near.size(), 20u);
+
+        // Negative coordinates
+        TS_ASSERT_EQUALS(grid.add({-100, -100}, {-90, -90}), 20u);
+        grid.near({-89, -70}, {-50, -50}, 20, near);
+        TS_ASSERT_EQUALS(near, (std::vector<size_t>{20}));
+
+        grid.clear();
+        TS_ASSERT_EQUALS(grid.size(), 0u);
+        grid.near({-1000, -1000}, {1000, 1000}, 0, near);
+        TS_ASSERT(near.empty());
+    }
+
+    void testSeparateRooms()
+    {
+        constexpr int spacing = 3;
+        std::vector<Room> rooms;
+
+        // Rooms which can't move, in a row
+        for (int i = 0 ; i < 10 ; i++)
+        {
+            rooms.emplace_back(generate_rectangle(5, 5));
+            rooms.back().setPosition({20 * i, 0});
+        }
+
+        // Rooms stacked on top of the fixed ones
+        for (int i = 0 ; i < 10 ; i++)
+        {
+            rooms.emplace_back(generate_rectangle(3, 4));
+            rooms.back().setPosition({20 * i + 1, 1});
+        }
+
+        RandGen::seed(0);
+        separate_rooms(rooms, spacing, 10, rooms.size());
+
+        for (int i = 0 ; i < 10 ; i++)
+            TS_ASSERT_EQUALS(rooms[i].getPosition(), Point(20 * i, 0));
+
+        for (size_t i = 10 ; i < rooms.size() ; i++)
+            for (size_t j = 0 ; j < i ; j++)
+                TS_ASSERT(spaced(rooms[i], rooms[j], spacing));
+    }
+
+    /*
+     * Compare the cells of a room split by chunk with its pattern and its surrounding.
+     */
+    void testRasteriseRoom()
+    {
+        Point position(-37, 22);
+        Room room(generate_cave(300));
+        room.setPosition(position);
+        room.addEntity(std::make_shared<Entity>(EntityType::Stairs, Interaction::GoDown, sf::Vector2i(1, 0)));
+
+        ChunkTable<ChunkRaster> raster;
+        rasterise_room(room, raster);
+
+        Pattern floors, walls;
+        size_t nb_entities = 0;
+
+        for (size_t i_chunk = 0 ; i_chunk < raster.size() ; i_chunk++)
+        {
+            auto chunk_id = raster.idAt(i_chunk);
+            const ChunkRaster& part = raster.valueAt(i_chunk);
+
+            for (int x = 0 ; x < Chunk::SIZE ; x++)
+            {
+                for (int y = 0 ; y < Chunk::SIZE ; y++)
+                {
+                    Point cell(chunk_id.first * Chunk::SIZE + x, chunk_id.second * Chunk::SIZE + y);
+
+                    if (BitChunk<Chunk::SIZE>::test(part.floors, x, y))
+                        floors.insert(cell - position);
+                    if (BitChunk<Chunk::SIZE>::test(part.walls, x, y))
+                        walls.insert(cell - position);
+                }
+            }
+
+            for (const auto& entity : part.entities)
+            {
+                auto cell = entity->getPosition();
+                TS_ASSERT_EQUALS(Chunk::sector(cell.x, cell.y), chunk_id);
+                TS_ASSERT_EQUALS(Point(cell.x, cell.y), position + Point(1, 0));
+                nb_entities++;
+            }
+        }
+
+        TS_ASSERT_EQUALS(floors, room.getCells());
+        TS_ASSERT_EQUALS(walls, surrounding(room.getCells()));
+        TS_ASSERT_EQUALS(nb_entities, 1u);
+
+        // Entities of the room are not moved
+        TS_ASSERT_EQUALS(room.getEntities()[0]->getPosition(), sf::Vector2i(1, 0));
+    }
+
+    /* Test that rooms spaced further than the distance at which rooms are linked are connected.
+     */
+    void testFarRoomsLinked()
+    {
+        GenerationMode gen_options = generationMode(MAX_ROOMS, 300, LevelType::Flat, false);
+        Generator generator(gen_options, 3);
+
+        Map map;
+        map.setChunk(0, 0, generator.takeChunkCells(0, 0));
+        for (auto chunk_id : generator.getCachedChunks())
+            map.setChunk(chunk_id.first, chunk_id.second, generator.takeChunkCells(chunk_id.first, chunk_id.second));
+
+        const Map& const_map = map;
+        Pattern floors;
+
+        for (auto chunk_id : map.getChunks())
+            for (int x = chunk_id.first * Chunk::SIZE ; x < (chunk_id.first + 1) * Chunk::SIZE ; x++)
+                for (int y = chunk_id.second * Chunk::SIZE ; y < (chunk_id.second + 1) * Chunk::SIZE ; y++)
+                    if (const_map.cellAt(x, y) == CellType::Floor)
+                        floors.insert({x, y});
+
+        // Every floor can be reached from any other one
+        TS_ASSERT(!floors.empty());
+        Pattern reached = {*floors.begin()};
+        std::vector<Point> stack = {*floors.begin()};
+
+        while (!stack.empty())
+        {
+            Point cell = stack.back();
+            stack.pop_back();
+
+            for (Point dir : {Point(1, 0), Point(-1, 0), Point(0, 1), Point(0, -1)})
+                if (floors.contains(cell + dir) && reached.insert(cell + dir))
+                    stack.push_back(cell + dir);
+        }
+
+        TS_ASSERT_EQUALS(reached.size(), floors.size());
+    }
+
+    /* Time the generation of rings of chunks further and further from the center, the time
+     * needed for each chunk must not grow with the number of rooms already generated.
+     */
+    void testBenchGeneration()
+    {
+        using Clock = std::chrono::steady_clock;
+        using std::chrono::duration_cast;
+        using std::chrono::microseconds;
+
+        GenerationMode gen_options = generationMode(1, 10, LevelType::Flat, true);
+
+        Generator generator(gen_options, 1);
+
+        for (int ring = 0 ; ring < BENCH_RINGS ; ring += BENCH_RINGS_STEP)
+        {
+            auto start = Clock::now();
+            generator.generateRadius(0, 0, ring + BENCH_RINGS_STEP - 1);
+            auto time = Clock::now() - start;
+
+            // Chunks of the rings, with the border generated around them
+            int border = Chunk::chunk_span(GEN_BORDER);
+            long outer = 2 * (ring + BENCH_RINGS_STEP + border) - 1;
+            long inner = ring == 0 ? 0 : 2 * (ring + border) - 1;
+            long chunks = outer * outer - inner * inner;
+
+            TS_TRACE("Rings " + std::to_string(ring) + " to " + std::to_string(ring + BENCH_RINGS_STEP - 1) + ": " +
+                     std::to_string(duration_cast<microseconds>(time).count() / chunks) + "us per chunk");
+        }
+    }
+
+    /* Time the chunks taken while the generation adds rooms further, taking a chunk which is ready must
+     * not wait for the generation.
+     */
+    void testBenchTakeChunk()
+    {
+        using Clock = std::chrono::steady_clock;
+        using std::chrono::duration_cast;
+        using std::chrono::microseconds;
+
+        GenerationMode gen_options = generationMode(1, 10, LevelType::Cave, true);
+
+        Generator generator(gen_options, 1);
+        generator.generateRadius(0, 0, BENCH_RINGS_STEP);
+
+        // Keep the generation busy while the chunks are taken
+        generator.preGenerateRadius(0, 0, BENCH_RINGS);
+
+        Clock::duration total {0};
+        Clock::duration longest {0};
+        int taken = 0;
+
+        for (int x = -BENCH_RINGS_STEP ; x <= BENCH_RINGS_STEP ; x++)
+        {
+            for (int y = -BENCH_RINGS_STEP ; y <= BENCH_RINGS_STEP ; y++)
+            {
+                auto start = Clock::now();
+                generator.takeChunkCells(x, y);
+                generator.takeChunkEntities(x, y);
+                auto time = Clock::now() - start;
+
+                total += time;
+                longest = std::max(longest, time);
+                taken++;
+            }
+        }
+
+        TS_TRACE("Taking a chunk: " + std::to_string(duration_cast<microseconds>(total).count() / taken) + "us on average, " +
+                 std::to_string(duration_cast<microseconds>(longest).count()) + "us at most");
+    }
+
+    /* Compare closest_nodes, searching sorted nodes, against comparing every pairs of nodes.
+     */
+    void testBenchClosestNodes()
+    {
+        using Clock = std::chrono::steady_clock;
+        using std::chrono::duration_cast;
+        using std::chrono::microseconds;
+
+        RandGen::seed(CounterEngine::key(0, 0, 0, 0));
+
+        // Caves on a grid, spaced like rooms of a level
+        std::vector<Room> caves;
+        for (int x = 0 ; x < BENCH_ROOMS ; x++)
+        {
+            for (int y = 0 ; y < BENCH_ROOMS ; y++)
+            {
+                caves.emplace_back(generate_cave(ROOM_MAX_SIZE));
+                caves.back().setPosition({x * 40 + RandGen::uniform_int(-5, 5), y * 40 + RandGen::uniform_int(-5, 5)});
+            }
+        }
+
+        // Rooms are only linked to the rooms close to them
+        std::vector<std::pair<size_t, size_t>> pairs;
+        for (size_t i = 0 ; i < caves.size() ; i++)
+            for (size_t j = 0 ; j < caves.size() ; j++)
+                if (distance(caves[i].getPosition(), caves[j].getPosition()) <= 120)
+                    pairs.push_back({i, j});
+
+        long sum_sorted = 0;
+        long sum_pairs = 0;
+
+        auto start = Clock::now();
+        for (const auto& pair : pairs)
+            sum_sorted += ntn_dist(caves[pair.first], caves[pair.second]);
+        auto time_sorted = Clock::now() - start;
+
+        // Nodes of each room in the map
+        std::vector<std::vector<Point>> nodes;
+        for (const Room& room : caves)
+        {
+            nodes.emplace_back();
+            for (const Point& node : room.getNodes())
+                nodes.back().push_back(node + room.getPosition());
+        }
+
+        start = Clock::now();
+        for (const auto& pair : pairs)
+        {
+            int best = std::numeric_limits<int>::max();
+            for (const Point& node1 : nodes[pair.first])
+                for (const Point& node2 : nodes[pair.second])
+                    best = std::min(best, distance(node1, node2));
+            sum_pairs += best;
+        }
+        auto time_pairs = Clock::now() - start;
+
+        TS_ASSERT_EQUALS(sum_sorted, sum_pairs);
+
+        TS_TRACE("closest_nodes with sorted nodes: " + std::to_string(duration_cast<microseconds>(time_sorted).count()) + "us");
+        TS_TRACE("closest_nodes with every pairs: " + std::to_string(duration_cast<microseconds>(time_pairs).count()) + "us");
+    }
+
+    /* Test that the random streams of generation only depend on their key.
+     */
+    void testCounterEngine()
+    {
+        CounterEngine a {CounterEngine::key(42, 3, -7, 0)};
+        CounterEngine b {CounterEngine::key(42, 3, -7, 0)};
+        CounterEngine other_chunk {CounterEngine::key(42, -7, 3, 0)};
+        CounterEngine other_purpose {CounterEngine::key(42, 3, -7, 1)};
+
+        int same_chunk = 0, same_purpose = 0;
+        for (int i = 0 ; i < 100 ; i++)
+        {
+            CounterEngine::result_type value = a();
+            TS_ASSERT_EQUALS(value, b());
+            same_chunk += value == other_chunk() ? 1 : 0;
+            same_purpose += value == other_purpose() ? 1 : 0;
+        }
+
+        TS_ASSERT(same_chunk < 2);
+        TS_ASSERT(same_purpose < 2);
+
+        // Numbers can be skipped
+        CounterEngine c {CounterEngine::key(42, 3, -7, 0)};
+        c.discard(99);
+        b.seed(CounterEngine::key(42, 3, -7, 0));
+        b.discard(98);
+        b();
+        TS_ASSERT_EQUALS(b(), c());
+    }
+
+    /* Test that two generators with the same seed give the same map and the same entities.
+     */
+    void testSameSeed()
+    {
+        GenerationMode gen_options = generationMode(MAX_ROOMS, MAX_MARGIN, LevelType::Flat, false);
+
+        Generator first(gen_options, 1234);
+        Generator second(gen_options, 1234);
+
+        for (int x = 0 ; x < NB_CHUNK ; x++)
+        {
+            for (int y = 0 ; y < NB_CHUNK ; y++)
+            {
+                const Chunk first_cells = first.takeChunkCells(x, y);
+                const Chunk second_cells = second.takeChunkCells(x, y);
+                TS_ASSERT(std::equal(first_cells.rowAt(0), first_cells.rowAt(0) + Chunk::SIZE * Chunk::SIZE,
+                                     second_cells.rowAt(0)));
+                assertSameEntities(first.takeChunkEntities(x, y), second.takeChunkEntities(x, y));
+            }
+        }
+    }
+
+private:
+    /* Options of the generation shared by the tests, with the density and the spacement of the rooms, their design
+     * and the finiteness of the map that differ from a test to another.
+     */
+    static GenerationMode generationMode(int nb_rooms, int room_margin, LevelType type, bool infinite)
+    {
+        GenerationMode gen_options;
+        gen_options.room_min_size = ROOM_MIN_SIZE;
+        gen_options.room_max_size = ROOM_MAX_SIZE;
+        gen_options.nb_rooms = nb_rooms;
+        gen_options.room_margin = room_margin;
+        gen_options.type = type;
+        gen_options.monster_load = 3.f;
+        gen_options.maze_density = 0.1f;
+        gen_options.infinite = infinite;
+
+        return gen_options;
+    }
+
+    /* Check that two lists of entities hold the same entities, of the same class for the characters, in the same order.
+     */
+    static void assertSameEntities(const std::vector<std::shared_ptr<Entity>>& expected,
+                                   const std::vector<std::shared_ptr<Entity>>& entities)
+    {
+        TS_ASSERT_EQUALS(expected.size(), entities.size());
+        for (size_t i = 0 ; i < std::min(expected.size(), entities.size()) ; i++)
+        {
+            TS_ASSERT_EQUALS(expected[i]->getType(), entities[i]->getType());
+            TS_ASSERT_EQUALS(expected[i]->getPosition(), entities[i]->getPosition());
+
+            auto expected_character = std::dynamic_pointer_cast<Character>(expected[i]);
+            auto character = std::dynamic_pointer_cast<Character>(entities[i]);
+            TS_ASSERT_EQUALS(expected_character == nullptr, character == nullptr);
+            if (expected_character && character)
+                TS_ASSERT_EQUALS(expected_character->getClass(), character->getClass());
+        }
+    }
 };
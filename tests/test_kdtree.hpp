@@ -1,5 +1,8 @@
+#include <chrono>
 #include <set>
 #include <limits>
+#include <string>
+#include <vector>
 
 #include "../src/rand.hpp"
 #include "../src/generation/space.hpp"
@@ -15,6 +18,44 @@ constexpr int NB_SETS = 100;
 // Size of the random set for the test
 constexpr int SIZE_SET = 1000;
 
+// Number of points of each array searched in a set by batch tests
+constexpr int SIZE_BATCH = 20;
+
+// Number of queries made by benchmarks
+constexpr int NB_BENCH_QUERIES = 200000;
+
+
+/**
+ * \brief  Check if one point of an array, moved by offset, is close to a point of a set, comparing every pairs.
+ */
+static bool brute_close_to(const std::set<Point>& set, const std::vector<Point>& points, Point offset, int space)
+{
+    for (const Point& point : points)
+        for (const Point& other : set)
+            if (distance(Point(point.first + offset.first, point.second + offset.second), other) <= space)
+                return true;
+
+    return false;
+}
+
+/**
+ * \brief  Generate a random set of points.
+ */
+static std::set<Point> random_set(int size)
+{
+    std::set<Point> set;
+
+    for (int i_point = 0 ; i_point < size ; i_point++)
+    {
+        set.insert(Point(
+            Rand::uniform_int(MIN_VAL, MAX_VAL),
+            Rand::uniform_int(MIN_VAL, MAX_VAL)
+        ));
+    }
+
+    return set;
+}
+
 
 class KDTreeTester : public CxxTest::TestSuite
 {
@@ -95,4 +136,81 @@ public:
         TS_ASSERT( tree.closeTo(Point(3, -3), 5) );
         TS_ASSERT( !tree.closeTo(Point(3, -3), 4) );
     }
+
+    /*
+     * Compare queries of arrays of points with brute force.
+     */
+    void testBatch()
+    {
+        for (int i_test = 0 ; i_test < NB_SETS ; i_test++)
+        {
+            std::set<Point> set = random_set(SIZE_SET / 10);
+            KDTree tree(set);
+
+            std::set<Point> batch_set = random_set(SIZE_BATCH);
+            std::vector<Point> batch(begin(batch_set), end(batch_set));
+
+            Point offset(Rand::uniform_int(MIN_VAL, MAX_VAL), Rand::uniform_int(MIN_VAL, MAX_VAL));
+            int space = Rand::uniform_int(0, 10);
+
+            TS_ASSERT_EQUALS(tree.closeTo(batch, offset, space), brute_close_to(set, batch, offset, space));
+        }
+    }
+
+    /*
+     * Test empty trees, and copies of trees.
+     */
+    void testEmpty()
+    {
+        KDTree empty;
+        TS_ASSERT_EQUALS(empty.size(), 0u);
+        TS_ASSERT( !empty.closeTo(Point(0, 0), std::numeric_limits<int>::max()) );
+        TS_ASSERT( !empty.closeTo(std::vector<Point>{Point(0, 0)}, Point(0, 0), 100) );
+
+        KDTree tree(std::set<Point>{Point(0, 0), Point(5, 5)});
+        KDTree copy = tree;
+        TS_ASSERT( copy.closeTo(Point(5, 6), 1) );
+        TS_ASSERT_EQUALS(copy.size(), 2u);
+
+        // Assigning an empty tree removes every points
+        copy = empty;
+        TS_ASSERT( !copy.closeTo(Point(5, 6), 1) );
+        TS_ASSERT( tree.closeTo(Point(5, 6), 1) );
+    }
+
+    /*
+     * Compare the time needed by queries of random points against brute force.
+     */
+    void testBenchCloseTo()
+    {
+        using Clock = std::chrono::steady_clock;
+        using std::chrono::duration_cast;
+        using std::chrono::microseconds;
+
+        std::set<Point> set = random_set(SIZE_SET / 4);
+        std::vector<Point> vec(begin(set), end(set));
+        KDTree tree(set);
+
+        std::vector<Point> queries;
+        for (int i_query = 0 ; i_query < NB_BENCH_QUERIES ; i_query++)
+            queries.emplace_back(Rand::uniform_int(2 * MIN_VAL, 2 * MAX_VAL), Rand::uniform_int(2 * MIN_VAL, 2 * MAX_VAL));
+
+        auto start = Clock::now();
+        int found_tree = 0;
+        for (const Point& query : queries)
+            found_tree += tree.closeTo(query, 3);
+        auto time_tree = Clock::now() - start;
+
+        start = Clock::now();
+        int found_brute = 0;
+        for (const Point& query : queries)
+            found_brute += std::any_of(begin(vec), end(vec), [&query](const Point& point) {
+                return distance(point, query) <= 3;
+            });
+        auto time_brute = Clock::now() - start;
+
+        TS_ASSERT_EQUALS(found_tree, found_brute);
+        TS_TRACE("KDTree::closeTo: " + std::to_string(duration_cast<microseconds>(time_tree).count()) + "us");
+        TS_TRACE("closeTo by brute force: " + std::to_string(duration_cast<microseconds>(time_brute).count()) + "us");
+    }
 };
@@ -1,6 +1,10 @@
 #include <cxxtest/TestSuite.h>
 
+#include <chrono>
+#include <cstdio>
+#include <fstream>
 #include <map>
+#include <sstream>
 #include <string>
 #include <random>
 
@@ -9,10 +13,133 @@
 #include "../src/generation/gen_pattern.hpp"
 #include "../src/generation/space.hpp"
 
+#include "../src/chunk_table.hpp"
+#include "../src/rand.hpp"
 #include "../src/utility.hpp"
 #include "../src/map.hpp"
 
 
+// Number of chunks on each side of the area used by benchmarks
+constexpr int BENCH_CHUNKS = 64;
+
+// Number of times the area is read by benchmarks
+constexpr int BENCH_PASSES = 20;
+
+// Width of the area of cells used to compare sizes of chunks
+constexpr int BENCH_CELLS = 256;
+
+
+/* An arbitrary cell type depending on coordinates.
+ */
+inline CellType cell_type(int x, int y)
+{
+    return static_cast<CellType>((x * 7 + y * 13) % 3 == 0 ? 2 : (x ^ y) & 1);
+}
+
+/* Fill the square [-side, side)² of a map with cells given by cell_type.
+ */
+template <int Size>
+void fill_map(BasicMap<Size>& map, int side)
+{
+    int chunks = BasicChunk<Size>::chunk_span(side);
+
+    for (int x = -chunks ; x < chunks ; x++)
+        for (int y = -chunks ; y < chunks ; y++)
+            map.setChunk(x, y, BasicChunk<Size>());
+
+    for (int x = -side ; x < side ; x++)
+        for (int y = -side ; y < side ; y++)
+            map.setCell(x, y, cell_type(x, y));
+}
+
+/* Check the masks of every chunks of a random map against reading cells one by one.
+ */
+template <int Size>
+void check_masks()
+{
+    BasicMap<Size> map;
+    const BasicMap<Size>& const_map = map;
+
+    // A sparse set of chunks, with random cells
+    for (int x = -2 ; x < 2 ; x++)
+    {
+        for (int y = -2 ; y < 2 ; y++)
+        {
+            if (Rand::uniform_int(0, 3) == 0)
+                continue;
+
+            BasicChunk<Size> chunk;
+            for (int i = 0 ; i < Size ; i++)
+                for (int j = 0 ; j < Size ; j++)
+                    chunk.cellAt(i, j) = static_cast<CellType>(Rand::uniform_int(0, 5) / 2);
+
+            map.setChunk(x, y, chunk);
+        }
+    }
+
+    auto has_next = [&const_map](int x, int y, CellType type)
+    {
+        for (int i = -1 ; i <= 1 ; i++)
+            for (int j = -1 ; j <= 1 ; j++)
+                if (const_map.cellAt(x + i, y + j) == type)
+                    return true;
+
+        return false;
+    };
+
+    for (int x = -3 * Size ; x < 3 * Size ; x++)
+    {
+        for (int y = -3 * Size ; y < 3 * Size ; y++)
+        {
+            auto chunk_id = BasicChunk<Size>::sector(x, y);
+            auto relt_pos = BasicChunk<Size>::relative(x, y);
+            ChunkMasks<Size> masks = const_map.chunkMasks(chunk_id.first, chunk_id.second);
+
+            auto test = [&relt_pos](const typename ChunkMasks<Size>::Plane& plane)
+            {
+                return BitChunk<Size>::test(plane, relt_pos.first, relt_pos.second);
+            };
+
+            TS_ASSERT_EQUALS(test(masks.wall_next), has_next(x, y, CellType::Wall));
+            TS_ASSERT_EQUALS(test(masks.floor_next), has_next(x, y, CellType::Floor));
+
+            for (int i = 0 ; i < 4 ; i++)
+            {
+                sf::Vector2i next = sf::Vector2i(x, y) + to_vector2i(directions[i]);
+
+                TS_ASSERT_EQUALS(test(masks.floor_at[i]), const_map.cellAt(next) == CellType::Floor);
+                TS_ASSERT_EQUALS(test(masks.wall_next_at[i]), has_next(next.x, next.y, CellType::Wall));
+            }
+        }
+    }
+
+    // Masks must follow modifications of cells
+    map.setChunk(0, 0, BasicChunk<Size>());
+    TS_ASSERT_EQUALS(const_map.wallNext(-1, -1), has_next(-1, -1, CellType::Wall));
+    map.setCell(0, 0, CellType::Wall);
+    TS_ASSERT(const_map.wallNext(-1, -1));
+}
+
+/* Time reading every cell of an area with wallNext, using chunks of the given size.
+ */
+template <int Size>
+std::chrono::steady_clock::duration bench_wall_next(long& count)
+{
+    BasicMap<Size> map;
+    fill_map(map, BENCH_CELLS / 2);
+
+    const BasicMap<Size>& const_map = map;
+    auto start = std::chrono::steady_clock::now();
+
+    for (int pass = 0 ; pass < BENCH_PASSES ; pass++)
+        for (int x = -BENCH_CELLS / 2 ; x < BENCH_CELLS / 2 ; x++)
+            for (int y = -BENCH_CELLS / 2 ; y < BENCH_CELLS / 2 ; y++)
+                count += const_map.wallNext(x, y);
+
+    return std::chrono::steady_clock::now() - start;
+}
+
+
 
 class MapTester : public CxxTest::TestSuite
 {
@@ -57,11 +184,474 @@ public:
         TS_ASSERT(map.hasChunk(chunk_pos.first, chunk_pos.second));
         TS_ASSERT(map.hasCell(1337, 42));
 
-        map.cellAt(1337, 42) = CellType::Floor;
+        map.setCell(1337, 42, CellType::Floor);
         TS_ASSERT_EQUALS(map.cellAt(1337, 42), CellType::Floor);
 
 
         auto chunk = map.chunkAt(chunk_pos.first, chunk_pos.second);
         TS_ASSERT_EQUALS(chunk.cellAt(relat_pos.first, relat_pos.second), CellType::Floor);
     }
+
+    /* Check the chunk table against std::map with random insertions and deletions.
+     */
+    void testChunkTable()
+    {
+        ChunkTable<int> table;
+        std::map<std::pair<int, int>, int> reference;
+
+        for (int i = 0 ; i < 20000 ; i++)
+        {
+            int x = Rand::uniform_int(-50, 50);
+            int y = Rand::uniform_int(-50, 50);
+
+            if (Rand::uniform_int(0, 2) == 0)
+            {
+                TS_ASSERT_EQUALS(table.erase(x, y), reference.erase({x, y}) == 1);
+            }
+            else
+            {
+                table.insert(x, y, i);
+                reference[{x, y}] = i;
+            }
+        }
+
+        TS_ASSERT_EQUALS(table.size(), reference.size());
+
+        for (int x = -50 ; x <= 50 ; x++)
+        {
+            for (int y = -50 ; y <= 50 ; y++)
+            {
+                auto it = reference.find({x, y});
+
+                if (it == end(reference))
+                    TS_ASSERT(table.find(x, y) == nullptr);
+                else if (table.find(x, y) == nullptr)
+                    TS_FAIL("Missing chunk in the table");
+                else
+                    TS_ASSERT_EQUALS(*table.find(x, y), it->second);
+            }
+        }
+    }
+
+    /* Compare reading cells with the chunk table against the former std::map storage.
+     */
+    void testBenchCellAt()
+    {
+        using Clock = std::chrono::steady_clock;
+
+        Map map;
+        const Map& const_map = map;
+        std::map<std::pair<int, int>, Chunk> reference;
+
+        // Fill half of the chunks of the area with random cells
+        for (int x = 0 ; x < BENCH_CHUNKS ; x++)
+        {
+            for (int y = 0 ; y < BENCH_CHUNKS ; y++)
+            {
+                if (Rand::uniform_int(0, 1) == 0)
+                    continue;
+
+                Chunk chunk;
+                for (int i = 0 ; i < Chunk::SIZE ; i++)
+                    for (int j = 0 ; j < Chunk::SIZE ; j++)
+                        chunk.cellAt(i, j) = static_cast<CellType>(Rand::uniform_int(0, 2));
+
+                map.setChunk(x, y, chunk);
+                reference[{x, y}] = chunk;
+            }
+        }
+
+        // The former implementation of Map::cellAt
+        auto reference_cell = [&reference](int x, int y) -> CellType
+        {
+            std::pair<int, int> chunk_id = Chunk::sector(x, y);
+
+            if (reference.find(chunk_id) == end(reference))
+                return CellType::Empty;
+
+            std::pair<int, int> relt_pos = Chunk::relative(x, y);
+            return reference.at(chunk_id).cellAt(relt_pos.first, relt_pos.second);
+        };
+
+        int side = BENCH_CHUNKS * Chunk::SIZE;
+        long sum_map = 0;
+        long sum_reference = 0;
+
+        // Read each cell with its neighbours, as Map::wallNext does
+        auto start = Clock::now();
+        for (int pass = 0 ; pass < BENCH_PASSES ; pass++)
+            for (int x = -1 ; x <= side ; x++)
+                for (int y = -1 ; y <= side ; y++)
+                    for (int i = -1 ; i <= 1 ; i++)
+                        for (int j = -1 ; j <= 1 ; j++)
+                            sum_map += static_cast<int>(const_map.cellAt(x + i, y + j));
+        auto time_map = Clock::now() - start;
+
+        start = Clock::now();
+        for (int pass = 0 ; pass < BENCH_PASSES ; pass++)
+            for (int x = -1 ; x <= side ; x++)
+                for (int y = -1 ; y <= side ; y++)
+                    for (int i = -1 ; i <= 1 ; i++)
+                        for (int j = -1 ; j <= 1 ; j++)
+                            sum_reference += static_cast<int>(reference_cell(x + i, y + j));
+        auto time_reference = Clock::now() - start;
+
+        TS_ASSERT_EQUALS(sum_map, sum_reference);
+
+        for (int x = -1 ; x <= side ; x++)
+            for (int y = -1 ; y <= side ; y++)
+                TS_ASSERT_EQUALS(const_map.cellAt(x, y), reference_cell(x, y));
+
+        using std::chrono::duration_cast;
+        using std::chrono::microseconds;
+        TS_TRACE("Map::cellAt: " + std::to_string(duration_cast<microseconds>(time_map).count()) + "us");
+        TS_TRACE("std::map: " + std::to_string(duration_cast<microseconds>(time_reference).count()) + "us");
+    }
+
+    /* Test that sector and relative coordinates match the cell coordinates.
+     */
+    void testSectorRelative()
+    {
+        for (int x = -40 ; x < 40 ; x++)
+        {
+            auto sector = BasicChunk<16>::sector(x, -x);
+            auto relative = BasicChunk<16>::relative(x, -x);
+
+            TS_ASSERT(relative.first >= 0 && relative.first < 16);
+            TS_ASSERT(relative.second >= 0 && relative.second < 16);
+            TS_ASSERT_EQUALS(16 * sector.first + relative.first, x);
+            TS_ASSERT_EQUALS(16 * sector.second + relative.second, -x);
+        }
+
+        TS_ASSERT_EQUALS(BasicChunk<8>::chunk_span(0), 0);
+        TS_ASSERT_EQUALS(BasicChunk<8>::chunk_span(8), 1);
+        TS_ASSERT_EQUALS(BasicChunk<8>::chunk_span(9), 2);
+    }
+
+    /* Test that a saved map can be loaded with another size of chunks.
+     */
+    void testSaveChunkSize()
+    {
+        BasicMap<4> small_map;
+        fill_map(small_map, 20);
+
+        std::stringstream stream;
+        stream << small_map;
+
+        BasicMap<16> big_map;
+        stream >> big_map;
+
+        TS_ASSERT(!stream.fail());
+
+        for (int x = -20 ; x < 20 ; x++)
+            for (int y = -20 ; y < 20 ; y++)
+                TS_ASSERT_EQUALS(static_cast<const BasicMap<16>&>(big_map).cellAt(x, y), cell_type(x, y));
+
+        stream.str("");
+        stream.clear();
+        stream << big_map;
+
+        BasicMap<4> small_copy;
+        stream >> small_copy;
+
+        for (int x = -20 ; x < 20 ; x++)
+            for (int y = -20 ; y < 20 ; y++)
+                TS_ASSERT_EQUALS(static_cast<const BasicMap<4>&>(small_copy).cellAt(x, y), cell_type(x, y));
+    }
+
+    /* Test that the changes appended to a journal give back the map, and only contain dirty chunks.
+     */
+    void testSaveChanges()
+    {
+        const std::string map_path {"test_changes.dat"};
+        const std::string journal_path {"test_changes.journal"};
+
+        Map map;
+        fill_map(map, 40);
+        TS_ASSERT(map.isModified());
+
+        map.saveToFile(map_path);
+        std::ofstream {journal_path, std::ios::trunc};
+        map.markClean();
+        TS_ASSERT(!map.isModified());
+
+        // Reading a cell doesn't make its chunk dirty
+        const Map& const_map = map;
+        TS_ASSERT_EQUALS(const_map.cellAt(3, 3), cell_type(3, 3));
+        TS_ASSERT(!map.isModified());
+
+        map.setCell(3, 3, CellType::Wall);
+        map.setChunk(100, 100, Chunk());
+        TS_ASSERT(map.isDirty(Chunk::sector(3, 3).first, Chunk::sector(3, 3).second));
+        TS_ASSERT(!map.isDirty(-1, -1));
+        TS_ASSERT(map.saveChangesToFile(journal_path));
+        map.markClean();
+
+        map.setCell(-7, 5, CellType::Empty);
+        map.setCell(3, 3, CellType::Floor);
+        TS_ASSERT(map.saveChangesToFile(journal_path));
+
+        // Two headers and two chunks in each of them
+        std::ifstream journal {journal_path, std::ios::binary | std::ios::ate};
+        TS_ASSERT_EQUALS(journal.tellg(), static_cast<std::streamoff>(8 * sizeof(int) + 4 * (2 * sizeof(int) + sizeof(Chunk))));
+
+        Map loaded;
+        TS_ASSERT(loaded.loadFromFile(map_path));
+        TS_ASSERT(loaded.loadChangesFromFile(journal_path));
+        TS_ASSERT(!loaded.isModified());
+        TS_ASSERT(loaded.hasChunk(100, 100));
+
+        const Map& const_loaded = loaded;
+        for (int x = -40 ; x < 40 ; x++)
+            for (int y = -40 ; y < 40 ; y++)
+                TS_ASSERT_EQUALS(const_loaded.cellAt(x, y), const_map.cellAt(x, y));
+
+        std::remove(map_path.c_str());
+        std::remove(journal_path.c_str());
+    }
+
+    /* Test that maps saved before chunks could be resized can still be loaded.
+     */
+    void testLoadLegacyMap()
+    {
+        std::stringstream stream;
+        int count = 2;
+        stream.write(reinterpret_cast<const char*>(&count), sizeof(int));
+
+        // Cells of negative chunks used to be stored with an offset of one cell
+        std::pair<int, int> chunk_ids[] = {{0, 0}, {-1, -1}};
+        for (auto chunk_id : chunk_ids)
+        {
+            std::array<CellType, 16> cells;
+            cells.fill(CellType::Empty);
+            cells[0] = CellType::Wall;
+            stream.write(reinterpret_cast<const char*>(&chunk_id), sizeof(chunk_id));
+            stream.write(reinterpret_cast<const char*>(cells.data()), sizeof(cells));
+        }
+
+        BasicMap<8> map;
+        stream >> map;
+
+        const BasicMap<8>& const_map = map;
+        TS_ASSERT_EQUALS(const_map.cellAt(0, 0), CellType::Wall);
+        TS_ASSERT_EQUALS(const_map.cellAt(-1, -1), CellType::Wall);
+        TS_ASSERT_EQUALS(const_map.cellAt(-4, -4), CellType::Empty);
+        TS_ASSERT(map.hasChunk(-1, -1));
+    }
+
+    /* Test neighbourhood masks of chunks.
+     */
+    void testChunkMasks()
+    {
+        check_masks<4>();
+        check_masks<8>();
+        check_masks<16>();
+        check_masks<32>();
+        check_masks<64>();
+    }
+
+    /* Test that decorations of cells match their neighbourhood, and follow changes of the map.
+     */
+    void testDecoration()
+    {
+        Map map;
+        const Map& const_map = map;
+        fill_map(map, 3 * Chunk::SIZE);
+
+        auto check = [&const_map](int x, int y)
+        {
+            CellDecoration decoration = const_map.decorationAt(x, y);
+            sf::Vector2i coords = {x, y};
+
+            Direction wall_neighborhood = Direction::None;
+            for (Direction dir : directions)
+                if (const_map.cellAt(coords + to_vector2i(dir)) == CellType::Floor)
+                    wall_neighborhood |= dir;
+
+            TS_ASSERT_EQUALS(decoration.wall_neighborhood, wall_neighborhood);
+            TS_ASSERT(decoration.variant <= 5);
+
+            if (const_map.wallNext(coords))
+                TS_ASSERT_EQUALS(decoration.floor_neighborhood,
+                                 Direction::Down | Direction::Up | Direction::Left | Direction::Right);
+
+            if (const_map.cellAt(coords) != CellType::Wall)
+                return;
+
+            TS_ASSERT_EQUALS(decoration.below, const_map.cellAt(coords + sf::Vector2i(0, 1)));
+
+            for (int i = 0 ; i < 4 ; i++)
+            {
+                Direction dir1 = directions[i], dir2 = directions[(i+1) & 3];
+                bool corner = !has_direction(wall_neighborhood, dir1) && !has_direction(wall_neighborhood, dir2);
+                bool floor_corner = const_map.cellAt(coords + to_vector2i(dir1 | dir2)) == CellType::Floor;
+
+                TS_ASSERT_EQUALS(static_cast<bool>(decoration.corners & (1 << i)), corner);
+                if (corner)
+                    TS_ASSERT_EQUALS(static_cast<bool>(decoration.floor_corners & (1 << i)), floor_corner);
+            }
+        };
+
+        for (int x = -2 * Chunk::SIZE ; x < 2 * Chunk::SIZE ; x++)
+            for (int y = -2 * Chunk::SIZE ; y < 2 * Chunk::SIZE ; y++)
+                check(x, y);
+
+        // A new wall changes the decoration of its neighbours
+        map.setCell(0, 0, CellType::Wall);
+        map.setCell(0, 1, CellType::Floor);
+        for (int x = -2 ; x <= 2 ; x++)
+            for (int y = -2 ; y <= 2 ; y++)
+                check(x, y);
+
+        TS_ASSERT_EQUALS(const_map.decorationAt(0, 0).below, CellType::Floor);
+    }
+
+    /* Test that spans cover each cell of a rectangle once, with the cells of the map.
+     */
+    void testForEachSpan()
+    {
+        Map map;
+        const Map& const_map = map;
+        fill_map(map, 2 * Chunk::SIZE);
+        map.setChunk(5, -7, Chunk());
+
+        sf::IntRect area = {-3 * Chunk::SIZE + 1, -2 * Chunk::SIZE - 3, 6 * Chunk::SIZE, 5 * Chunk::SIZE - 1};
+        std::map<std::pair<int, int>, int> visits;
+        bool ordered = true;
+        std::pair<int, int> previous = {area.left - 1, area.top - 1};
+
+        map.forEachSpan(area, [&](int x, int y, const CellType* cells, int length)
+        {
+            TS_ASSERT(length > 0);
+            ordered = ordered && std::make_pair(y, x) > std::make_pair(previous.second, previous.first);
+            previous = {x + length - 1, y};
+
+            for (int i = 0 ; i < length ; i++)
+            {
+                visits[{x + i, y}]++;
+                TS_ASSERT_EQUALS(cells == nullptr ? CellType::Empty : cells[i], const_map.cellAt(x + i, y));
+                TS_ASSERT_EQUALS(cells == nullptr, !map.hasCell(x + i, y));
+            }
+        });
+
+        TS_ASSERT(ordered);
+        TS_ASSERT_EQUALS(visits.size(), static_cast<size_t>(area.width * area.height));
+
+        for (const auto& visit : visits)
+        {
+            TS_ASSERT(area.contains(visit.first.first, visit.first.second));
+            TS_ASSERT_EQUALS(visit.second, 1);
+        }
+
+        // Empty rectangles are not visited
+        map.forEachSpan({0, 0, 0, 5}, [](int, int, const CellType*, int) { TS_FAIL("Empty area visited"); });
+    }
+
+    /* Compare reading a large viewport with spans against reading cells one by one.
+     */
+    void testBenchForEachSpan()
+    {
+        using Clock = std::chrono::steady_clock;
+        using std::chrono::duration_cast;
+        using std::chrono::microseconds;
+
+        Map map;
+        fill_map(map, BENCH_CELLS / 2);
+        const Map& const_map = map;
+
+        // Slightly larger than the filled area, so that some chunks are missing
+        sf::IntRect viewport = {-BENCH_CELLS / 2 - 7, -BENCH_CELLS / 2 - 7, BENCH_CELLS + 14, BENCH_CELLS + 14};
+        long count_spans = 0;
+        long count_cells = 0;
+
+        auto start = Clock::now();
+        for (int pass = 0 ; pass < BENCH_PASSES ; pass++)
+        {
+            const_map.forEachSpan(viewport, [&count_spans](int, int, const CellType* cells, int length)
+            {
+                if (cells != nullptr)
+                    for (int i = 0 ; i < length ; i++)
+                        count_spans += static_cast<int>(cells[i]);
+            });
+        }
+        auto time_spans = Clock::now() - start;
+
+        start = Clock::now();
+        for (int pass = 0 ; pass < BENCH_PASSES ; pass++)
+            for (int x = viewport.left ; x < viewport.left + viewport.width ; x++)
+                for (int y = viewport.top ; y < viewport.top + viewport.height ; y++)
+                    count_cells += static_cast<int>(const_map.cellAt(x, y));
+        auto time_cells = Clock::now() - start;
+
+        TS_ASSERT_EQUALS(count_spans, count_cells);
+        TS_TRACE("Viewport with forEachSpan: " + std::to_string(duration_cast<microseconds>(time_spans).count()) + "us");
+        TS_TRACE("Viewport with cellAt: " + std::to_string(duration_cast<microseconds>(time_cells).count()) + "us");
+    }
+
+    /* Compare wallNext, computed with bit planes, against reading the 9 cells.
+     */
+    void testBenchWallNext()
+    {
+        using Clock = std::chrono::steady_clock;
+        using std::chrono::duration_cast;
+        using std::chrono::microseconds;
+
+        Map map;
+        fill_map(map, BENCH_CELLS / 2);
+        const Map& const_map = map;
+
+        long count_masks = 0;
+        long count_cells = 0;
+
+        auto start = Clock::now();
+        for (int pass = 0 ; pass < BENCH_PASSES ; pass++)
+            for (int x = -BENCH_CELLS / 2 ; x < BENCH_CELLS / 2 ; x++)
+                for (int y = -BENCH_CELLS / 2 ; y < BENCH_CELLS / 2 ; y++)
+                    count_masks += const_map.wallNext(x, y);
+        auto time_masks = Clock::now() - start;
+
+        start = Clock::now();
+        for (int pass = 0 ; pass < BENCH_PASSES ; pass++)
+        {
+            for (int x = -BENCH_CELLS / 2 ; x < BENCH_CELLS / 2 ; x++)
+            {
+                for (int y = -BENCH_CELLS / 2 ; y < BENCH_CELLS / 2 ; y++)
+                {
+                    bool wall = false;
+                    for (int i = -1 ; i <= 1 ; i++)
+                        for (int j = -1 ; j <= 1 ; j++)
+                            wall = wall || const_map.cellAt(x + i, y + j) == CellType::Wall;
+                    count_cells += wall;
+                }
+            }
+        }
+        auto time_cells = Clock::now() - start;
+
+        TS_ASSERT_EQUALS(count_masks, count_cells);
+        TS_TRACE("wallNext with masks: " + std::to_string(duration_cast<microseconds>(time_masks).count()) + "us");
+        TS_TRACE("wallNext with cells: " + std::to_string(duration_cast<microseconds>(time_cells).count()) + "us");
+    }
+
+    /* Compare wallNext on the same area with several sizes of chunks.
+     */
+    void testBenchChunkSize()
+    {
+        using std::chrono::duration_cast;
+        using std::chrono::microseconds;
+
+        long counts[4] = {0, 0, 0, 0};
+        auto time_4 = bench_wall_next<4>(counts[0]);
+        auto time_16 = bench_wall_next<16>(counts[1]);
+        auto time_32 = bench_wall_next<32>(counts[2]);
+        auto time_64 = bench_wall_next<64>(counts[3]);
+
+        TS_ASSERT_EQUALS(counts[0], counts[1]);
+        TS_ASSERT_EQUALS(counts[0], counts[2]);
+        TS_ASSERT_EQUALS(counts[0], counts[3]);
+
+        TS_TRACE("wallNext, chunks of 4: " + std::to_string(duration_cast<microseconds>(time_4).count()) + "us");
+        TS_TRACE("wallNext, chunks of 16: " + std::to_string(duration_cast<microseconds>(time_16).count()) + "us");
+        TS_TRACE("wallNext, chunks of 32: " + std::to_string(duration_cast<microseconds>(time_32).count()) + "us");
+        TS_TRACE("wallNext, chunks of 64: " + std::to_string(duration_cast<microseconds>(time_64).count()) + "us");
+    }
 };
@@ -0,0 +1,181 @@
+#include <cxxtest/TestSuite.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/chunk_pager.hpp"
+#include "../src/entity.hpp"
+#include "../src/entity_journal.hpp"
+#include "../src/map.hpp"
+
+
+// Chunks of the test map are in the square [-PAGER_CHUNKS, PAGER_CHUNKS)²
+constexpr int PAGER_CHUNKS = 5;
+
+
+class PagerTester : public CxxTest::TestSuite
+{
+public:
+    /* Test that chunks far from the hero go to the page file, the least recently used first,
+     * and come back with their entities.
+     */
+    void testEvictPageIn()
+    {
+        Map map;
+        std::vector<std::shared_ptr<Entity>> entities;
+
+        for (int x = -PAGER_CHUNKS ; x < PAGER_CHUNKS ; x++)
+        {
+            for (int y = -PAGER_CHUNKS ; y < PAGER_CHUNKS ; y++)
+            {
+                map.setChunk(x, y, Chunk());
+                map.setCell(x * Chunk::SIZE, y * Chunk::SIZE, static_cast<CellType>((x + y) & 1 ? 1 : 2));
+            }
+        }
+
+        const sf::Vector2i far_cell {-PAGER_CHUNKS * Chunk::SIZE + 1, 1};
+        entities.push_back(std::make_shared<Character>(EntityType::Hero, Interaction::None, sf::Vector2i{}));
+        entities.push_back(std::make_shared<Character>(EntityType::Monster, Interaction::None, far_cell));
+        entities.push_back(std::make_shared<Entity>(EntityType::Stairs, Interaction::GoDown, far_cell));
+
+        ChunkPager pager {"pager_test.dat"};
+        const int last = PAGER_CHUNKS - 1;
+        pager.touch(last, last);
+
+        // 25 chunks are close to the hero, the touched chunk is evicted after the 74 other ones
+        TS_ASSERT_EQUALS(pager.evict(map, entities, {0, 0}, 2 * Chunk::SIZE), ChunkPager::MAX_EVICTIONS);
+        TS_ASSERT(map.hasChunk(0, 0));
+        TS_ASSERT(map.hasChunk(2, -2));
+        TS_ASSERT(map.hasChunk(last, last));
+        TS_ASSERT(pager.evict(map, entities, {0, 0}, 2 * Chunk::SIZE) > 0);
+        TS_ASSERT(!map.hasChunk(last, last));
+        TS_ASSERT_EQUALS(map.getChunks().size(), 25u);
+
+        // The monster is paged with its chunk, the hero and the stairs stay
+        TS_ASSERT_EQUALS(entities.size(), 2u);
+        TS_ASSERT(std::none_of(entities.begin(), entities.end(), [](const std::shared_ptr<Entity>& e) {
+            return e->getType() == EntityType::Monster;
+        }));
+
+        auto far_chunk = Chunk::sector(far_cell.x, far_cell.y);
+        TS_ASSERT(pager.contains(far_chunk.first, far_chunk.second));
+        TS_ASSERT(pager.pageIn(far_chunk.first, far_chunk.second, map, entities));
+        TS_ASSERT(!pager.pageIn(0, 0, map, entities));
+        TS_ASSERT_EQUALS(entities.size(), 3u);
+        TS_ASSERT_EQUALS(entities.back()->getPosition(), far_cell);
+
+        const PagerStats& stats = pager.getStats();
+        TS_ASSERT_EQUALS(stats.evictions, 75u);
+        TS_ASSERT_EQUALS(stats.faults, 1u);
+        TS_ASSERT_EQUALS(stats.lookups, 2u);
+        TS_ASSERT_EQUALS(stats.paged_chunks, 74u);
+        TS_ASSERT_DELTA(stats.faultRate(), 0.5, 1e-9);
+
+        // Every cells are back after paging in the whole map, through compactions of the file
+        pager.pageInAll(map, entities);
+        TS_ASSERT_EQUALS(map.getChunks().size(), static_cast<size_t>(4 * PAGER_CHUNKS * PAGER_CHUNKS));
+        TS_ASSERT_EQUALS(pager.getStats().live_bytes, 0u);
+
+        const Map& const_map = map;
+        for (int x = -PAGER_CHUNKS ; x < PAGER_CHUNKS ; x++)
+            for (int y = -PAGER_CHUNKS ; y < PAGER_CHUNKS ; y++)
+                TS_ASSERT_EQUALS(const_map.cellAt(x * Chunk::SIZE, y * Chunk::SIZE),
+                                 static_cast<CellType>((x + y) & 1 ? 1 : 2));
+    }
+
+    /* Test that a chunk whose record can't be read back stays in the page file.
+     */
+    void testUnreadableRecord()
+    {
+        Map map;
+        std::vector<std::shared_ptr<Entity>> entities;
+
+        map.setChunk(0, 0, Chunk());
+        map.setChunk(PAGER_CHUNKS, 0, Chunk());
+        entities.push_back(std::make_shared<Character>(EntityType::Monster, Interaction::None,
+                                                       sf::Vector2i{PAGER_CHUNKS * Chunk::SIZE + 1, 1}));
+
+        const std::string page_path {"pager_unreadable_test.dat"};
+        ChunkPager pager {page_path};
+        TS_ASSERT_EQUALS(pager.evict(map, entities, {0, 0}, Chunk::SIZE), 1u);
+        TS_ASSERT(entities.empty());
+
+        // The record is lost from the disk
+        std::ofstream {page_path, std::ios::trunc};
+
+        TS_ASSERT(!pager.pageIn(PAGER_CHUNKS, 0, map, entities));
+        TS_ASSERT(pager.contains(PAGER_CHUNKS, 0));
+        TS_ASSERT(!map.hasChunk(PAGER_CHUNKS, 0));
+        TS_ASSERT(entities.empty());
+        TS_ASSERT_EQUALS(pager.getStats().faults, 0u);
+
+        pager.pageInAll(map, entities);
+        TS_ASSERT(pager.contains(PAGER_CHUNKS, 0));
+    }
+
+    /* Test that a journal only holds the entities of the chunks which changed,
+     * and that they replace the saved ones when it is loaded.
+     */
+    void testEntityChanges()
+    {
+        const std::string journal_path {"entities_test.journal"};
+        std::ofstream {journal_path, std::ios::trunc};
+
+        const sf::Vector2i far_cell {2 * Chunk::SIZE + 1, 1};
+        auto hero = std::make_shared<Character>(EntityType::Hero, Interaction::None, sf::Vector2i{});
+        auto near = std::make_shared<Character>(EntityType::Monster, Interaction::None, sf::Vector2i{1, 1});
+        auto far = std::make_shared<Character>(EntityType::Monster, Interaction::None, far_cell);
+        auto stairs = std::make_shared<Entity>(EntityType::Stairs, Interaction::GoDown, far_cell);
+        std::vector<std::shared_ptr<Entity>> entities {hero, near, far, stairs};
+
+        // Copy of the entities, as written in the whole file of a save
+        std::stringstream snapshot;
+        for (const auto& entity : entities)
+            snapshot << entity;
+
+        // The monster goes to the next chunk and the hero moves
+        ChunkTable<uint8_t> dirty;
+        near->setPosition({Chunk::SIZE + 1, 1});
+        hero->setPosition({5, 5});
+        dirty.insert(0, 0, 1);
+        dirty.insert(1, 0, 1);
+        TS_ASSERT(save_entities_changes(journal_path, entities, dirty));
+        std::streamoff first_size = std::ifstream{journal_path, std::ios::binary | std::ios::ate}.tellg();
+
+        // The far monster dies, the stairs of its chunk are written again
+        dirty.clear();
+        entities.erase(std::find(entities.begin(), entities.end(), far));
+        dirty.insert(2, 0, 1);
+        TS_ASSERT(save_entities_changes(journal_path, entities, dirty));
+
+        std::stringstream changed;
+        changed << entities[0] << entities.back();
+        std::streamoff second_size = std::ifstream{journal_path, std::ios::binary | std::ios::ate}.tellg();
+        TS_ASSERT_EQUALS(second_size - first_size,
+                         static_cast<std::streamoff>(3 * sizeof(uint32_t) + 2 * sizeof(int32_t) + changed.str().size()));
+
+        std::vector<std::shared_ptr<Entity>> loaded(4);
+        for (auto& entity : loaded)
+            snapshot >> entity;
+        TS_ASSERT(load_entities_changes(journal_path, loaded));
+
+        TS_ASSERT_EQUALS(loaded.size(), 3u);
+        for (const auto& entity : loaded)
+        {
+            if (entity->getType() == EntityType::Hero)
+                TS_ASSERT_EQUALS(entity->getPosition(), sf::Vector2i(5, 5));
+            else if (entity->getType() == EntityType::Monster)
+                TS_ASSERT_EQUALS(entity->getPosition(), sf::Vector2i(Chunk::SIZE + 1, 1));
+            else
+                TS_ASSERT_EQUALS(entity->getPosition(), far_cell);
+        }
+
+        TS_ASSERT(!load_entities_changes("missing.journal", loaded));
+        std::remove(journal_path.c_str());
+    }
+};
@@ -1,6 +1,84 @@
 #include <cxxtest/TestSuite.h>
 
+#include <algorithm>
+#include <chrono>
+#include <set>
+#include <string>
+
+#include "../src/generation/gen_pattern.hpp"
 #include "../src/generation/pattern.hpp"
+#include "../src/rand.hpp"
+
+
+// Number of random operations compared with a set
+constexpr int NB_PATTERN_OPERATIONS = 5000;
+
+// Coordinates of random cells are in [-PATTERN_RANGE, PATTERN_RANGE], over several words of a column
+constexpr int PATTERN_RANGE = 150;
+
+// Size of the caves used by benchmarks, and number of times they are computed
+constexpr int BENCH_CAVE_SIZE = 300;
+constexpr int BENCH_PATTERN_RUNS = 200;
+
+// Sizes of caves generated by benchmarks, the default and ten times the default maximal size of rooms
+constexpr int BENCH_CAVE_SIZES[] = {300, 3000};
+constexpr int BENCH_CAVE_RUNS = 20;
+
+
+/**
+ * \brief  Frontier of a set of cells, looking for the neighbours of each cell.
+ */
+static std::set<Point> set_frontier(const std::set<Point>& cells)
+{
+    std::set<Point> frontier;
+
+    for (const Point& cell : cells)
+        if (!cells.count(cell + Point(1, 0)) || !cells.count(cell - Point(1, 0)) ||
+            !cells.count(cell + Point(0, 1)) || !cells.count(cell - Point(0, 1)))
+            frontier.insert(cell);
+
+    return frontier;
+}
+
+/**
+ * \brief  Surrounding of a set of cells, looking for the neighbours of each cell.
+ */
+static std::set<Point> set_surrounding(const std::set<Point>& cells)
+{
+    std::set<Point> surrounding;
+
+    for (const Point& cell : cells)
+        for (int dx = -1 ; dx <= 1 ; dx++)
+            for (int dy = -1 ; dy <= 1 ; dy++)
+                if (!cells.count(cell + Point(dx, dy)))
+                    surrounding.insert(cell + Point(dx, dy));
+
+    return surrounding;
+}
+
+/**
+ * \brief  Grow a cave picking cells in an ordered set of the cells next to it.
+ */
+static std::set<Point> set_cave(int size)
+{
+    std::set<Point> cells = {{0, 0}};
+    std::set<Point> frontier = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+
+    for (int nb_cells = 1 ; nb_cells < size ; nb_cells++)
+    {
+        auto selected = begin(frontier);
+        std::advance(selected, RandGen::uniform_int(0, frontier.size() - 1));
+        Point cell = *selected;
+        frontier.erase(selected);
+        cells.insert(cell);
+
+        for (Point dir : {Point(1, 0), Point(-1, 0), Point(0, 1), Point(0, -1)})
+            if (!cells.count(cell + dir))
+                frontier.insert(cell + dir);
+    }
+
+    return cells;
+}
 
 
 class PatternTester : public CxxTest::TestSuite
@@ -53,4 +131,190 @@ public:
             {0, 0}, room
         ));
     }
+
+    /*
+     * Check that cells are iterated in the order of a set, and that patterns convert to sets.
+     */
+    void testSetConversion()
+    {
+        std::set<Point> cells = {{-70, 3}, {0, 0}, {0, -65}, {0, 64}, {2, -1}, {200, 1}};
+        Pattern pattern(cells);
+
+        TS_ASSERT_EQUALS(pattern.size(), cells.size());
+        TS_ASSERT(std::equal(begin(cells), end(cells), begin(pattern)));
+        TS_ASSERT_EQUALS(pattern.toSet(), cells);
+
+        TS_ASSERT(Pattern() == Pattern(std::set<Point>()));
+        TS_ASSERT(pattern == Pattern(begin(cells), end(cells)));
+        TS_ASSERT(pattern != Pattern({{0, 0}}));
+    }
+
+    /*
+     * Compare random insertions and removals with a set.
+     */
+    void testRandomOperations()
+    {
+        Pattern pattern;
+        std::set<Point> cells;
+
+        for (int i_op = 0 ; i_op < NB_PATTERN_OPERATIONS ; i_op++)
+        {
+            Point cell(Rand::uniform_int(-PATTERN_RANGE, PATTERN_RANGE), Rand::uniform_int(-PATTERN_RANGE, PATTERN_RANGE));
+
+            if (Rand::uniform_int(0, 2) == 0)
+                TS_ASSERT_EQUALS(pattern.erase(cell), cells.erase(cell));
+            else
+                TS_ASSERT_EQUALS(pattern.insert(cell), cells.insert(cell).second);
+
+            TS_ASSERT_EQUALS(pattern.contains(cell), cells.count(cell) == 1);
+        }
+
+        TS_ASSERT_EQUALS(pattern.size(), cells.size());
+        TS_ASSERT_EQUALS(pattern.toSet(), cells);
+
+        // Iterating from a cell gives the next cells of the set
+        Point middle = *std::next(begin(cells), cells.size() / 2);
+        TS_ASSERT(std::equal(cells.find(middle), end(cells), pattern.find(middle)));
+        TS_ASSERT(pattern.find({PATTERN_RANGE + 1, 0}) == end(pattern));
+
+        TS_ASSERT_EQUALS(pattern_min_x(pattern), begin(cells)->first);
+        TS_ASSERT_EQUALS(pattern_max_x(pattern), cells.rbegin()->first);
+
+        pattern.clear();
+        TS_ASSERT(pattern.empty());
+        TS_ASSERT(begin(pattern) == end(pattern));
+    }
+
+    /*
+     * Compare frontier and surrounding of caves with the same functions on sets.
+     */
+    void testFrontier()
+    {
+        for (int size : {1, 10, 100, 1000})
+        {
+            Pattern cave = generate_cave(size);
+            std::set<Point> cells = cave.toSet();
+
+            TS_ASSERT_EQUALS(frontier(cave).toSet(), set_frontier(cells));
+            TS_ASSERT_EQUALS(surrounding(cave).toSet(), set_surrounding(cells));
+        }
+
+        // A rectangle of 5x4 cells
+        Pattern rectangle = generate_rectangle(5, 4);
+        TS_ASSERT_EQUALS(frontier(rectangle).size(), 14u);
+        TS_ASSERT_EQUALS(surrounding(rectangle).size(), 22u);
+    }
+
+    /*
+     * Check merging of patterns.
+     */
+    void testMerge()
+    {
+        Pattern cross = {{0, -1}, {-1, 0}, {0, 0}, {1, 0}, {0, 1}};
+        Pattern merged = merged_patterns({{0, 0}, {100, -100}, {1, 0}}, {cross, cross, cross});
+
+        TS_ASSERT_EQUALS(merged.size(), 13u);
+        TS_ASSERT(merged.contains({100, -101}));
+        TS_ASSERT(merged.contains({2, 0}));
+        TS_ASSERT(merged.contains({1, 1}));
+        TS_ASSERT(!merged.contains({-1, 1}));
+        TS_ASSERT(superposed({0, 0}, merged, {99, -100}, cross));
+        TS_ASSERT(!superposed({0, 0}, merged, {50, 50}, cross));
+    }
+
+    /*
+     * Compare the time needed to find the frontier of caves with a set of cells.
+     */
+    void testBenchFrontier()
+    {
+        using Clock = std::chrono::steady_clock;
+        using std::chrono::duration_cast;
+        using std::chrono::microseconds;
+
+        Pattern cave = generate_cave(BENCH_CAVE_SIZE);
+        std::set<Point> cells = cave.toSet();
+        size_t found = 0;
+
+        auto start = Clock::now();
+        for (int i_run = 0 ; i_run < BENCH_PATTERN_RUNS ; i_run++)
+            found += frontier(cave).size();
+        auto time_bitmap = Clock::now() - start;
+
+        start = Clock::now();
+        for (int i_run = 0 ; i_run < BENCH_PATTERN_RUNS ; i_run++)
+            found -= set_frontier(cells).size();
+        auto time_set = Clock::now() - start;
+
+        TS_ASSERT_EQUALS(found, 0u);
+        TS_TRACE("frontier of a bitmap: " + std::to_string(duration_cast<microseconds>(time_bitmap).count()) + "us");
+        TS_TRACE("frontier of a set: " + std::to_string(duration_cast<microseconds>(time_set).count()) + "us");
+    }
+
+    /*
+     * Check the size and the connexity of caves.
+     */
+    void testCaves()
+    {
+        for (int size : {1, 2, 50, 300, 3000})
+        {
+            Pattern cave = generate_cave(size);
+            TS_ASSERT_EQUALS(cave.size(), static_cast<size_t>(size));
+            TS_ASSERT(cave.contains({0, 0}));
+            TS_ASSERT(size < 2 || cave.contains({1, 0}));
+
+            Pattern cellular = generate_cellular_cave(size);
+            TS_ASSERT_EQUALS(cellular.size(), static_cast<size_t>(std::max(size, 2)));
+            TS_ASSERT(cellular.contains({0, 0}));
+            TS_ASSERT(cellular.contains({1, 0}));
+
+            // Every cells can be reached from (0, 0)
+            Pattern reached = {{0, 0}};
+            std::vector<Point> stack = {{0, 0}};
+            while (!stack.empty())
+            {
+                Point cell = stack.back();
+                stack.pop_back();
+
+                for (Point dir : {Point(1, 0), Point(-1, 0), Point(0, 1), Point(0, -1)})
+                    if (cellular.contains(cell + dir) && reached.insert(cell + dir))
+                        stack.push_back(cell + dir);
+            }
+
+            TS_ASSERT_EQUALS(reached, cellular);
+        }
+    }
+
+    /*
+     * Compare the time needed to generate caves, growing them with a set or an array of cells, and with a
+     * cellular automaton.
+     */
+    void testBenchCaves()
+    {
+        using Clock = std::chrono::steady_clock;
+        using std::chrono::duration_cast;
+        using std::chrono::microseconds;
+
+        for (int size : BENCH_CAVE_SIZES)
+        {
+            auto start = Clock::now();
+            for (int i_run = 0 ; i_run < BENCH_CAVE_RUNS ; i_run++)
+                set_cave(size);
+            auto time_set = Clock::now() - start;
+
+            start = Clock::now();
+            for (int i_run = 0 ; i_run < BENCH_CAVE_RUNS ; i_run++)
+                generate_cave(size);
+            auto time_array = Clock::now() - start;
+
+            start = Clock::now();
+            for (int i_run = 0 ; i_run < BENCH_CAVE_RUNS ; i_run++)
+                generate_cellular_cave(size);
+            auto time_cellular = Clock::now() - start;
+
+            std::string name = "caves of size " + std::to_string(size) + ", ";
+            TS_TRACE(name + "growing a set: " + std::to_string(duration_cast<microseconds>(time_set).count() / BENCH_CAVE_RUNS) + "us");
+            TS_TRACE(name + "growing an array: " + std::to_string(duration_cast<microseconds>(time_array).count() / BENCH_CAVE_RUNS) + "us");
+            TS_TRACE(name + "cellular automaton: " + std::to_string(duration_cast<microseconds>(time_cellular).count() / BENCH_CAVE_RUNS) + "us");
+        }
+    }
 };
@@ -0,0 +1,121 @@
+#include <cxxtest/TestSuite.h>
+
+#include <utility>
+
+#include "../src/chunk_prefetch.hpp"
+
+
+// Radius of the square of chunks preloaded around the hero
+constexpr int PREFETCH_RADIUS = 5;
+
+
+class PrefetchTester : public CxxTest::TestSuite
+{
+public:
+    /* Test that the preloaded square is extended towards the direction of the hero, and not when it
+     * comes and goes.
+     */
+    void testHeading()
+    {
+        ChunkPrefetcher prefetcher;
+        prefetcher.cross({0, 0}, 0, true);
+
+        ChunkArea area = prefetcher.area(PREFETCH_RADIUS);
+        TS_ASSERT_EQUALS(area.x_min, -PREFETCH_RADIUS);
+        TS_ASSERT_EQUALS(area.x_max, PREFETCH_RADIUS);
+        TS_ASSERT_EQUALS(prefetcher.getHeading(), std::make_pair(0, 0));
+
+        // Walk to the east
+        for (int x = 1 ; x <= 4 ; x++)
+        {
+            for (int turn = 0 ; turn < 4 ; turn++)
+                prefetcher.turn();
+
+            prefetcher.cross({x, 0}, 0, false);
+        }
+
+        area = prefetcher.area(PREFETCH_RADIUS);
+        TS_ASSERT_EQUALS(prefetcher.getHeading(), std::make_pair(1, 0));
+        TS_ASSERT_EQUALS(prefetcher.getFocus(), std::make_pair(5, 0));
+        TS_ASSERT_EQUALS(area.x_min, 4 - PREFETCH_RADIUS);
+        TS_ASSERT(area.x_max > 4 + PREFETCH_RADIUS);
+        TS_ASSERT_EQUALS(area.y_min, -PREFETCH_RADIUS);
+        TS_ASSERT_EQUALS(area.y_max, PREFETCH_RADIUS);
+
+        // Turn to the south-west
+        for (int i = 1 ; i <= 4 ; i++)
+            prefetcher.cross({4 - i, i}, 0, false);
+
+        area = prefetcher.area(PREFETCH_RADIUS);
+        TS_ASSERT_EQUALS(prefetcher.getHeading(), std::make_pair(-1, 1));
+        TS_ASSERT(area.x_min < -PREFETCH_RADIUS);
+        TS_ASSERT(area.y_max > 4 + PREFETCH_RADIUS);
+
+        // Come and go
+        for (int i = 0 ; i < 8 ; i++)
+            prefetcher.cross({i % 2, 4}, 0, false);
+
+        TS_ASSERT_EQUALS(prefetcher.getHeading(), std::make_pair(0, 0));
+
+        prefetcher.reset();
+        prefetcher.cross({10, 10}, 0, false);
+        TS_ASSERT_EQUALS(prefetcher.getFocus(), std::make_pair(10, 10));
+        TS_ASSERT_EQUALS(prefetcher.getStats().crossings, 15u);
+    }
+
+    /* Test that the lead grows with the speed of the hero and shrinks with the speed of the generation.
+     */
+    void testLead()
+    {
+        auto lead = [](int turns_per_chunk, int filled_per_turn) {
+            ChunkPrefetcher prefetcher;
+            uint64_t filled = 0;
+
+            for (int x = 0 ; x < 10 ; x++)
+            {
+                for (int turn = 0 ; turn < turns_per_chunk ; turn++)
+                {
+                    prefetcher.turn();
+                    filled += filled_per_turn;
+                }
+
+                prefetcher.cross({x, 0}, filled, true);
+            }
+
+            prefetcher.area(PREFETCH_RADIUS);
+            return prefetcher.getStats().lead;
+        };
+
+        // The generation fills a side of 11 chunks in 11 turns
+        TS_ASSERT_EQUALS(lead(1, 1), ChunkPrefetcher::MAX_LEAD);
+        TS_ASSERT_EQUALS(lead(4, 1), 3);
+        TS_ASSERT_EQUALS(lead(11, 1), 1);
+        TS_ASSERT_EQUALS(lead(4, 100), 1);
+        TS_ASSERT(lead(2, 1) >= lead(4, 1));
+    }
+
+    /* Test the counters of waits for the generation and of chunks added in advance.
+     */
+    void testStats()
+    {
+        ChunkPrefetcher prefetcher;
+        TS_ASSERT_EQUALS(prefetcher.getStats().waitsPerThousandTurns(), 0.);
+
+        for (int turn = 0 ; turn < 500 ; turn++)
+            prefetcher.turn();
+
+        prefetcher.wait();
+        prefetcher.wait();
+        prefetcher.wait();
+
+        TS_ASSERT_EQUALS(prefetcher.getStats().turns, 500u);
+        TS_ASSERT_EQUALS(prefetcher.getStats().waits, 3u);
+        TS_ASSERT_DELTA(prefetcher.getStats().waitsPerThousandTurns(), 6., 1e-9);
+
+        prefetcher.stream();
+        prefetcher.stream();
+        prefetcher.miss();
+        TS_ASSERT_EQUALS(prefetcher.getStats().streamed, 2u);
+        TS_ASSERT_EQUALS(prefetcher.getStats().misses, 1u);
+    }
+};
@@ -0,0 +1,145 @@
+#include <cxxtest/TestSuite.h>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../src/generation/generator.hpp"
+#include "../src/entity.hpp"
+#include "../src/exploration.hpp"
+#include "../src/level_speculation.hpp"
+
+
+// Distance, in cells, to stairs going down below which the next level is generated
+constexpr int SPECULATION_DISTANCE = 40;
+
+// Radius of the square of chunks generated around the entrance of the next level
+constexpr int SPECULATION_RADIUS = 1;
+
+
+class SpeculationTester : public CxxTest::TestSuite
+{
+public:
+    /* Test that the next level is generated when the hero comes close to stairs going down, or sees them.
+     */
+    void testStart()
+    {
+        LevelSpeculator speculator = makeSpeculator();
+        MapExploration exploration;
+        std::vector<std::shared_ptr<Entity>> entities {
+            std::make_shared<Entity>(EntityType::Stairs, Interaction::GoDown, sf::Vector2i{100, 0}),
+            std::make_shared<Entity>(EntityType::Stairs, Interaction::GoUp, sf::Vector2i{0, 0})
+        };
+
+        // Stairs going up don't count
+        speculator.update(true, {0, 0}, entities, exploration);
+        TS_ASSERT(!speculator.isSpeculating());
+        TS_ASSERT(!speculator.hasGenerator());
+
+        speculator.update(true, {100 - SPECULATION_DISTANCE, 0}, entities, exploration);
+        TS_ASSERT(speculator.isSpeculating());
+        TS_ASSERT(speculator.hasGenerator());
+
+        // Stairs seen from further
+        speculator = makeSpeculator();
+        speculator.update(true, {100 - 2 * SPECULATION_DISTANCE, 0}, entities, exploration);
+        TS_ASSERT(!speculator.isSpeculating());
+
+        exploration.setExplored({100, 0});
+        speculator.update(true, {100 - 2 * SPECULATION_DISTANCE, 0}, entities, exploration);
+        TS_ASSERT(speculator.isSpeculating());
+
+        // Nothing is generated when the distance is 0
+        speculator.reset(parameters(), 0);
+        speculator.update(true, {100, 0}, entities, exploration);
+        TS_ASSERT(!speculator.isSpeculating());
+        TS_ASSERT(!speculator.hasGenerator());
+    }
+
+    /* Test that the generation is parked when the hero goes away or up, keeping its generator, and resumed.
+     */
+    void testPark()
+    {
+        LevelSpeculator speculator = makeSpeculator();
+        MapExploration exploration;
+        std::vector<std::shared_ptr<Entity>> entities {
+            std::make_shared<Entity>(EntityType::Stairs, Interaction::GoDown, sf::Vector2i{0, 0})
+        };
+
+        speculator.update(true, {SPECULATION_DISTANCE, 0}, entities, exploration);
+        TS_ASSERT(speculator.isSpeculating());
+
+        // Between the distance and PARK_FACTOR times the distance, nothing changes
+        speculator.update(true, {LevelSpeculator::PARK_FACTOR * SPECULATION_DISTANCE, 0}, entities, exploration);
+        TS_ASSERT(speculator.isSpeculating());
+
+        speculator.update(true, {LevelSpeculator::PARK_FACTOR * SPECULATION_DISTANCE + 1, 0}, entities, exploration);
+        TS_ASSERT(!speculator.isSpeculating());
+        TS_ASSERT(speculator.hasGenerator());
+
+        speculator.update(true, {LevelSpeculator::PARK_FACTOR * SPECULATION_DISTANCE, 0}, entities, exploration);
+        TS_ASSERT(!speculator.isSpeculating());
+
+        speculator.update(true, {0, -SPECULATION_DISTANCE}, entities, exploration);
+        TS_ASSERT(speculator.isSpeculating());
+
+        // The stairs of another level don't count
+        speculator.update(false, {0, 0}, entities, exploration);
+        TS_ASSERT(!speculator.isSpeculating());
+        TS_ASSERT(speculator.hasGenerator());
+    }
+
+    /* Test that the generator started in advance is the one given when the hero goes down, and then forgotten.
+     */
+    void testTakeGenerator()
+    {
+        LevelSpeculator speculator = makeSpeculator();
+        MapExploration exploration;
+        std::vector<std::shared_ptr<Entity>> entities {
+            std::make_shared<Entity>(EntityType::Stairs, Interaction::GoDown, sf::Vector2i{0, 0})
+        };
+
+        // Without speculation, a new generator is given
+        auto generator = speculator.takeGenerator();
+        TS_ASSERT(generator != nullptr);
+        TS_ASSERT(!speculator.hasGenerator());
+
+        speculator.update(true, {0, 0}, entities, exploration);
+        generator = speculator.takeGenerator();
+        TS_ASSERT(!speculator.isSpeculating());
+        TS_ASSERT(!speculator.hasGenerator());
+
+        // The entrance is generated without any other request
+        while (!generator->isReady(0, 0))
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        TS_ASSERT(!generator->takeChunkEntities(0, 0).empty());
+
+        speculator.update(true, {0, 0}, entities, exploration);
+        TS_ASSERT(speculator.hasGenerator());
+        TS_ASSERT(speculator.takeGenerator() != generator);
+    }
+
+private:
+    static GenerationMode parameters()
+    {
+        GenerationMode gen_options;
+        gen_options.room_min_size = 50;
+        gen_options.room_max_size = 300;
+        gen_options.room_margin = 4;
+        gen_options.type = LevelType::Cave;
+        gen_options.monster_load = 3.f;
+        gen_options.maze_density = 0.1f;
+        gen_options.infinite = true;
+
+        return gen_options;
+    }
+
+    static LevelSpeculator makeSpeculator()
+    {
+        LevelSpeculator speculator {SPECULATION_RADIUS, [] { return UINT64_C(42); }};
+        speculator.reset(parameters(), SPECULATION_DISTANCE);
+
+        return speculator;
+    }
+};